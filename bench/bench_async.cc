@@ -0,0 +1,153 @@
+// 同步推理与异步推理(每个rknn上下文两帧在途)的吞吐随上下文数的变化
+// 用法: ./bench_async <rknn model> [每组帧数] [最多上下文数] [宽] [高]
+// 上下文数从1增加到最多上下文数, 分别用同步模式(线程数 = 上下文数)和异步模式(线程数 = 上下文数 * 2)的
+// rknnPool<Yolo11, DetectionRequest, DetectionHandle> 处理同一帧画面, 打印帧率、各核心的忙碌比例和每个上下文的最大在途帧数。
+// 两种模式每帧检测数不同、有帧失败或异步模式下上下文从未有两帧在途时返回非0。
+// 无NPU主机上配合 -DRKNN_USE_MOCK=ON 使用, 单帧延迟由 RKNN_MOCK_CORE_LATENCY_US 控制
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <dlfcn.h>
+#include <algorithm>
+#include <chrono>
+
+#include "opencv2/core/core.hpp"
+#include "Yolo11.hpp"
+#include "rknnPool.hpp"
+#include "rknn_mock.h"
+
+typedef int (*core_stats_fn)(int, rknn_mock_core_stats *);
+typedef void (*reset_stats_fn)(void);
+
+struct Result
+{
+    double fps;
+    double detections;   // 每帧检测数
+    int failed;          // 没有返回记录的帧
+    int maxInflight;     // 单个上下文出现过的最大在途帧数
+    double busy[RKNN_MOCK_MAX_CORES];
+};
+
+static int run_pool(const char *model, int contexts, bool async, const cv::Mat &frame, int frames, core_stats_fn get_core_stats,
+                    reset_stats_fn reset_stats, Result &result)
+{
+    int framesPerModel = async ? 2 : 1;
+    Yolo11Options options;
+    options.async = async;
+    rknnPool<Yolo11, DetectionRequest, DetectionHandle> pool(model, contexts);
+    pool.setModelOptions(options);
+    pool.setFramesPerModel(framesPerModel);
+    int ret = pool.init();
+    if (ret != 0)
+    {
+        printf("rknnPool init fail!\n");
+        return -1;
+    }
+
+    // 每个推理线程保持一帧在途
+    int inflight = contexts * framesPerModel;
+    DetectionRequest request;
+    request.frame = frame;
+    for (int i = 0; i < inflight; i++)
+        pool.put(request);
+    if (reset_stats != NULL)
+        reset_stats();
+
+    long long detections = 0;
+    result.failed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        DetectionHandle record;
+        if (pool.get(record) != 0)
+            break;
+        if (record)
+            detections += record->count();
+        else
+            result.failed++;
+        request.frame_id = i;
+        pool.put(request);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (int i = 0; i < inflight; i++)
+    {
+        DetectionHandle record;
+        pool.get(record);
+    }
+
+    result.fps = frames / seconds;
+    result.detections = (double)detections / frames;
+    result.maxInflight = 0;
+    for (const rknnModelStats &stats : pool.getModelStats())
+        result.maxInflight = std::max(result.maxInflight, stats.maxInflight);
+    for (int c = 0; c < RKNN_MOCK_MAX_CORES; c++)
+    {
+        rknn_mock_core_stats stats;
+        result.busy[c] = get_core_stats != NULL && get_core_stats(c, &stats) == 0 ? stats.busy_us / 1e6 / seconds : 0;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <rknn model> [frames] [max contexts] [width] [height]\n", argv[0]);
+        return -1;
+    }
+    int frames = argc > 2 ? atoi(argv[2]) : 300;
+    int maxContexts = argc > 3 ? atoi(argv[3]) : 6;
+    int width = argc > 4 ? atoi(argv[4]) : 1920;
+    int height = argc > 5 ? atoi(argv[5]) : 1080;
+
+    // 只有 rknnrt_mock 导出核心统计, 链接真实运行时只比较帧率
+    core_stats_fn get_core_stats = (core_stats_fn)dlsym(RTLD_DEFAULT, "rknn_mock_get_core_stats");
+    reset_stats_fn reset_stats = (reset_stats_fn)dlsym(RTLD_DEFAULT, "rknn_mock_reset_stats");
+    if (get_core_stats == NULL)
+        printf("runtime has no core counters, comparing fps only\n");
+
+    cv::Mat frame(height, width, CV_8UC3);
+    for (int y = 0; y < height; y++)
+    {
+        unsigned char *row = frame.ptr(y);
+        for (int x = 0; x < width * 3; x++)
+            row[x] = (unsigned char)(x * 7 + y * 3);
+    }
+
+    int failures = 0;
+    printf("contexts  sync fps  (core busy)          async fps  (core busy)          async max frames/context\n");
+    for (int contexts = 1; contexts <= maxContexts; contexts++)
+    {
+        Result sync, async;
+        if (run_pool(argv[1], contexts, false, frame, frames, get_core_stats, reset_stats, sync) != 0 ||
+            run_pool(argv[1], contexts, true, frame, frames, get_core_stats, reset_stats, async) != 0)
+            return -1;
+        printf("%8d  %8.1f  (%3.0f%% %3.0f%% %3.0f%%)  %9.1f  (%3.0f%% %3.0f%% %3.0f%%)  %d\n", contexts, sync.fps, sync.busy[0] * 100,
+               sync.busy[1] * 100, sync.busy[2] * 100, async.fps, async.busy[0] * 100, async.busy[1] * 100, async.busy[2] * 100,
+               async.maxInflight);
+        if (sync.failed != 0 || async.failed != 0)
+        {
+            printf("  %d/%d frames failed\n", sync.failed, async.failed);
+            failures++;
+        }
+        // 输入相同, 两种模式每帧的检测数应相同
+        if (sync.detections != async.detections)
+        {
+            printf("  detections differ: %.2f vs %.2f per frame\n", sync.detections, async.detections);
+            failures++;
+        }
+        if (async.maxInflight < 2)
+        {
+            printf("  async contexts never had two frames in flight\n");
+            failures++;
+        }
+    }
+
+    if (failures != 0)
+    {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,269 @@
+// process_i8 类别扫描的微基准和一致性检查
+// 用法: ./bench_class_scan [轮数]
+// 先在随机分数(含大量并列最大值、各种zp/按类别的阈值、1/3/20/80类及非特化的类别数)上逐格子比较 class_scan_row
+// 与原来逐格子跨步扫描的结果, 并检查只扫描部分类别的 class_scan_row_list 与把其余类别阈值设为127的整体扫描结果一致,
+// 以及同样的分数重排为原生 NC1HWC2 布局(C2为16或8, 补齐的通道填随机值)后 class_scan_row_native 的结果一致, 不一致时返回非0;
+// 再在 80x80/40x40/20x20 三个输出上分别按稀疏(空场景)和密集(拥挤场景)分数对比80类、只扫描3类及原生布局的耗时
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "postprocess.h"
+
+static const int grids[3] = {80, 40, 20};
+static const int class_counts[5] = {80, 20, 3, 1, 33};
+
+// 原 process_i8 的内层循环, 阈值改为按类别给出; 没有类别超过阈值的格子记为 -1
+static void original_scan(const int8_t *score_tensor, int grid_h, int grid_w, int num_class, const int8_t *score_thres_i8,
+                          int32_t score_zp, int8_t *out_max, int8_t *out_cls)
+{
+    int grid_len = grid_h * grid_w;
+    for (int i = 0; i < grid_h; i++) {
+        for (int j = 0; j < grid_w; j++) {
+            int offset = i * grid_w + j;
+            int max_class_id = -1;
+            int8_t max_score = -score_zp;
+            for (int c = 0; c < num_class; c++) {
+                if ((score_tensor[offset] > score_thres_i8[c]) && (score_tensor[offset] > max_score)) {
+                    max_score = score_tensor[offset];
+                    max_class_id = c;
+                }
+                offset += grid_len;
+            }
+            out_max[i * grid_w + j] = max_score;
+            out_cls[i * grid_w + j] = (int8_t)max_class_id;
+        }
+    }
+}
+
+static void list_scan(const int8_t *score_tensor, int grid_h, int grid_w, const std::vector<int> &ids, const int8_t *bars,
+                      int8_t *out_max, int8_t *out_cls)
+{
+    int grid_len = grid_h * grid_w;
+    for (int i = 0; i < grid_h; i++)
+        class_scan_row_list(score_tensor + i * grid_w, grid_len, grid_w, ids.data(), (int)ids.size(), bars, out_max + i * grid_w,
+                            out_cls + i * grid_w);
+}
+
+// 重排为 [C1, H*W, C2]; 补齐的通道填随机值, 阈值为127
+static void to_native(const std::vector<int8_t> &scores, const std::vector<int8_t> &bars, int grid_len, int num_class, int c2,
+                      std::vector<int8_t> &native, std::vector<int8_t> &native_bars, std::mt19937 &rng)
+{
+    int c1 = (num_class + c2 - 1) / c2;
+    native.resize(c1 * grid_len * c2);
+    for (size_t k = 0; k < native.size(); k++)
+        native[k] = (int8_t)(rng() & 0xFF);
+    native_bars.assign(c1 * c2, 127);
+    for (int c = 0; c < num_class; c++)
+    {
+        native_bars[c] = bars[c];
+        for (int k = 0; k < grid_len; k++)
+            native[((c / c2) * grid_len + k) * c2 + c % c2] = scores[c * grid_len + k];
+    }
+}
+
+// 含有 ids 中类别的组(升序); ids 为空时为全部组
+static std::vector<int> native_groups(const std::vector<int> &ids, int num_class, int c2)
+{
+    std::vector<int> groups;
+    int c1 = (num_class + c2 - 1) / c2;
+    for (int b = 0; b < c1; b++)
+    {
+        bool used = ids.empty();
+        for (int c : ids)
+            used |= c / c2 == b;
+        if (used)
+            groups.push_back(b);
+    }
+    return groups;
+}
+
+static void native_scan(bool simd, const int8_t *native, int grid_h, int grid_w, int num_class, int c2, const std::vector<int> &groups,
+                        const int8_t *bars, int8_t *out_max, int8_t *out_cls)
+{
+    int grid_len = grid_h * grid_w;
+    for (int i = 0; i < grid_h; i++) {
+        const int8_t *row = native + i * grid_w * c2;
+        if (simd)
+            class_scan_row_native(row, grid_len * c2, grid_w, groups.data(), (int)groups.size(), c2, bars, out_max + i * grid_w,
+                                  out_cls + i * grid_w);
+        else
+            class_scan_row_native_scalar(row, grid_len * c2, grid_w, groups.data(), (int)groups.size(), c2, bars, out_max + i * grid_w,
+                                         out_cls + i * grid_w);
+    }
+}
+
+static void row_scan(bool simd, const int8_t *score_tensor, int grid_h, int grid_w, int num_class, const int8_t *bars,
+                     int8_t *out_max, int8_t *out_cls)
+{
+    int grid_len = grid_h * grid_w;
+    for (int i = 0; i < grid_h; i++) {
+        if (simd)
+            class_scan_row(score_tensor + i * grid_w, grid_len, grid_w, num_class, bars, out_max + i * grid_w, out_cls + i * grid_w);
+        else
+            class_scan_row_scalar(score_tensor + i * grid_w, grid_len, grid_w, num_class, bars, out_max + i * grid_w, out_cls + i * grid_w);
+    }
+}
+
+// 以 zp 为0分, 大部分格子低于阈值; density 为有目标的格子比例
+static void fill_scores(std::vector<int8_t> &scores, int grid_len, int num_class, int32_t zp, int range, float density, std::mt19937 &rng)
+{
+    std::uniform_int_distribution<int> low(0, range);
+    std::uniform_real_distribution<float> unit(0, 1);
+    for (int c = 0; c < num_class; c++)
+        for (int k = 0; k < grid_len; k++)
+        {
+            int v = zp + low(rng);
+            if (unit(rng) < density / 8)
+                v += 128; // 少数类别分数高, 大部分值落在少数几个等级上, 容易出现并列
+            scores[c * grid_len + k] = (int8_t)std::max(-128, std::min(127, v));
+        }
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 200;
+    std::mt19937 rng(12345);
+    printf("class scan kernel: %s\n", class_scan_isa());
+
+    // 一致性检查
+    std::uniform_int_distribution<int> anyByte(-128, 127);
+    long long cells = 0, mismatches = 0, listMismatches = 0, nativeMismatches = 0;
+    for (int r = 0; r < rounds; r++)
+    {
+        int grid = grids[r % 3];
+        int grid_len = grid * grid;
+        int num_class = class_counts[r % 5];
+        int32_t zp = r % 4 == 0 ? anyByte(rng) : -128;
+        // 一半的轮次所有类别同一阈值, 另一半每个类别随机阈值
+        std::vector<int8_t> thres(num_class, (int8_t)anyByte(rng)), bars(num_class);
+        int8_t min_score = -zp;
+        for (int c = 0; c < num_class; c++)
+        {
+            if (r % 2 == 1)
+                thres[c] = (int8_t)anyByte(rng);
+            bars[c] = thres[c] > min_score ? thres[c] : min_score;
+        }
+        std::vector<int8_t> scores(grid_len * num_class);
+        fill_scores(scores, grid_len, num_class, zp, 1 + r % 40, 0.05f + (r % 5) * 0.2f, rng);
+
+        std::vector<int8_t> refMax(grid_len), refCls(grid_len), simdMax(grid_len), simdCls(grid_len), scalarMax(grid_len), scalarCls(grid_len);
+        original_scan(scores.data(), grid, grid, num_class, thres.data(), zp, refMax.data(), refCls.data());
+        row_scan(true, scores.data(), grid, grid, num_class, bars.data(), simdMax.data(), simdCls.data());
+        row_scan(false, scores.data(), grid, grid, num_class, bars.data(), scalarMax.data(), scalarCls.data());
+        for (int k = 0; k < grid_len; k++)
+        {
+            cells++;
+            // 只在选中类别时比较分数; 未选中时原实现保留初始值 -zp
+            bool ok = simdCls[k] == refCls[k] && scalarCls[k] == refCls[k] &&
+                      (refCls[k] < 0 || (simdMax[k] == refMax[k] && scalarMax[k] == refMax[k]));
+            if (!ok && mismatches++ < 5)
+                printf("mismatch round %d grid %d classes %d cell %d zp %d: ref %d/%d simd %d/%d scalar %d/%d\n", r, grid, num_class, k, zp,
+                       refCls[k], refMax[k], simdCls[k], simdMax[k], scalarCls[k], scalarMax[k]);
+        }
+
+        // 随机选一部分类别; 未选中的类别阈值为127时不可能通过, 整体扫描的结果应与只扫描所选类别相同
+        std::vector<int> ids;
+        std::vector<int8_t> listBars, maskedBars(num_class, 127);
+        for (int c = 0; c < num_class; c++)
+        {
+            if (rng() % 4 == 0 || (c == num_class - 1 && ids.empty()))
+            {
+                ids.push_back(c);
+                listBars.push_back(bars[c]);
+                maskedBars[c] = bars[c];
+            }
+        }
+        row_scan(true, scores.data(), grid, grid, num_class, maskedBars.data(), refMax.data(), refCls.data());
+        list_scan(scores.data(), grid, grid, ids, listBars.data(), simdMax.data(), simdCls.data());
+        for (int k = 0; k < grid_len; k++)
+        {
+            bool ok = simdCls[k] == refCls[k] && (refCls[k] < 0 || simdMax[k] == refMax[k]);
+            if (!ok && listMismatches++ < 5)
+                printf("list mismatch round %d grid %d classes %d/%d cell %d: ref %d/%d list %d/%d\n", r, grid, (int)ids.size(), num_class,
+                       k, refCls[k], refMax[k], simdCls[k], simdMax[k]);
+        }
+
+        // 原生布局: 与整体扫描(使用相同的部分类别阈值)比较; 隔一轮只读取含有所选类别的组
+        int c2 = r % 3 == 2 ? 8 : 16;
+        std::vector<int8_t> native, nativeBars;
+        to_native(scores, maskedBars, grid_len, num_class, c2, native, nativeBars, rng);
+        std::vector<int> groups = native_groups(r % 2 == 0 ? ids : std::vector<int>(), num_class, c2);
+        native_scan(true, native.data(), grid, grid, num_class, c2, groups, nativeBars.data(), simdMax.data(), simdCls.data());
+        native_scan(false, native.data(), grid, grid, num_class, c2, groups, nativeBars.data(), scalarMax.data(), scalarCls.data());
+        for (int k = 0; k < grid_len; k++)
+        {
+            bool ok = simdCls[k] == refCls[k] && scalarCls[k] == refCls[k] &&
+                      (refCls[k] < 0 || (simdMax[k] == refMax[k] && scalarMax[k] == refMax[k]));
+            if (!ok && nativeMismatches++ < 5)
+                printf("native mismatch round %d grid %d classes %d c2 %d cell %d: ref %d/%d simd %d/%d scalar %d/%d\n", r, grid,
+                       num_class, c2, k, refCls[k], refMax[k], simdCls[k], simdMax[k], scalarCls[k], scalarMax[k]);
+        }
+    }
+    printf("equivalence: %lld cells, %lld mismatches, %lld class list mismatches, %lld native layout mismatches\n", cells, mismatches,
+           listMismatches, nativeMismatches);
+
+    // 耗时: 三个输出一起算作一帧
+    const float densities[2] = {0.002f, 0.3f};
+    const char *names[2] = {"sparse", "dense"};
+    int frames = 2000;
+    const int num_class = 80;
+    std::vector<int8_t> bars(num_class, -128 + 64); // 约为0.25的量化阈值
+    std::vector<int8_t> thres(bars);
+    const std::vector<int> listIds = {0, 2, 7}; // person, car, truck
+    for (int d = 0; d < 2; d++)
+    {
+        std::vector<int8_t> scores[3], outMax[3], outCls[3], native[3], nativeBars;
+        for (int g = 0; g < 3; g++)
+        {
+            int grid_len = grids[g] * grids[g];
+            scores[g].resize(grid_len * num_class);
+            outMax[g].resize(grid_len);
+            outCls[g].resize(grid_len);
+            fill_scores(scores[g], grid_len, num_class, -128, 60, densities[d], rng);
+            to_native(scores[g], bars, grid_len, num_class, 16, native[g], nativeBars, rng);
+        }
+        // 原生布局只检测 listIds 时只读取含有这些类别的组
+        const std::vector<int> allGroups = native_groups(std::vector<int>(), num_class, 16), listGroups = native_groups(listIds, num_class, 16);
+        std::vector<int8_t> listNativeBars(nativeBars.size(), 127);
+        for (int c : listIds)
+            listNativeBars[c] = nativeBars[c];
+        double ms[6];
+        for (int v = 0; v < 6; v++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (int f = 0; f < frames; f++)
+                for (int g = 0; g < 3; g++)
+                {
+                    if (v == 0)
+                        original_scan(scores[g].data(), grids[g], grids[g], num_class, thres.data(), -128, outMax[g].data(), outCls[g].data());
+                    else if (v == 5)
+                        native_scan(true, native[g].data(), grids[g], grids[g], num_class, 16, listGroups, listNativeBars.data(), outMax[g].data(),
+                                    outCls[g].data());
+                    else if (v == 4)
+                        native_scan(true, native[g].data(), grids[g], grids[g], num_class, 16, allGroups, nativeBars.data(), outMax[g].data(),
+                                    outCls[g].data());
+                    else if (v == 3)
+                        list_scan(scores[g].data(), grids[g], grids[g], listIds, bars.data(), outMax[g].data(), outCls[g].data());
+                    else
+                        row_scan(v == 2, scores[g].data(), grids[g], grids[g], num_class, bars.data(), outMax[g].data(), outCls[g].data());
+                }
+            ms[v] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+        }
+        printf("%-6s  original %.3f ms/frame  row scalar %.3f ms/frame  row %s %.3f ms/frame (%.1fx)  3 of 80 classes %.3f ms/frame"
+               "  NC1HWC2 %.3f ms/frame  NC1HWC2 3 of 80 classes %.3f ms/frame\n",
+               names[d], ms[0], ms[1], class_scan_isa(), ms[2], ms[0] / ms[2], ms[3], ms[4], ms[5]);
+    }
+
+    if (mismatches != 0 || listMismatches != 0 || nativeMismatches != 0)
+    {
+        printf("FAIL: class scan differs from the original loop\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef BENCH_COMMON_HPP
+#define BENCH_COMMON_HPP
+
+// bench/ 下各测试程序共用的检查: 检测结果比较、堆分配计数
+
+#include <stdlib.h>
+#include <math.h>
+#include <atomic>
+
+#include "postprocess.h"
+
+// 两组检测结果是否一致: 数量和类别相同, 置信度相差不超过 prop_tol, 框的各边相差不超过 box_tol 像素;
+// 默认要求完全相同, 比较不同精度的输出(如int8与float32)时给出容差
+static inline bool same_results(const object_detect_result_list &a, const object_detect_result_list &b, float prop_tol = 0,
+                                int box_tol = 0)
+{
+    if (a.count != b.count)
+        return false;
+    for (int i = 0; i < a.count; i++)
+    {
+        const object_detect_result &x = a.results[i], &y = b.results[i];
+        if (x.cls_id != y.cls_id || fabsf(x.prop - y.prop) > prop_tol || abs(x.box.left - y.box.left) > box_tol ||
+            abs(x.box.top - y.box.top) > box_tol || abs(x.box.right - y.box.right) > box_tol ||
+            abs(x.box.bottom - y.box.bottom) > box_tol)
+            return false;
+    }
+    return true;
+}
+
+/*
+ * 堆分配计数: 通过 glibc 的内部入口替换 malloc 系列函数, operator new 及 OpenCV/运行时库的分配都会被统计到
+ * g_allocs(次数)和 g_bytes(字节数)。替换函数只能定义一次, 一个程序中只有一个编译单元在包含本文件前定义 BENCH_COUNT_ALLOCS。
+ */
+#ifdef BENCH_COUNT_ALLOCS
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t size);
+extern "C" void *__libc_memalign(size_t alignment, size_t size);
+
+static std::atomic<size_t> g_allocs(0);
+static std::atomic<size_t> g_bytes(0);
+
+static inline void count_alloc(size_t size)
+{
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+extern "C" void *malloc(size_t size)
+{
+    count_alloc(size);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size)
+{
+    count_alloc(n * size);
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *p, size_t size)
+{
+    count_alloc(size);
+    return __libc_realloc(p, size);
+}
+
+extern "C" int posix_memalign(void **p, size_t alignment, size_t size)
+{
+    count_alloc(size);
+    *p = __libc_memalign(alignment, size);
+    return *p == nullptr ? 12 /* ENOMEM */ : 0;
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size)
+{
+    count_alloc(size);
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void *memalign(size_t alignment, size_t size)
+{
+    count_alloc(size);
+    return __libc_memalign(alignment, size);
+}
+#endif
+
+#endif
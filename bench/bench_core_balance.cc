@@ -0,0 +1,225 @@
+// 核心均衡: 某个NPU核心变慢(降频或被其他进程占用)时, 把它上面的上下文迁到快核心
+// 用法: ./bench_core_balance <rknn model> [每阶段帧数] [变慢后核心2的单帧延迟(微秒)] [宽] [高]
+// 3个上下文分别绑定3个核心, 每个上下文两帧在途, 依次运行:
+//   A 各核心一样快, 开启均衡: 不应迁移任何上下文
+//   B 核心2变慢, 不开启均衡: 记录帧率和延迟
+//   C 核心2变慢, 开启均衡: 核心2上的上下文应被迁走, 帧率应高于B, 平均延迟应低于B
+//   D 接着C恢复核心2的速度: 迁空的核心重新被试用, 上下文应迁回核心2
+// 同时用 rknn_mock_get_core_stats 核对 rknnPool::getCoreStats 统计的各核心NPU执行时间。
+// 依赖 rknnrt_mock 的 rknn_mock_set_core_latency 模拟变慢的核心, 链接真实运行时时只运行A阶段
+#include <stdio.h>
+#include <stdlib.h>
+#include <dlfcn.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
+#include "opencv2/core/core.hpp"
+#include "Yolo11.hpp"
+#include "rknnPool.hpp"
+#include "rknn_mock.h"
+
+typedef int (*set_latency_fn)(int, int);
+typedef int (*core_stats_fn)(int, rknn_mock_core_stats *);
+typedef void (*reset_stats_fn)(void);
+typedef rknnPool<Yolo11, DetectionRequest, DetectionHandle> RecordPool;
+
+const int CONTEXTS = 3;
+const int BALANCE_PERIOD_MS = 200;
+
+struct Phase
+{
+    double fps;
+    double avgMs;   // 提交到按序取回的平均延迟, 包括在重排序缓冲中等待慢帧的时间
+    double maxMs;
+    int failed;
+};
+
+// 每个上下文保持两帧在途, 先运行 warmup 帧再统计 frames 帧
+static Phase run_frames(RecordPool &pool, const cv::Mat &frame, int warmup, int frames)
+{
+    const int inflight = CONTEXTS * 2;
+    DetectionRequest request;
+    request.frame = frame;
+    for (int i = 0; i < inflight; i++)
+    {
+        request.capture_time = std::chrono::steady_clock::now();
+        pool.put(request);
+    }
+    Phase phase = {0, 0, 0, 0};
+    double sumMs = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < warmup + frames; i++)
+    {
+        if (i == warmup)
+            start = std::chrono::steady_clock::now();
+        DetectionHandle record;
+        pool.get(record);
+        if (i >= warmup)
+        {
+            if (!record)
+            {
+                phase.failed++;
+            }
+            else
+            {
+                auto now = std::chrono::steady_clock::now();
+                double ms = std::chrono::duration<double, std::milli>(now - record->capture_time).count();
+                sumMs += ms;
+                phase.maxMs = std::max(phase.maxMs, ms);
+            }
+        }
+        request.capture_time = std::chrono::steady_clock::now();
+        pool.put(request);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (int i = 0; i < inflight; i++)
+    {
+        DetectionHandle record;
+        pool.get(record);
+    }
+    phase.fps = frames / seconds;
+    phase.avgMs = frames > phase.failed ? sumMs / (frames - phase.failed) : 0;
+    return phase;
+}
+
+static void print_phase(const char *name, const Phase &phase, RecordPool &pool)
+{
+    printf("%-28s %7.1f fps  latency avg %6.1f ms max %6.1f ms  contexts/core", name, phase.fps, phase.avgMs, phase.maxMs);
+    for (const rknnCoreStats &core : pool.getCoreStats())
+        printf(" %d", core.contexts);
+    printf("\n");
+}
+
+static int init_pool(RecordPool &pool, bool balance)
+{
+    pool.setCoreBalancer(balance, BALANCE_PERIOD_MS);
+    if (pool.init() != 0)
+    {
+        printf("rknnPool init fail!\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <rknn model> [frames] [slow core latency us] [width] [height]\n", argv[0]);
+        return -1;
+    }
+    int frames = argc > 2 ? atoi(argv[2]) : 300;
+    int slowUs = argc > 3 ? atoi(argv[3]) : 80000;
+    int width = argc > 4 ? atoi(argv[4]) : 640;
+    int height = argc > 5 ? atoi(argv[5]) : 480;
+
+    set_latency_fn set_latency = (set_latency_fn)dlsym(RTLD_DEFAULT, "rknn_mock_set_core_latency");
+    core_stats_fn get_core_stats = (core_stats_fn)dlsym(RTLD_DEFAULT, "rknn_mock_get_core_stats");
+    reset_stats_fn reset_stats = (reset_stats_fn)dlsym(RTLD_DEFAULT, "rknn_mock_reset_stats");
+
+    cv::Mat frame(height, width, CV_8UC3);
+    for (int y = 0; y < height; y++)
+    {
+        unsigned char *row = frame.ptr(y);
+        for (int x = 0; x < width * 3; x++)
+            row[x] = (unsigned char)(x * 7 + y * 3);
+    }
+
+    int failures = 0;
+    // A: 各核心一样快
+    {
+        RecordPool pool(argv[1], CONTEXTS);
+        if (init_pool(pool, true) != 0)
+            return -1;
+        if (pool.getModel(0)->get_npu_cores() < 3)
+        {
+            printf("needs 3 NPU cores\nFAIL\n");
+            return 1;
+        }
+        if (reset_stats != NULL)
+            reset_stats();
+        Phase a = run_frames(pool, frame, 0, frames);
+        print_phase("A equal cores, balancer", a, pool);
+        std::vector<rknnCoreStats> cores = pool.getCoreStats();
+        for (size_t c = 0; c < cores.size(); c++)
+        {
+            if (cores[c].movedOut != 0)
+            {
+                printf("  balancer moved a context off core %zu although all cores are equal\n", c);
+                failures++;
+            }
+            // 池统计的NPU执行时间应与运行时的核心忙碌时间一致
+            rknn_mock_core_stats mock;
+            if (get_core_stats != NULL && get_core_stats((int)c, &mock) == 0)
+            {
+                double mockMs = mock.busy_us / 1000.0;
+                printf("  core %zu: pool busy %8.1f ms (%3.0f%%), runtime busy %8.1f ms, %lld runs\n", c, cores[c].busyMs,
+                       cores[c].utilization * 100, mockMs, cores[c].runs);
+                if (fabs(cores[c].busyMs - mockMs) > mockMs * 0.05 + 1 || cores[c].runs != (long long)mock.runs)
+                {
+                    printf("  core %zu counters disagree with the runtime\n", c);
+                    failures++;
+                }
+            }
+        }
+        failures += a.failed;
+    }
+
+    if (set_latency == NULL)
+    {
+        printf("runtime cannot slow down a core, skipping B-D\n");
+    }
+    else
+    {
+        rknn_mock_core_stats normal;
+        get_core_stats(0, &normal);
+        set_latency(2, slowUs);
+        Phase b, c, d;
+        {
+            RecordPool pool(argv[1], CONTEXTS);
+            if (init_pool(pool, false) != 0)
+                return -1;
+            b = run_frames(pool, frame, frames / 4, frames);
+            print_phase("B core 2 slow, no balancer", b, pool);
+        }
+        {
+            RecordPool pool(argv[1], CONTEXTS);
+            if (init_pool(pool, true) != 0)
+                return -1;
+            // 预热期间均衡器完成迁移
+            c = run_frames(pool, frame, frames / 4, frames);
+            print_phase("C core 2 slow, balancer", c, pool);
+            std::vector<rknnCoreStats> cores = pool.getCoreStats();
+            if (cores[2].movedOut == 0)
+            {
+                printf("  balancer did not move the context off the slow core\n");
+                failures++;
+            }
+            if (c.fps <= b.fps || c.avgMs >= b.avgMs)
+            {
+                printf("  balancing did not help: %.1f vs %.1f fps, %.1f vs %.1f ms\n", c.fps, b.fps, c.avgMs, b.avgMs);
+                failures++;
+            }
+
+            set_latency(2, normal.latency_us);
+            d = run_frames(pool, frame, 0, frames * 2);
+            print_phase("D core 2 recovered", d, pool);
+            cores = pool.getCoreStats();
+            if (cores[2].movedIn == 0)
+            {
+                printf("  no context moved back to the recovered core\n");
+                failures++;
+            }
+        }
+        failures += b.failed + c.failed + d.failed;
+    }
+
+    if (failures != 0)
+    {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,248 @@
+// NPU核心分配策略(single/multi/mixed/auto)的单帧延迟与吞吐对比, 以及大小模型分占核心的场景
+// 用法: ./bench_core_strategy <rknn model> [每组帧数] [上下文数] [宽] [高]
+// 每种策略建一个 rknnPool<Yolo11, DetectionRequest, DetectionHandle>, 先逐帧提交测单帧延迟, 再保持每个上下文一帧在途测吞吐;
+// 之后模拟"大模型占用核心0/1联合推理、小模型只用核心2"的部署: 两个池同时运行, 比较大模型池的单帧延迟与两池都用默认策略时的差别。
+// 各策略检测结果不一致、多核策略延迟不低于单核策略, 或分占核心时帧落到了其他核心上时返回非0。
+// 无NPU主机上配合 -DRKNN_USE_MOCK=ON 使用; RKNN_MOCK_CORES 可模拟双核/单核平台, 检查核心数检测和策略退化
+#include <stdio.h>
+#include <stdlib.h>
+#include <dlfcn.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "opencv2/core/core.hpp"
+#include "Yolo11.hpp"
+#include "rknnPool.hpp"
+#include "rknn_mock.h"
+
+typedef int (*core_stats_fn)(int, rknn_mock_core_stats *);
+typedef void (*reset_stats_fn)(void);
+typedef rknnPool<Yolo11, DetectionRequest, DetectionHandle> RecordPool;
+
+struct Result
+{
+    double latencyMs; // 只有一帧在途时 put 到 get 的平均耗时
+    double fps;       // 每个上下文一帧在途时的帧率
+    double detections;
+    int failed;
+};
+
+// 逐帧提交, 每次只有一帧在途
+static double measure_latency(RecordPool &pool, const cv::Mat &frame, int frames, Result *result)
+{
+    DetectionRequest request;
+    request.frame = frame;
+    long long detections = 0;
+    int failed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        request.frame_id = i;
+        pool.put(request);
+        DetectionHandle record;
+        pool.get(record);
+        if (record)
+            detections += record->count();
+        else
+            failed++;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+    if (result != NULL)
+    {
+        result->detections = (double)detections / frames;
+        result->failed = failed;
+    }
+    return ms;
+}
+
+// 每个上下文保持一帧在途
+static double measure_fps(RecordPool &pool, int contexts, const cv::Mat &frame, int frames)
+{
+    DetectionRequest request;
+    request.frame = frame;
+    for (int i = 0; i < contexts; i++)
+        pool.put(request);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++)
+    {
+        DetectionHandle record;
+        pool.get(record);
+        pool.put(request);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (int i = 0; i < contexts; i++)
+    {
+        DetectionHandle record;
+        pool.get(record);
+    }
+    return frames / seconds;
+}
+
+static void print_masks(RecordPool &pool)
+{
+    for (const rknnModelStats &stats : pool.getModelStats())
+        printf(" 0x%x", stats.coreMask);
+}
+
+// 大模型池单帧延迟; 同时由另一个线程让小模型池的每个上下文保持一帧在途
+static int run_shared(const char *model, int frames, const cv::Mat &frame, rknnCoreStrategy bigStrategy, rknn_core_mask bigCores,
+                      rknnCoreStrategy smallStrategy, rknn_core_mask smallCores, double &latencyMs, int &bigMask, int &smallMask)
+{
+    RecordPool big(model, 1);
+    RecordPool small(model, 2);
+    big.setCoreStrategy(bigStrategy, bigCores);
+    small.setCoreStrategy(smallStrategy, smallCores);
+    if (big.init() != 0 || small.init() != 0)
+    {
+        printf("rknnPool init fail!\n");
+        return -1;
+    }
+    bigMask = 0;
+    smallMask = 0;
+    for (const rknnModelStats &stats : big.getModelStats())
+        bigMask |= stats.coreMask;
+    for (const rknnModelStats &stats : small.getModelStats())
+        smallMask |= stats.coreMask;
+
+    std::atomic<bool> stop(false);
+    std::thread filler([&]()
+                       {
+        DetectionRequest request;
+        request.frame = frame;
+        for (int i = 0; i < 2; i++)
+            small.put(request);
+        while (!stop)
+        {
+            DetectionHandle record;
+            small.get(record);
+            small.put(request);
+        }
+        for (int i = 0; i < 2; i++)
+        {
+            DetectionHandle record;
+            small.get(record);
+        } });
+    measure_latency(big, frame, 5, NULL);
+    latencyMs = measure_latency(big, frame, frames, NULL);
+    stop = true;
+    filler.join();
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <rknn model> [frames] [contexts] [width] [height]\n", argv[0]);
+        return -1;
+    }
+    int frames = argc > 2 ? atoi(argv[2]) : 200;
+    int contexts = argc > 3 ? atoi(argv[3]) : 3;
+    int width = argc > 4 ? atoi(argv[4]) : 640;
+    int height = argc > 5 ? atoi(argv[5]) : 480;
+
+    // 只有 rknnrt_mock 导出核心统计, 链接真实运行时不检查帧落在哪些核心上
+    core_stats_fn get_core_stats = (core_stats_fn)dlsym(RTLD_DEFAULT, "rknn_mock_get_core_stats");
+    reset_stats_fn reset_stats = (reset_stats_fn)dlsym(RTLD_DEFAULT, "rknn_mock_reset_stats");
+
+    cv::Mat frame(height, width, CV_8UC3);
+    for (int y = 0; y < height; y++)
+    {
+        unsigned char *row = frame.ptr(y);
+        for (int x = 0; x < width * 3; x++)
+            row[x] = (unsigned char)(x * 7 + y * 3);
+    }
+
+    const rknnCoreStrategy strategies[4] = {rknnCoreStrategy::SINGLE, rknnCoreStrategy::MULTI, rknnCoreStrategy::MIXED,
+                                            rknnCoreStrategy::AUTO};
+    const char *names[4] = {"single", "multi", "mixed", "auto"};
+    Result results[4];
+    int failures = 0;
+    int cores = 0;
+    printf("strategy  latency ms  fps      core masks\n");
+    for (int s = 0; s < 4; s++)
+    {
+        RecordPool pool(argv[1], contexts);
+        pool.setCoreStrategy(strategies[s]);
+        if (pool.init() != 0)
+        {
+            printf("rknnPool init fail!\n");
+            return -1;
+        }
+        cores = pool.getModel(0)->get_npu_cores();
+        Result &r = results[s];
+        measure_latency(pool, frame, 5, NULL);
+        r.latencyMs = measure_latency(pool, frame, frames, &r);
+        r.fps = measure_fps(pool, contexts, frame, frames);
+        printf("%-8s  %10.2f  %7.1f ", names[s], r.latencyMs, r.fps);
+        print_masks(pool);
+        printf("\n");
+        if (r.failed != 0)
+        {
+            printf("  %d frames failed\n", r.failed);
+            failures++;
+        }
+        if (r.detections != results[0].detections)
+        {
+            printf("  detections differ from single: %.2f vs %.2f per frame\n", r.detections, results[0].detections);
+            failures++;
+        }
+    }
+    printf("NPU cores detected: %d\n", cores);
+    // 多核平台上联合推理应降低单帧延迟
+    if (cores > 1 && results[1].latencyMs >= results[0].latencyMs)
+    {
+        printf("  multi-core latency is not lower than single-core\n");
+        failures++;
+    }
+
+    if (cores >= 3)
+    {
+        // 大模型池单独占用核心0/1联合推理, 小模型池只用核心2
+        double sharedMs, splitMs;
+        int bigMask, smallMask, unused;
+        if (run_shared(argv[1], frames, frame, rknnCoreStrategy::SINGLE, RKNN_NPU_CORE_AUTO, rknnCoreStrategy::SINGLE,
+                       RKNN_NPU_CORE_AUTO, sharedMs, unused, unused) != 0)
+            return -1;
+        if (reset_stats != NULL)
+            reset_stats();
+        if (run_shared(argv[1], frames, frame, rknnCoreStrategy::MULTI, RKNN_NPU_CORE_0_1, rknnCoreStrategy::SINGLE,
+                       RKNN_NPU_CORE_2, splitMs, bigMask, smallMask) != 0)
+            return -1;
+        printf("big model latency while small models run: default %.2f ms, big on cores 0+1 / small on core 2 %.2f ms\n", sharedMs,
+               splitMs);
+        if (bigMask != RKNN_NPU_CORE_0_1 || smallMask != RKNN_NPU_CORE_2)
+        {
+            printf("  unexpected core masks: big 0x%x, small 0x%x\n", bigMask, smallMask);
+            failures++;
+        }
+        if (get_core_stats != NULL)
+        {
+            // 大模型的帧同时占用核心0和1, 小模型的帧只在核心2上
+            rknn_mock_core_stats c[3];
+            for (int i = 0; i < 3; i++)
+                get_core_stats(i, &c[i]);
+            printf("core runs: %llu %llu %llu\n", (unsigned long long)c[0].runs, (unsigned long long)c[1].runs,
+                   (unsigned long long)c[2].runs);
+            if (c[0].runs != c[1].runs || c[0].runs != (uint64_t)frames + 5)
+            {
+                printf("  big model frames ran outside cores 0+1\n");
+                failures++;
+            }
+        }
+        if (splitMs >= sharedMs)
+        {
+            printf("  dedicated cores did not lower big model latency\n");
+            failures++;
+        }
+    }
+
+    if (failures != 0)
+    {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,183 @@
+// 原生输出解码与 want_float 输出解码的对比
+// 用法: ./bench_decode <rknn model> [帧数]
+// 同一模型初始化两次: 一次按原生格式读取输出(int8查表解码或fp16直接转换), 一次让运行时转换为float32,
+// 分别统计 run(含输出获取)和 postprocess 的耗时, 并检查两者的检测结果一致(同类别, 坐标差<=2像素, 置信度差<=2e-3)。
+// 另外逐个检查全部65536个半精度值的转换结果。任一检查不通过时返回非0。
+// 在主机上用 rknnrt_mock 时, RKNN_MOCK_OUTPUT_TYPE=fp16/fp32 得到混合精度模型, 可与默认的int8模型对比;
+// RKNN_MOCK_CORE_LATENCY_US=0 时 run 的耗时只剩输出拷贝和转换
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "opencv2/core/core.hpp"
+#include "Yolo11.hpp"
+#include "bench_common.hpp"
+
+static const char *type_name(OutputType type)
+{
+    switch (type)
+    {
+    case OutputType::INT8:
+        return "int8";
+    case OutputType::FP16:
+        return "fp16";
+    default:
+        return "fp32";
+    }
+}
+
+static float reference_half(uint16_t h)
+{
+    int exp = (h >> 10) & 0x1f;
+    int mant = h & 0x3ff;
+    float f;
+    if (exp == 0)
+        f = ldexpf((float)mant, -24);
+    else if (exp == 31)
+        f = mant ? NAN : INFINITY;
+    else
+        f = ldexpf((float)(mant | 0x400), exp - 25);
+    return (h & 0x8000) ? -f : f;
+}
+
+static double since_ms(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+struct Variant
+{
+    Yolo11 *model;
+    std::vector<std::vector<uint8_t>> bufs;
+    std::vector<rknn_output> outputs;
+    post_process_buffers post;
+    object_detect_result_list results;
+    double runMs = 0;
+    double postMs = 0;
+};
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <rknn model> [frames]\n", argv[0]);
+        return -1;
+    }
+    int frames = argc > 2 ? atoi(argv[2]) : 200;
+    int failures = 0;
+
+    // 半精度转换
+    std::vector<uint16_t> halves(65536);
+    std::vector<float> converted(65536);
+    for (int i = 0; i < 65536; i++)
+        halves[i] = (uint16_t)i;
+    fp16_to_fp32(halves.data(), converted.data(), 65536);
+    int badHalf = 0;
+    for (int i = 0; i < 65536; i++)
+    {
+        float ref = reference_half((uint16_t)i);
+        bool ok = isnan(ref) ? isnan(converted[i]) : memcmp(&ref, &converted[i], sizeof(float)) == 0;
+        if (!ok && badHalf++ < 5)
+            printf("fp16 0x%04x: got %g, expected %g\n", i, converted[i], ref);
+    }
+    printf("fp16 convert (%s): %d of 65536 values differ\n", fp16_convert_isa(), badHalf);
+    failures += badHalf != 0;
+
+    // 80类 x 80x80 的分数张量整体转换一次的耗时
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<int> anyHalf(0, 0x7bff);
+    std::vector<uint16_t> plane(80 * 80 * 80);
+    std::vector<float> planeOut(plane.size());
+    for (auto &v : plane)
+        v = (uint16_t)anyHalf(rng);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < 50; r++)
+        fp16_to_fp32(plane.data(), planeOut.data(), (int)plane.size());
+    printf("fp16 convert 80x80x80: %.3f ms\n", since_ms(t0) / 50);
+
+    // 原生输出与 want_float 输出, 输出格式在 init 时确定
+    Yolo11Options floatOptions;
+    floatOptions.want_float = true;
+    Yolo11 native(argv[1]);
+    Yolo11 forced(argv[1], floatOptions);
+    if (native.init(nullptr, false) != 0)
+    {
+        printf("Yolo11 init fail!\n");
+        return -1;
+    }
+    int ret = forced.init(native.get_pctx(), true);
+    if (ret != 0)
+    {
+        printf("Yolo11 init fail!\n");
+        return -1;
+    }
+
+    cv::Mat frame(1080, 1920, CV_8UC3), input;
+    for (int y = 0; y < frame.rows; y++)
+    {
+        unsigned char *row = frame.ptr(y);
+        for (int x = 0; x < frame.cols * 3; x++)
+            row[x] = (unsigned char)(x * 7 + y * 3);
+    }
+    BOX_RECT letterBox;
+    if (native.preprocess(frame, input, letterBox) != 0)
+    {
+        printf("preprocess fail!\n");
+        return -1;
+    }
+
+    Variant variants[2];
+    variants[0].model = &native;
+    variants[1].model = &forced;
+    for (Variant &v : variants)
+    {
+        if (v.model->prepare_outputs(v.bufs, v.outputs) != 0)
+            return -1;
+    }
+
+    int mismatched = 0;
+    for (int f = 0; f < frames; f++)
+    {
+        for (Variant &v : variants)
+        {
+            t0 = std::chrono::steady_clock::now();
+            if (v.model->run(input, v.outputs.data()) != 0)
+            {
+                printf("run fail!\n");
+                return -1;
+            }
+            v.runMs += since_ms(t0);
+            t0 = std::chrono::steady_clock::now();
+            v.model->postprocess(v.outputs.data(), letterBox, &v.results, &v.post);
+            v.postMs += since_ms(t0);
+        }
+        if (!same_results(variants[0].results, variants[1].results, 2e-3f, 2) && mismatched++ == 0)
+            printf("frame %d: %s decode found %d boxes, fp32 decode found %d\n", f, type_name(native.get_output_type()),
+                   variants[0].results.count, variants[1].results.count);
+    }
+    failures += mismatched != 0;
+
+    size_t bytes[2] = {0, 0};
+    for (int k = 0; k < 2; k++)
+        for (const rknn_output &o : variants[k].outputs)
+            bytes[k] += o.size;
+    for (int k = 0; k < 2; k++)
+    {
+        const Variant &v = variants[k];
+        printf("  %-4s outputs %7.1f KB  run %6.3f ms  postprocess %6.3f ms  detections %d\n",
+               type_name(v.model->get_output_type()), bytes[k] / 1024.0, v.runMs / frames, v.postMs / frames, v.results.count);
+    }
+    printf("  %d of %d frames differ\n", mismatched, frames);
+
+    if (failures != 0)
+    {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,99 @@
+// DFL解码的微基准: 逐值反量化 + exp 与 按张量查表 + 向量化求期望 对比
+// 用法: ./bench_dfl [重复次数]
+// 在80x80的int8框张量上按不同候选框数量计时, 并检查两者结果的最大误差, 超过1e-3时返回非0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <stdint.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "postprocess.h"
+
+// 原 process_i8 中的解码方式
+static void reference_dfl(const int8_t *box_cell, int grid_len, int dfl_len, int32_t zp, float scale, float *box)
+{
+    float tensor[dfl_len * 4];
+    for (int k = 0; k < dfl_len * 4; k++)
+        tensor[k] = ((float)box_cell[k * grid_len] - (float)zp) * scale;
+    for (int b = 0; b < 4; b++)
+    {
+        float exp_t[dfl_len];
+        float exp_sum = 0;
+        float acc_sum = 0;
+        for (int i = 0; i < dfl_len; i++)
+        {
+            exp_t[i] = exp(tensor[i + b * dfl_len]);
+            exp_sum += exp_t[i];
+        }
+        for (int i = 0; i < dfl_len; i++)
+            acc_sum += exp_t[i] / exp_sum * i;
+        box[b] = acc_sum;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int repeat = argc > 1 ? atoi(argv[1]) : 20;
+    const int grid = 80, grid_len = grid * grid, dfl_len = 16;
+    const int32_t zp = -58;
+    const float scale = 0.0927f;
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> byte(-128, 127);
+    std::vector<int8_t> tensor(grid_len * dfl_len * 4);
+    for (auto &v : tensor)
+        v = (int8_t)byte(rng);
+    float lut[256];
+    build_dfl_exp_lut(zp, scale, lut);
+
+    // 一致性
+    float maxDiff = 0;
+    for (int cell = 0; cell < grid_len; cell++)
+    {
+        float a[4], b[4];
+        reference_dfl(&tensor[cell], grid_len, dfl_len, zp, scale, a);
+        compute_dfl_i8(&tensor[cell], grid_len, dfl_len, lut, b);
+        for (int k = 0; k < 4; k++)
+            maxDiff = std::max(maxDiff, fabsf(a[k] - b[k]));
+    }
+    printf("max abs diff over %d cells: %.2e\n", grid_len, maxDiff);
+
+    // 耗时: 候选框越多两者差距越明显
+    const int counts[4] = {16, 256, 2048, grid_len};
+    volatile float sink = 0;
+    for (int n : counts)
+    {
+        std::vector<int> cells(n);
+        for (int i = 0; i < n; i++)
+            cells[i] = (int)((long long)i * grid_len / n);
+        double ns[2];
+        for (int v = 0; v < 2; v++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < repeat; r++)
+                for (int cell : cells)
+                {
+                    float box[4];
+                    if (v == 0)
+                        reference_dfl(&tensor[cell], grid_len, dfl_len, zp, scale, box);
+                    else
+                        compute_dfl_i8(&tensor[cell], grid_len, dfl_len, lut, box);
+                    sink = sink + box[0];
+                }
+            ns[v] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ((double)repeat * n);
+        }
+        printf("%5d candidates  exp %7.1f ns/box  lut %6.1f ns/box (%.1fx)  lut total %.3f ms\n", n, ns[0], ns[1], ns[0] / ns[1],
+               ns[1] * n / 1e6);
+    }
+
+    if (!(maxDiff <= 1e-3f))
+    {
+        printf("FAIL: lut decode differs from exp decode by %.2e\n", maxDiff);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,104 @@
+// Yolo11::detect 稳态堆分配检查: 预热后逐帧统计 malloc 系列调用次数, 不为0时返回非0
+// 同样检查返回检测记录的 Yolo11::infer(DetectionRequest) (含记录归还到池)
+// 用法: ./bench_infer <rknn model> [帧数] [宽] [高]
+// 无NPU主机上配合 -DRKNN_USE_MOCK=ON 使用, 合成输出的候选框密度由 RKNN_MOCK_DENSITY 控制
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+
+#include "opencv2/core/core.hpp"
+#include "Yolo11.hpp"
+// 统计 malloc 系列调用(含 OpenCV/运行时库)
+#define BENCH_COUNT_ALLOCS
+#include "bench_common.hpp"
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <rknn model> [frames] [width] [height]\n", argv[0]);
+        return -1;
+    }
+    int frames = argc > 2 ? atoi(argv[2]) : 200;
+    int width = argc > 3 ? atoi(argv[3]) : 1920;
+    int height = argc > 4 ? atoi(argv[4]) : 1080;
+
+    Yolo11 model(argv[1]);
+    if (model.init(nullptr, false) != 0)
+    {
+        printf("Yolo11 init fail!\n");
+        return -1;
+    }
+
+    cv::Mat frame(height, width, CV_8UC3);
+    for (int y = 0; y < height; y++)
+    {
+        unsigned char *row = frame.ptr(y);
+        for (int x = 0; x < width * 3; x++)
+            row[x] = (unsigned char)(x * 7 + y * 3);
+    }
+
+    // 预热: 各缓冲增长到稳定容量
+    object_detect_result_list results;
+    for (int i = 0; i < 10; i++)
+        model.detect(frame, &results);
+
+    size_t allocsBefore = g_allocs.load();
+    size_t bytesBefore = g_bytes.load();
+    auto start = std::chrono::steady_clock::now();
+    int detections = 0;
+    for (int i = 0; i < frames; i++)
+    {
+        if (model.detect(frame, &results) != 0)
+        {
+            printf("detect fail!\n");
+            return -1;
+        }
+        detections += results.count;
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t allocs = g_allocs.load() - allocsBefore;
+    size_t bytes = g_bytes.load() - bytesBefore;
+
+    printf("detect   frames=%d  %.2f ms/frame  detections/frame=%.1f  allocs/frame=%.2f  bytes/frame=%.0f\n",
+           frames, sec * 1e3 / frames, (double)detections / frames, (double)allocs / frames, (double)bytes / frames);
+
+    // 检测记录: 同时持有两帧的记录, 模拟消费者晚一帧归还
+    DetectionRequest request;
+    request.frame = frame;
+    DetectionHandle previous;
+    for (int i = 0; i < 10; i++)
+        previous = model.infer(request);
+    allocsBefore = g_allocs.load();
+    bytesBefore = g_bytes.load();
+    start = std::chrono::steady_clock::now();
+    int recordDetections = 0;
+    for (int i = 0; i < frames; i++)
+    {
+        request.frame_id = i;
+        request.capture_time = std::chrono::steady_clock::now();
+        DetectionHandle record = model.infer(request);
+        if (!record || record->frame_id != i)
+        {
+            printf("infer fail!\n");
+            return -1;
+        }
+        recordDetections += record->count();
+        previous = std::move(record);
+    }
+    sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t recordAllocs = g_allocs.load() - allocsBefore;
+    bytes = g_bytes.load() - bytesBefore;
+    printf("records  frames=%d  %.2f ms/frame  detections/frame=%.1f  allocs/frame=%.2f  bytes/frame=%.0f\n",
+           frames, sec * 1e3 / frames, (double)recordDetections / frames, (double)recordAllocs / frames, (double)bytes / frames);
+
+    if (allocs != 0 || recordAllocs != 0 || recordDetections != detections)
+    {
+        printf("FAIL: %zu/%zu heap allocations in steady state, %d/%d detections\n", allocs, recordAllocs, detections, recordDetections);
+        return 1;
+    }
+    printf("PASS: no heap allocations in steady state\n");
+    return 0;
+}
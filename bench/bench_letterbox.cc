@@ -0,0 +1,173 @@
+// 拉伸与letterbox两种预处理的精度/吞吐对比
+// 用法: ./bench_letterbox <rknn model> [视频路径] [帧数]
+// 不给视频时使用合成的1920x1080画面; 每帧分别用两种方式检测, 输出预处理/整帧耗时、检测数、平均置信度,
+// 以及两种方式检测结果的一致率(同类别且IoU>=0.5)。没有标注数据, 置信度与一致率只作为精度的参考。
+// 同时检查letterbox的填充量与还原比例能把模型输入的内部区域准确映射回原图, 不符时返回非0
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/videoio.hpp"
+#include "Yolo11.hpp"
+
+struct ModeStats
+{
+    const char *name;
+    double preMs = 0;
+    double detectMs = 0;
+    long long detections = 0;
+    double confSum = 0;
+};
+
+static float iou(const BOX_RECT &a, const BOX_RECT &b)
+{
+    float w = std::min(a.right, b.right) - std::max(a.left, b.left);
+    float h = std::min(a.bottom, b.bottom) - std::max(a.top, b.top);
+    if (w <= 0 || h <= 0)
+        return 0;
+    float inter = w * h;
+    float areaA = (float)(a.right - a.left) * (a.bottom - a.top);
+    float areaB = (float)(b.right - b.left) * (b.bottom - b.top);
+    return inter / (areaA + areaB - inter);
+}
+
+// 统计 a 中能在 b 里找到同类别且IoU>=0.5的检测框数量
+static int matched(const object_detect_result_list &a, const object_detect_result_list &b)
+{
+    int count = 0;
+    for (int i = 0; i < a.count; i++)
+    {
+        for (int j = 0; j < b.count; j++)
+        {
+            if (a.results[i].cls_id == b.results[j].cls_id && iou(a.results[i].box, b.results[j].box) >= 0.5f)
+            {
+                count++;
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+static double since_ms(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <rknn model> [video] [frames]\n", argv[0]);
+        return -1;
+    }
+    int frames = argc > 3 ? atoi(argv[3]) : 200;
+
+    Yolo11 model(argv[1]);
+    if (model.init(nullptr, false) != 0)
+    {
+        printf("Yolo11 init fail!\n");
+        return -1;
+    }
+
+    cv::VideoCapture capture;
+    cv::Mat frame;
+    if (argc > 2)
+    {
+        if (!capture.open(argv[2]))
+        {
+            printf("open %s fail!\n", argv[2]);
+            return -1;
+        }
+    }
+    else
+    {
+        frame.create(1080, 1920, CV_8UC3);
+        for (int y = 0; y < frame.rows; y++)
+        {
+            unsigned char *row = frame.ptr(y);
+            for (int x = 0; x < frame.cols * 3; x++)
+                row[x] = (unsigned char)(x * 7 + y * 3);
+        }
+    }
+
+    ModeStats modes[2];
+    modes[0].name = "stretch";
+    modes[1].name = "letterbox";
+    ResizeMode modeIds[2] = {ResizeMode::STRETCH, ResizeMode::LETTERBOX};
+    object_detect_result_list results[2];
+    cv::Mat input;
+    BOX_RECT letterBox;
+    long long agreeStretch = 0, agreeLetterbox = 0;
+    int bad = 0, done = 0;
+
+    for (int i = 0; i < frames; i++)
+    {
+        if (capture.isOpened() && (!capture.read(frame) || frame.empty()))
+            break;
+        for (int m = 0; m < 2; m++)
+        {
+            model.set_resize_mode(modeIds[m]);
+            auto t0 = std::chrono::steady_clock::now();
+            if (model.preprocess(frame, input, letterBox) != 0)
+            {
+                printf("preprocess fail!\n");
+                return -1;
+            }
+            modes[m].preMs += since_ms(t0);
+
+            // 内部区域经还原比例放大后应与原图尺寸一致(误差不超过1像素)
+            float rawW = (model.get_model_width() - letterBox.left - letterBox.right) * letterBox.scale_w;
+            float rawH = (model.get_model_height() - letterBox.top - letterBox.bottom) * letterBox.scale_h;
+            if (fabsf(rawW - frame.cols) > 1 || fabsf(rawH - frame.rows) > 1)
+            {
+                if (bad++ == 0)
+                    printf("%s: pads l%d r%d t%d b%d scale %.4f/%.4f map back to %.1fx%.1f, expected %dx%d\n",
+                           modes[m].name, letterBox.left, letterBox.right, letterBox.top, letterBox.bottom,
+                           letterBox.scale_w, letterBox.scale_h, rawW, rawH, frame.cols, frame.rows);
+            }
+
+            t0 = std::chrono::steady_clock::now();
+            if (model.detect(frame, &results[m]) != 0)
+            {
+                printf("detect fail!\n");
+                return -1;
+            }
+            modes[m].detectMs += since_ms(t0);
+            modes[m].detections += results[m].count;
+            for (int k = 0; k < results[m].count; k++)
+                modes[m].confSum += results[m].results[k].prop;
+        }
+        agreeStretch += matched(results[0], results[1]);
+        agreeLetterbox += matched(results[1], results[0]);
+        done++;
+    }
+    if (done == 0)
+    {
+        printf("no frames\n");
+        return -1;
+    }
+
+    printf("%dx%d -> %dx%d, %d frames\n", frame.cols, frame.rows, model.get_model_width(), model.get_model_height(), done);
+    for (int m = 0; m < 2; m++)
+    {
+        const ModeStats &s = modes[m];
+        printf("  %-9s  preprocess %6.2f ms  detect %6.2f ms (%.1f fps)  detections/frame %5.2f  mean conf %.3f\n",
+               s.name, s.preMs / done, s.detectMs / done, done * 1000.0 / s.detectMs, (double)s.detections / done,
+               s.detections > 0 ? s.confSum / s.detections : 0.0);
+    }
+    printf("  agreement: %.1f%% of stretch boxes found by letterbox, %.1f%% of letterbox boxes found by stretch\n",
+           modes[0].detections > 0 ? 100.0 * agreeStretch / modes[0].detections : 0.0,
+           modes[1].detections > 0 ? 100.0 * agreeLetterbox / modes[1].detections : 0.0);
+    if (bad > 0)
+    {
+        printf("FAIL: %d frames with inconsistent letterbox mapping\n", bad);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
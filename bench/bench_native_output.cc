@@ -0,0 +1,155 @@
+// NCHW 输出(rknn_outputs_get 拷贝到预分配缓冲)与原生 NC1HWC2 布局输出(rknn_set_io_mem 绑定, 直接解码)的对比
+// 用法: ./bench_native_output <rknn model> [帧数] [宽] [高]
+// 同一int8模型初始化两次, 逐帧统计 detect 的耗时, 分别在解码所有类别和只解码3个类别时比较检测结果;
+// 链接 rknnrt_mock 时还读取运行时每帧拷贝(及转换)的输出字节数, 原生布局时应为0。
+// 检测结果不一致、原生布局仍有输出拷贝或模型不支持原生布局时返回非0。
+// RKNN_MOCK_DENSITY 调高时通过阈值的格子增多, 解码耗时占比更大
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <dlfcn.h>
+#include <chrono>
+
+#include "opencv2/core/core.hpp"
+#include "Yolo11.hpp"
+#include "rknn_mock.h"
+#include "bench_common.hpp"
+
+typedef int (*io_stats_fn)(rknn_mock_io_stats *);
+
+struct Variant
+{
+    const char *name;
+    Yolo11 *model;
+    object_detect_result_list results;
+    double ms;
+    rknn_mock_io_stats io;
+};
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <rknn model> [frames] [width] [height]\n", argv[0]);
+        return -1;
+    }
+    int frames = argc > 2 ? atoi(argv[2]) : 200;
+    int width = argc > 3 ? atoi(argv[3]) : 1920;
+    int height = argc > 4 ? atoi(argv[4]) : 1080;
+
+    // 只有 rknnrt_mock 导出拷贝统计, 链接真实运行时只比较耗时和结果
+    io_stats_fn get_io_stats = (io_stats_fn)dlsym(RTLD_DEFAULT, "rknn_mock_get_io_stats");
+    if (get_io_stats == NULL)
+        printf("runtime has no copy counters, comparing time and results only\n");
+
+    Yolo11Options nativeOptions;
+    nativeOptions.native_output = true;
+    Yolo11 nchw(argv[1]);
+    Yolo11 native(argv[1], nativeOptions);
+    if (nchw.init(nullptr, false) != 0)
+    {
+        printf("Yolo11 init fail!\n");
+        return -1;
+    }
+    int ret = native.init(nchw.get_pctx(), true);
+    if (ret != 0)
+    {
+        printf("Yolo11 init fail!\n");
+        return -1;
+    }
+    if (!native.get_native_output())
+    {
+        printf("model has no int8 NC1HWC2 outputs\nFAIL\n");
+        return 1;
+    }
+    // 第1路只解码 person/car/truck
+    const std::vector<int> listIds = {0, 2, 7};
+    nchw.set_stream_classes(1, listIds);
+    native.set_stream_classes(1, listIds);
+
+    cv::Mat frame(height, width, CV_8UC3);
+    for (int y = 0; y < height; y++)
+    {
+        unsigned char *row = frame.ptr(y);
+        for (int x = 0; x < width * 3; x++)
+            row[x] = (unsigned char)(x * 7 + y * 3);
+    }
+
+    int failures = 0;
+    const char *streamNames[2] = {"all", "3 classes"};
+    for (int stream = 0; stream < 2; stream++)
+    {
+        Variant variants[2] = {{"nchw", &nchw}, {"native", &native}};
+        for (Variant &v : variants)
+        {
+            // 预热: 临时缓冲和输出内存在第一帧分配
+            for (int i = 0; i < 5; i++)
+                v.model->detect(frame, &v.results, stream);
+        }
+        for (Variant &v : variants)
+        {
+            rknn_mock_io_stats before = {0, 0, 0, 0};
+            if (get_io_stats != NULL)
+                get_io_stats(&before);
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < frames; i++)
+            {
+                if (v.model->detect(frame, &v.results, stream) != 0)
+                {
+                    printf("detect fail!\n");
+                    return -1;
+                }
+            }
+            v.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+            v.io = before;
+            if (get_io_stats != NULL)
+            {
+                rknn_mock_io_stats after;
+                get_io_stats(&after);
+                v.io.runs = after.runs - before.runs;
+                v.io.output_copy_bytes = after.output_copy_bytes - before.output_copy_bytes;
+            }
+        }
+
+        for (const Variant &v : variants)
+        {
+            printf("%-9s %-6s  %6.3f ms/frame  %3d boxes", streamNames[stream], v.name, v.ms, v.results.count);
+            if (get_io_stats != NULL && v.io.runs > 0)
+                printf("  output copied %8.0f B/frame", (double)v.io.output_copy_bytes / v.io.runs);
+            printf("\n");
+        }
+        if (get_io_stats != NULL && variants[1].io.output_copy_bytes != 0)
+        {
+            printf("  native output still copied %llu bytes\n", (unsigned long long)variants[1].io.output_copy_bytes);
+            failures++;
+        }
+        // 输出内容相同, 只是布局不同, 两种解码的检测结果应完全一致
+        if (!same_results(variants[0].results, variants[1].results))
+        {
+            printf("  detections differ: %d vs %d boxes\n", variants[0].results.count, variants[1].results.count);
+            failures++;
+        }
+    }
+
+    // 第2路的类别都超出模型类别数: 过滤后列表为空, 不能当作不限制类别
+    const std::vector<int> outOfRange = {native.get_num_class(), native.get_num_class() + 5};
+    nchw.set_stream_classes(2, outOfRange);
+    native.set_stream_classes(2, outOfRange);
+    for (Yolo11 *model : {&nchw, &native})
+    {
+        object_detect_result_list results;
+        if (model->detect(frame, &results, 2) != 0 || results.count != 0)
+        {
+            printf("out-of-range class list: %d boxes, expected none\n", results.count);
+            failures++;
+        }
+    }
+
+    if (failures != 0)
+    {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
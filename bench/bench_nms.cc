@@ -0,0 +1,258 @@
+// NMS 的微基准和一致性检查
+// 用法: ./bench_nms [轮数]
+// 在随机生成的拥挤场景(候选框聚集在少数目标周围)上, 把 nms_select 的按类别分桶版本和 class_offset 版本
+// 与原来逐类别遍历全部候选的实现比较保留结果(下标集合及得分顺序), 不一致时返回非0; class_offset 在IoU恰好等于阈值
+// (只差浮点舍入)的候选上允许与原实现不同; 部分候选框越过画面左/上边缘, 检查平移量按负坐标计算;
+// 再按候选数 100/1000/5000 对比原实现、分桶、分桶+pre_nms_topk、class_offset 的耗时
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <random>
+#include <vector>
+
+#include "postprocess.h"
+
+static const int num_class = 80;
+
+// 原 post_process 中的实现
+static float CalculateOverlap(float xmin0, float ymin0, float xmax0, float ymax0, float xmin1, float ymin1, float xmax1, float ymax1)
+{
+    float w = fmax(0.f, fmin(xmax0, xmax1) - fmax(xmin0, xmin1) + 1.0);
+    float h = fmax(0.f, fmin(ymax0, ymax1) - fmax(ymin0, ymin1) + 1.0);
+    float i = w * h;
+    float u = (xmax0 - xmin0 + 1.0) * (ymax0 - ymin0 + 1.0) + (xmax1 - xmin1 + 1.0) * (ymax1 - ymin1 + 1.0) - i;
+    return u <= 0.f ? 0.f : (i / u);
+}
+
+static int nms(int validCount, std::vector<float> &outputLocations, const std::vector<int> &classIds, std::vector<int> &order,
+               int filterId, float threshold)
+{
+    for (int i = 0; i < validCount; ++i)
+    {
+        int n = order[i];
+        if (n == -1 || classIds[n] != filterId)
+            continue;
+        for (int j = i + 1; j < validCount; ++j)
+        {
+            int m = order[j];
+            if (m == -1 || classIds[m] != filterId)
+                continue;
+            float xmin0 = outputLocations[n * 4 + 0];
+            float ymin0 = outputLocations[n * 4 + 1];
+            float xmax0 = outputLocations[n * 4 + 0] + outputLocations[n * 4 + 2];
+            float ymax0 = outputLocations[n * 4 + 1] + outputLocations[n * 4 + 3];
+            float xmin1 = outputLocations[m * 4 + 0];
+            float ymin1 = outputLocations[m * 4 + 1];
+            float xmax1 = outputLocations[m * 4 + 0] + outputLocations[m * 4 + 2];
+            float ymax1 = outputLocations[m * 4 + 1] + outputLocations[m * 4 + 3];
+            float iou = CalculateOverlap(xmin0, ymin0, xmax0, ymax0, xmin1, ymin1, xmax1, ymax1);
+            if (iou > threshold)
+                order[j] = -1;
+        }
+    }
+    return 0;
+}
+
+static int quick_sort_indice_inverse(std::vector<float> &input, int left, int right, std::vector<int> &indices)
+{
+    float key;
+    int key_index;
+    int low = left;
+    int high = right;
+    if (left < right)
+    {
+        key_index = indices[left];
+        key = input[left];
+        while (low < high)
+        {
+            while (low < high && input[high] <= key)
+                high--;
+            input[low] = input[high];
+            indices[low] = indices[high];
+            while (low < high && input[low] >= key)
+                low++;
+            input[high] = input[low];
+            indices[high] = indices[low];
+        }
+        input[low] = key;
+        indices[low] = key_index;
+        quick_sort_indice_inverse(input, left, low - 1, indices);
+        quick_sort_indice_inverse(input, low + 1, right, indices);
+    }
+    return low;
+}
+
+static void original_nms(const post_process_buffers &in, float threshold, std::vector<int> &keep)
+{
+    int validCount = (int)in.probs.size();
+    std::vector<float> probs = in.probs;
+    std::vector<float> boxes = in.boxes;
+    std::vector<int> order(validCount);
+    for (int i = 0; i < validCount; ++i)
+        order[i] = i;
+    quick_sort_indice_inverse(probs, 0, validCount - 1, order);
+    std::vector<bool> class_present(num_class, false);
+    for (int i = 0; i < validCount; ++i)
+        class_present[in.class_ids[i]] = true;
+    for (int c = 0; c < num_class; c++)
+    {
+        if (class_present[c])
+            nms(validCount, boxes, in.class_ids, order, c, threshold);
+    }
+    keep.clear();
+    for (int i = 0; i < validCount && (int)keep.size() < OBJ_NUMB_MAX_SIZE; ++i)
+    {
+        if (order[i] != -1)
+            keep.push_back(order[i]);
+    }
+}
+
+// class_offset 在平移后的坐标上计算IoU, 与阈值只差浮点舍入的候选可能得到相反的结论;
+// 两组结果的差异都是这样的候选时返回true
+static bool borderline_only(const post_process_buffers &buf, const std::vector<int> &a, const std::vector<int> &b, float threshold)
+{
+    std::vector<int> diff;
+    std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(diff));
+    for (int x : diff)
+    {
+        bool near = false;
+        const float *p = &buf.boxes[x * 4];
+        for (int y = 0; y < (int)buf.probs.size() && !near; y++)
+        {
+            if (y == x || buf.class_ids[y] != buf.class_ids[x])
+                continue;
+            const float *q = &buf.boxes[y * 4];
+            float iou = CalculateOverlap(p[0], p[1], p[0] + p[2], p[1] + p[3], q[0], q[1], q[0] + q[2], q[1] + q[3]);
+            near = fabs(iou - threshold) < 1e-4f;
+        }
+        if (!near)
+            return false;
+    }
+    return true;
+}
+
+// 拥挤场景: 候选框聚集在 objects 个目标周围, 每个目标附近的候选同属少数几个类别;
+// 部分目标越过画面左/上边缘, 左上角坐标为负
+static void make_scene(post_process_buffers &buf, int count, int objects, std::mt19937 &rng)
+{
+    std::uniform_real_distribution<float> pos(-120, 600), size(16, 200), jitter(-12, 12), score(0.25f, 0.95f);
+    std::uniform_int_distribution<int> cls(0, 9);
+    std::vector<float> centers(objects * 4);
+    std::vector<int> classes(objects);
+    for (int k = 0; k < objects; k++)
+    {
+        centers[k * 4 + 0] = pos(rng);
+        centers[k * 4 + 1] = pos(rng);
+        centers[k * 4 + 2] = size(rng);
+        centers[k * 4 + 3] = size(rng);
+        classes[k] = cls(rng);
+    }
+    buf.boxes.clear();
+    buf.probs.clear();
+    buf.class_ids.clear();
+    for (int i = 0; i < count; i++)
+    {
+        int k = rng() % objects;
+        buf.boxes.push_back(centers[k * 4 + 0] + jitter(rng));
+        buf.boxes.push_back(centers[k * 4 + 1] + jitter(rng));
+        buf.boxes.push_back(std::max(1.f, centers[k * 4 + 2] + jitter(rng)));
+        buf.boxes.push_back(std::max(1.f, centers[k * 4 + 3] + jitter(rng)));
+        buf.probs.push_back(score(rng));
+        // 少数候选被判成相邻的类别
+        buf.class_ids.push_back(rng() % 8 == 0 ? (classes[k] + 1) % num_class : classes[k]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 300;
+    const float threshold = 0.45f;
+    std::mt19937 rng(2024);
+    post_process_buffers buf;
+    std::vector<int> ref;
+    nms_options bucketed = {0, false}, offset = {0, true};
+
+    // 一致性检查
+    int mismatches[2] = {0, 0};
+    int borderline = 0;
+    for (int r = 0; r < rounds; r++)
+    {
+        make_scene(buf, 1 + r * 7 % 1500, 1 + r % 60, rng);
+        original_nms(buf, threshold, ref);
+        const nms_options *opts[2] = {&bucketed, &offset};
+        for (int v = 0; v < 2; v++)
+        {
+            int n = nms_select(&buf, num_class, threshold, opts[v], OBJ_NUMB_MAX_SIZE);
+            // 原实现的快速排序对同分候选的顺序不确定, 比较得分序列和保留的下标集合
+            bool same = n == (int)ref.size();
+            for (int k = 0; same && k < n; k++)
+                same = buf.probs[buf.keep[k]] == buf.probs[ref[k]];
+            std::vector<int> a(buf.keep.begin(), buf.keep.end()), b = ref;
+            std::sort(a.begin(), a.end());
+            std::sort(b.begin(), b.end());
+            same = same && a == b;
+            if (!same && v == 1 && borderline_only(buf, a, b, threshold))
+            {
+                borderline++;
+                continue;
+            }
+            if (!same && mismatches[v]++ < 3)
+                printf("round %d (%s): kept %d, original kept %d\n", r, v == 0 ? "bucketed" : "class offset", n, (int)ref.size());
+        }
+    }
+    printf("equivalence over %d scenes: bucketed %d mismatches, class offset %d mismatches (%d more only at IoU == threshold)\n", rounds,
+           mismatches[0], mismatches[1], borderline);
+
+    // 边缘场景: 类别1的框在类别0的框左上方且坐标为负, 平移量只按最大坐标计算时两者平移后重合, 类别1的框会被错误抑制
+    buf.boxes = {-50, -50, 100, 100, -101, -101, 100, 100};
+    buf.probs = {0.9f, 0.8f};
+    buf.class_ids = {0, 1};
+    if (nms_select(&buf, num_class, threshold, &offset, OBJ_NUMB_MAX_SIZE) != 2)
+    {
+        printf("edge scene (class offset): box of class 1 suppressed by class 0\n");
+        mismatches[1]++;
+    }
+
+    // 耗时
+    const int counts[3] = {100, 1000, 5000};
+    nms_options topk = {100, false};
+    for (int count : counts)
+    {
+        make_scene(buf, count, std::max(1, count / 25), rng);
+        int repeat = count >= 5000 ? 5 : 50;
+        const nms_options *opts[3] = {&bucketed, &topk, &offset};
+        double ms[4];
+        int kept[4];
+        for (int v = 0; v < 4; v++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (int r = 0; r < repeat; r++)
+            {
+                if (v == 0)
+                {
+                    original_nms(buf, threshold, ref);
+                    kept[v] = (int)ref.size();
+                }
+                else
+                {
+                    kept[v] = nms_select(&buf, num_class, threshold, opts[v - 1], OBJ_NUMB_MAX_SIZE);
+                }
+            }
+            ms[v] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeat;
+        }
+        printf("%5d candidates  original %8.3f ms  bucketed %6.3f ms (%.0fx)  topk=%d %6.3f ms  class offset %6.3f ms  kept %d/%d/%d/%d\n",
+               count, ms[0], ms[1], ms[0] / ms[1], topk.pre_nms_topk, ms[2], ms[3], kept[0], kept[1], kept[2], kept[3]);
+    }
+
+    if (mismatches[0] != 0 || mismatches[1] != 0)
+    {
+        printf("FAIL: nms_select differs from the original nms\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,99 @@
+// CPU预处理耗时对比:
+//   拉伸: 整帧 cvtColor + cv::resize 两步 与 融合通道交换的 resize_bgr2rgb_cpu
+//   letterbox: 整帧 cvtColor + letterbox()(cv::resize + copyMakeBorder) 与 单遍的 letterbox_cpu
+// 用法: ./bench_preprocess [帧数] [源宽] [源高] [目标宽] [目标高]
+// 以OpenCV路径为基准输出最大像素误差, 超过2时返回非0(7位定点权重允许少量舍入差)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgproc.hpp"
+#include "preprocess.h"
+
+static double time_ms(int frames, const std::function<void()> &fn)
+{
+    fn(); // 预热, 分配输出缓冲
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++)
+        fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+}
+
+static int max_diff(const cv::Mat &a, const cv::Mat &b)
+{
+    int diff = 0;
+    for (int y = 0; y < a.rows; y++)
+    {
+        const unsigned char *pa = a.ptr(y);
+        const unsigned char *pb = b.ptr(y);
+        for (int x = 0; x < a.cols * 3; x++)
+            diff = std::max(diff, abs((int)pa[x] - (int)pb[x]));
+    }
+    return diff;
+}
+
+int main(int argc, char **argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 100;
+    int src_w = argc > 2 ? atoi(argv[2]) : 1920;
+    int src_h = argc > 3 ? atoi(argv[3]) : 1080;
+    cv::Size target(argc > 4 ? atoi(argv[4]) : 640, argc > 5 ? atoi(argv[5]) : 640);
+
+    cv::Mat frame(src_h, src_w, CV_8UC3);
+    cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(256));
+    cv::GaussianBlur(frame, frame, cv::Size(5, 5), 0); // 接近自然图像的平滑度
+
+    cv::Mat rgb, two_step, resize_first, tmp, fused;
+    double ms_two_step = time_ms(frames, [&]()
+                                 {
+        cv::cvtColor(frame, rgb, cv::COLOR_BGR2RGB);
+        cv::resize(rgb, two_step, target, 0, 0, cv::INTER_LINEAR); });
+    double ms_resize_first = time_ms(frames, [&]()
+                                     {
+        cv::resize(frame, tmp, target, 0, 0, cv::INTER_LINEAR);
+        cv::cvtColor(tmp, resize_first, cv::COLOR_BGR2RGB); });
+    double ms_fused = time_ms(frames, [&]()
+                              { resize_bgr2rgb_cpu(frame, fused, target); });
+
+    float scale = std::min((float)target.width / src_w, (float)target.height / src_h);
+    cv::Mat cv_padded, cpu_padded;
+    BOX_RECT cv_pads, cpu_pads;
+    double ms_letterbox = time_ms(frames, [&]()
+                                  {
+        cv::cvtColor(frame, rgb, cv::COLOR_BGR2RGB);
+        letterbox(rgb, cv_padded, cv_pads, scale, target); });
+    double ms_letterbox_cpu = time_ms(frames, [&]()
+                                      { letterbox_cpu(frame, cpu_padded, cpu_pads, scale, target); });
+
+    int diff = max_diff(two_step, fused);
+    int letterbox_diff = -1;
+    if (cv_padded.size() == cpu_padded.size() && cv_pads.left == cpu_pads.left && cv_pads.top == cpu_pads.top &&
+        cv_pads.right == cpu_pads.right && cv_pads.bottom == cpu_pads.bottom)
+        letterbox_diff = max_diff(cv_padded, cpu_padded);
+    printf("%dx%d -> %dx%d, %d frames, cpu kernel %s, rga %s\n", src_w, src_h, target.width, target.height, frames,
+           resize_cpu_isa(), rga_available() ? "available" : "not available");
+    printf("  cvtColor + resize   %7.3f ms/frame\n", ms_two_step);
+    printf("  resize + cvtColor   %7.3f ms/frame  max diff %d\n", ms_resize_first, max_diff(two_step, resize_first));
+    printf("  resize_bgr2rgb_cpu  %7.3f ms/frame  max diff %d  (%.2fx)\n", ms_fused, diff, ms_two_step / ms_fused);
+    printf("  cvtColor + letterbox %6.3f ms/frame  pads l%d r%d t%d b%d\n", ms_letterbox,
+           cv_pads.left, cv_pads.right, cv_pads.top, cv_pads.bottom);
+    printf("  letterbox_cpu       %7.3f ms/frame  max diff %d  (%.2fx)\n", ms_letterbox_cpu, letterbox_diff,
+           ms_letterbox / ms_letterbox_cpu);
+    if (diff > 2)
+    {
+        printf("FAIL: fused resize differs from cv::resize by %d\n", diff);
+        return 1;
+    }
+    if (letterbox_diff < 0 || letterbox_diff > 2)
+    {
+        printf("FAIL: letterbox_cpu differs from letterbox() (pads l%d r%d t%d b%d, diff %d)\n",
+               cpu_pads.left, cpu_pads.right, cpu_pads.top, cpu_pads.bottom, letterbox_diff);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,91 @@
+// 线程池争用微基准: dpool::ThreadPool 与 dpool::WorkStealingThreadPool 在 3/6/12/24 线程下对比
+// 用法: ./bench_threadpool [每轮任务数] [任务耗时us]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <queue>
+#include <thread>
+
+#include "ThreadPool.hpp"
+#include "WorkStealingThreadPool.hpp"
+// 统计堆分配次数, 用于确认 submit 稳态下是否还会分配
+#define BENCH_COUNT_ALLOCS
+#include "bench_common.hpp"
+
+// 定义在 bench_threadpool_tu.cc
+int submit_from_second_tu(dpool::WorkStealingThreadPool &pool);
+
+static int task(int us)
+{
+    if (us > 0)
+    {
+        auto end = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+        while (std::chrono::steady_clock::now() < end)
+            ;
+    }
+    return us;
+}
+
+// 模拟 rknnPool 的用法: 单个生产者提交, 保持 threads 个任务在途, 按顺序 get
+template <typename Pool>
+static void run(const char *name, size_t threads, int tasks, int us)
+{
+    Pool pool(threads);
+    std::queue<std::future<int>> futs;
+
+    // 预热, 让线程和内存池就位
+    for (int i = 0; i < (int)threads * 4; i++)
+        futs.push(pool.submit(task, 0));
+    while (!futs.empty())
+    {
+        futs.front().get();
+        futs.pop();
+    }
+
+    size_t allocsBefore = g_allocs.load();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < tasks; i++)
+    {
+        futs.push(pool.submit(task, us));
+        if (futs.size() > threads * 2)
+        {
+            futs.front().get();
+            futs.pop();
+        }
+    }
+    while (!futs.empty())
+    {
+        futs.front().get();
+        futs.pop();
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t allocs = g_allocs.load() - allocsBefore;
+
+    printf("%-22s threads=%2zu  %10.0f tasks/s  %6.2f us/task  allocs/task=%.2f\n",
+           name, threads, tasks / sec, sec * 1e6 / tasks, (double)allocs / tasks);
+}
+
+int main(int argc, char **argv)
+{
+    int tasks = argc > 1 ? atoi(argv[1]) : 200000;
+    int us = argc > 2 ? atoi(argv[2]) : 0;
+    const size_t threadCounts[] = {3, 6, 12, 24};
+
+    printf("tasks=%d, task cost=%d us, hardware threads=%u\n", tasks, us, std::thread::hardware_concurrency());
+    {
+        dpool::WorkStealingThreadPool pool(1);
+        if (submit_from_second_tu(pool) != 2)
+        {
+            printf("task submitted from the second translation unit failed\n");
+            return 1;
+        }
+    }
+    for (size_t threads : threadCounts)
+    {
+        run<dpool::ThreadPool>("ThreadPool", threads, tasks, us);
+        run<dpool::WorkStealingThreadPool>("WorkStealingThreadPool", threads, tasks, us);
+    }
+    return 0;
+}
@@ -0,0 +1,12 @@
+// bench_threadpool 的第二个编译单元: 与 bench_threadpool.cc 一起包含线程池头文件(经 rknnPool.hpp),
+// 头文件中出现非 inline 的定义(如类外定义的 static constexpr 成员)时链接会报重复定义
+#include "rknnPool.hpp"
+
+// 在另一个编译单元里提交一个任务, 确认两个编译单元实例化的线程池可以一起链接
+int submit_from_second_tu(dpool::WorkStealingThreadPool &pool)
+{
+    return pool.submit([](int v)
+                       { return v + 1; },
+                       1)
+        .get();
+}
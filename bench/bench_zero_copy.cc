@@ -0,0 +1,148 @@
+// 拷贝输入(rknn_inputs_set)与零拷贝输入(rknn_create_mem + rknn_set_io_mem)的对比
+// 用法: ./bench_zero_copy <rknn model> [帧数] [宽] [高]
+// 同一模型初始化两次, 分别在拉伸和letterbox预处理下逐帧统计 detect 的耗时和检测结果;
+// 链接 rknnrt_mock 时还读取运行时每帧拷贝的输入字节数(零拷贝时应为0)以及推理读到的输入内容的校验和(两种方式应相同)。
+// 检测结果或校验和不一致、零拷贝仍有输入拷贝时返回非0。
+// RKNN_MOCK_CORE_LATENCY_US=0 时耗时只剩预处理、拷贝和后处理; RKNN_MOCK_INPUT_W_STRIDE 可模拟带行填充的输入内存
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <dlfcn.h>
+#include <chrono>
+
+#include "opencv2/core/core.hpp"
+#include "Yolo11.hpp"
+#include "rknn_mock.h"
+#include "bench_common.hpp"
+
+typedef int (*io_stats_fn)(rknn_mock_io_stats *);
+
+struct Variant
+{
+    const char *name;
+    Yolo11 *model;
+    object_detect_result_list results;
+    double ms;
+    rknn_mock_io_stats io;
+};
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("Usage: %s <rknn model> [frames] [width] [height]\n", argv[0]);
+        return -1;
+    }
+    int frames = argc > 2 ? atoi(argv[2]) : 200;
+    int width = argc > 3 ? atoi(argv[3]) : 1920;
+    int height = argc > 4 ? atoi(argv[4]) : 1080;
+
+    // 只有 rknnrt_mock 导出拷贝统计, 链接真实运行时只比较耗时和结果
+    io_stats_fn get_io_stats = (io_stats_fn)dlsym(RTLD_DEFAULT, "rknn_mock_get_io_stats");
+    if (get_io_stats == NULL)
+        printf("runtime has no copy counters, comparing time and results only\n");
+
+    Yolo11Options zeroOptions;
+    zeroOptions.zero_copy = true;
+    Yolo11 copy(argv[1]);
+    Yolo11 zero(argv[1], zeroOptions);
+    if (copy.init(nullptr, false) != 0)
+    {
+        printf("Yolo11 init fail!\n");
+        return -1;
+    }
+    int ret = zero.init(copy.get_pctx(), true);
+    if (ret != 0)
+    {
+        printf("Yolo11 init fail!\n");
+        return -1;
+    }
+
+    cv::Mat frame(height, width, CV_8UC3);
+    for (int y = 0; y < height; y++)
+    {
+        unsigned char *row = frame.ptr(y);
+        for (int x = 0; x < width * 3; x++)
+            row[x] = (unsigned char)(x * 7 + y * 3);
+    }
+
+    int failures = 0;
+    const ResizeMode modes[2] = {ResizeMode::STRETCH, ResizeMode::LETTERBOX};
+    const char *modeNames[2] = {"stretch", "letterbox"};
+    for (int m = 0; m < 2; m++)
+    {
+        Variant variants[2] = {{"copy", &copy}, {"zero-copy", &zero}};
+        int mismatched = 0;
+        for (Variant &v : variants)
+        {
+            v.model->set_resize_mode(modes[m]);
+            // 预热: 临时缓冲和输入内存在第一帧分配
+            for (int i = 0; i < 5; i++)
+                v.model->detect(frame, &v.results);
+        }
+        for (Variant &v : variants)
+        {
+            rknn_mock_io_stats before = {0, 0, 0, 0};
+            if (get_io_stats != NULL)
+                get_io_stats(&before);
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < frames; i++)
+            {
+                if (v.model->detect(frame, &v.results) != 0)
+                {
+                    printf("detect fail!\n");
+                    return -1;
+                }
+            }
+            v.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+            v.io = before;
+            if (get_io_stats != NULL)
+            {
+                rknn_mock_io_stats after;
+                get_io_stats(&after);
+                v.io.runs = after.runs - before.runs;
+                v.io.input_copy_bytes = after.input_copy_bytes - before.input_copy_bytes;
+                v.io.output_copy_bytes = after.output_copy_bytes - before.output_copy_bytes;
+                v.io.input_checksum = after.input_checksum - before.input_checksum;
+            }
+        }
+        // 输入相同, 两种方式每帧的检测结果应完全一致
+        mismatched += !same_results(variants[0].results, variants[1].results);
+
+        for (const Variant &v : variants)
+        {
+            printf("%-9s %-9s  %6.3f ms/frame", modeNames[m], v.name, v.ms);
+            if (get_io_stats != NULL && v.io.runs > 0)
+                printf("  input copied %8.0f B/frame  output copied %8.0f B/frame", (double)v.io.input_copy_bytes / v.io.runs,
+                       (double)v.io.output_copy_bytes / v.io.runs);
+            printf("\n");
+        }
+        if (get_io_stats != NULL)
+        {
+            if (variants[1].io.input_copy_bytes != 0)
+            {
+                printf("  zero-copy input still copied %llu bytes\n", (unsigned long long)variants[1].io.input_copy_bytes);
+                failures++;
+            }
+            if (variants[0].io.input_checksum != variants[1].io.input_checksum)
+            {
+                printf("  NPU read different input: checksum %llu vs %llu\n", (unsigned long long)variants[0].io.input_checksum,
+                       (unsigned long long)variants[1].io.input_checksum);
+                failures++;
+            }
+        }
+        if (mismatched != 0)
+        {
+            printf("  detections differ: %d vs %d boxes\n", variants[0].results.count, variants[1].results.count);
+            failures++;
+        }
+    }
+
+    if (failures != 0)
+    {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
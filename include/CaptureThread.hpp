@@ -0,0 +1,70 @@
+#ifndef CAPTURETHREAD_HPP
+#define CAPTURETHREAD_HPP
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/videoio.hpp"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 读帧线程的统计/Capture statistics
+struct CaptureStats
+{
+    long long frames;      // 解码的帧数
+    long long overwritten; // 未被取走就被新帧覆盖的帧数(live模式)
+    long long stalls;      // 缓冲全部被下游占用而等待的次数
+    double avgDecodeMs;    // 单帧 VideoCapture::read 平均耗时
+    double maxDecodeMs;
+};
+
+/*
+ * 独立的读帧线程, 解码到预分配的环形帧缓冲中, 解码不再被推理/显示阻塞。
+ * 缓冲的所有权通过 cv::Mat 的引用计数交接: read() 交出的 Mat 与环形缓冲共享数据, 但引用计数记在
+ * 单独的 UMatData 上, 由 CaptureThread 的 MatAllocator 管理; 提交给 rknnPool 后依次由推理任务、结果和显示持有,
+ * 最后一个引用释放时分配器把槽位还给读帧线程并唤醒等待空闲槽位的解码, 该缓冲才会再次被写入。
+ * 因此已提交的帧不会被后续解码覆盖, 尺寸不变的输入也不会每帧重新分配。
+ */
+class CaptureThread
+{
+private:
+    class SlotAllocator;
+
+    cv::VideoCapture &capture;
+    bool live;
+    std::vector<cv::Mat> ring;
+    std::vector<double> decodeMs;  // 各槽位中帧的解码耗时
+    std::vector<bool> queued;      // 槽位是否在 ready 中
+    std::vector<bool> leased;      // 槽位中的帧已交给下游, 尚未全部释放
+    std::shared_ptr<SlotAllocator> allocator; // 交出的帧的分配器, 由未释放的帧共同持有
+    std::deque<int> ready;         // 已解码等待 read 的槽位, 按解码顺序
+    int nextSlot;
+    bool stopping, finished;
+    CaptureStats stats;
+    double decodeSumMs;
+    std::mutex mtx;
+    std::condition_variable readyCv, freeCv;
+    std::thread worker;
+
+    bool slotFree(int slot);
+    int acquireSlot();
+    void releaseSlot(int slot);
+    void loop();
+
+public:
+    // ringSize 需大于下游可能同时持有的帧数;
+    // live 为true时缓冲用尽则覆盖最旧的未取帧(摄像头), 否则等待下游释放(视频文件)
+    CaptureThread(cv::VideoCapture &capture, int ringSize, bool live);
+    int start();
+    // 还有帧可读
+    bool isOpened();
+    // 取下一帧, 输入结束时返回false; frameDecodeMs 返回该帧的解码耗时
+    bool read(cv::Mat &frame, double *frameDecodeMs = nullptr);
+    void stop();
+    CaptureStats getStats();
+    ~CaptureThread();
+};
+
+#endif
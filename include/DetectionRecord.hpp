@@ -0,0 +1,147 @@
+#ifndef DETECTIONRECORD_H
+#define DETECTIONRECORD_H
+
+#include "postprocess.h"
+#include "opencv2/core/core.hpp"
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// rknnPool<Yolo11, DetectionRequest, DetectionHandle> 的输入: 一帧图像和调用方给出的帧信息
+struct DetectionRequest
+{
+    cv::Mat frame;
+    long long frame_id = 0;
+    std::chrono::steady_clock::time_point capture_time; // 读帧时刻
+    bool keep_frame = false; // 在记录中保留原图, 供之后绘制; 只要坐标时不保留
+};
+
+// 一帧的检测结果, 坐标已还原到原图; 各字段分别连续存放(SoA), 只读分数或类别时不必读取整个结构体
+struct DetectionRecord
+{
+    long long frame_id;
+    int stream;
+    std::chrono::steady_clock::time_point capture_time; // 取自 DetectionRequest
+    std::chrono::steady_clock::time_point infer_start;  // 开始预处理
+    std::chrono::steady_clock::time_point infer_done;   // 后处理完成
+    // 容量在分配记录时预留为 OBJ_NUMB_MAX_SIZE, 之后每帧 clear/push_back 不再分配内存
+    std::vector<int> left, top, right, bottom;
+    std::vector<float> scores;
+    std::vector<int> classes;
+    cv::Mat frame; // keep_frame 时引用原图(不拷贝像素), 否则为空
+
+    int count() const { return (int)scores.size(); }
+};
+
+class DetectionRecordPool;
+
+// 记录用完后归还到所属的池; 持有池的引用, 池在最后一个记录归还后才释放
+struct DetectionRecordDeleter
+{
+    std::shared_ptr<DetectionRecordPool> pool;
+    void operator()(DetectionRecord *record) const;
+};
+
+typedef std::unique_ptr<DetectionRecord, DetectionRecordDeleter> DetectionHandle;
+
+/*
+ * 检测记录的对象池: 记录在池中循环使用, 稳定运行后取用和归还都不分配内存。
+ * acquire 在没有空闲记录时新分配一个, 池的大小因此自动增长到同时在途的记录数。
+ */
+class DetectionRecordPool : public std::enable_shared_from_this<DetectionRecordPool>
+{
+private:
+    std::mutex mtx;
+    std::vector<std::unique_ptr<DetectionRecord>> all;
+    std::vector<DetectionRecord *> free;
+
+    DetectionRecordPool() {}
+
+    static std::unique_ptr<DetectionRecord> allocate()
+    {
+        std::unique_ptr<DetectionRecord> record(new DetectionRecord());
+        record->left.reserve(OBJ_NUMB_MAX_SIZE);
+        record->top.reserve(OBJ_NUMB_MAX_SIZE);
+        record->right.reserve(OBJ_NUMB_MAX_SIZE);
+        record->bottom.reserve(OBJ_NUMB_MAX_SIZE);
+        record->scores.reserve(OBJ_NUMB_MAX_SIZE);
+        record->classes.reserve(OBJ_NUMB_MAX_SIZE);
+        return record;
+    }
+
+public:
+    DetectionRecordPool(const DetectionRecordPool &) = delete;
+    DetectionRecordPool &operator=(const DetectionRecordPool &) = delete;
+
+    // 预先分配 reserve 个记录, 内存不足时抛出 std::bad_alloc
+    static std::shared_ptr<DetectionRecordPool> create(int reserve)
+    {
+        std::shared_ptr<DetectionRecordPool> pool(new DetectionRecordPool());
+        pool->all.reserve(reserve);
+        pool->free.reserve(reserve);
+        for (int i = 0; i < reserve; i++)
+        {
+            pool->all.emplace_back(allocate());
+            pool->free.push_back(pool->all.back().get());
+        }
+        return pool;
+    }
+
+    // 取一个清空的记录, 内存不足时返回空
+    DetectionHandle acquire()
+    {
+        DetectionRecord *record = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            if (!free.empty())
+            {
+                record = free.back();
+                free.pop_back();
+            }
+            else
+            {
+                try
+                {
+                    all.emplace_back(allocate());
+                    // 归还时 push_back 不能再扩容
+                    free.reserve(all.capacity());
+                    record = all.back().get();
+                }
+                catch (const std::bad_alloc &)
+                {
+                    return DetectionHandle();
+                }
+            }
+        }
+        record->left.clear();
+        record->top.clear();
+        record->right.clear();
+        record->bottom.clear();
+        record->scores.clear();
+        record->classes.clear();
+        return DetectionHandle(record, DetectionRecordDeleter{shared_from_this()});
+    }
+
+    void release(DetectionRecord *record)
+    {
+        // 不再引用原图, 帧缓冲可以被复用
+        record->frame = cv::Mat();
+        std::lock_guard<std::mutex> lock(mtx);
+        free.push_back(record);
+    }
+
+    // 已分配的记录数
+    int size()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        return (int)all.size();
+    }
+};
+
+inline void DetectionRecordDeleter::operator()(DetectionRecord *record) const
+{
+    pool->release(record);
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef OUTPUTSINK_HPP
+#define OUTPUTSINK_HPP
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/videoio.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 输出端统计/Per-sink statistics
+struct SinkStats
+{
+    long long written;    // 已输出的帧数
+    long long dropped;    // 队列满时被同一路的新帧挤掉的帧数
+    double avgLatencyMs;  // push到输出完成的平均延迟
+    double maxLatencyMs;
+    double avgWriteMs;    // 单帧 imshow/编码 耗时
+    double maxWriteMs;
+};
+
+/*
+ * 输出端(本地显示/RTP推流)线程: 推理循环只把结果放进有界队列, 显示或编码卡顿只拖慢输出端自己。
+ * 队列按视频流计数, 每路最多 capacity 帧, 多路共用一个输出端时快的流不会挤掉慢的流的帧。
+ * dropToLatest 为true时该路已满则丢弃该路最旧的帧, 始终输出最新画面; 否则 push 阻塞。
+ * open/write/release 均在输出线程中调用, 子类析构时需先调用 close()。
+ */
+class OutputSink
+{
+private:
+    struct Item
+    {
+        cv::Mat frame;
+        int stream;
+        std::chrono::steady_clock::time_point pushTime;
+    };
+    std::string name;
+    size_t capacity;      // 每路视频流的队列长度
+    bool dropToLatest;
+    std::deque<Item> items;
+    int openResult;       // 1表示打开中
+    bool closing, quit;
+    SinkStats stats;
+    double latencySumMs, writeSumMs;
+    std::mutex mtx;
+    std::condition_variable notEmpty, notFull, openCv;
+    std::thread worker;
+
+    size_t queued(int stream) const; // 队列中该路的帧数, 调用方持有 mtx
+    void loop();
+
+protected:
+    // 打开窗口/编码器, 返回0表示成功
+    virtual int open() = 0;
+    // 输出一帧, 返回false表示用户要求退出
+    virtual bool write(const cv::Mat &frame, int stream) = 0;
+    virtual void release() = 0;
+
+public:
+    OutputSink(const std::string &name, int capacity, bool dropToLatest);
+    // 启动输出线程并等待打开完成
+    int start();
+    // 提交一帧, stream 为视频流编号; 返回false表示用户要求退出
+    bool push(const cv::Mat &frame, int stream = 0);
+    // 输出队列中剩余的帧后结束输出线程
+    void close();
+    const std::string &getName() const { return name; }
+    SinkStats getStats();
+    virtual ~OutputSink();
+};
+
+// 本地显示, 每路视频流一个窗口; 按q退出
+class DisplaySink : public OutputSink
+{
+private:
+    std::vector<std::string> windows;
+
+protected:
+    int open() override;
+    bool write(const cv::Mat &frame, int stream) override;
+    void release() override;
+
+public:
+    DisplaySink(const std::vector<std::string> &windows, int capacity = 2);
+    ~DisplaySink();
+};
+
+// 通过GStreamer管线推流(如 x264enc + RTP)
+class VideoWriterSink : public OutputSink
+{
+private:
+    std::string pipeline;
+    double fps;
+    cv::Size size;
+    cv::VideoWriter writer;
+
+protected:
+    int open() override;
+    bool write(const cv::Mat &frame, int stream) override;
+    void release() override;
+
+public:
+    VideoWriterSink(const std::string &pipeline, double fps, cv::Size size, int capacity = 2);
+    ~VideoWriterSink();
+};
+
+#endif
@@ -178,7 +178,7 @@ namespace dpool
             }
         }
 
-        static constexpr size_t WAIT_SECONDS = 2; // 空闲线程等待新任务的超时时间（秒）
+        enum { WAIT_SECONDS = 2 }; // 空闲线程等待新任务的超时时间（秒）
 
         bool quit_;                                  // 线程池退出标志
         size_t currentThreads_;                      // 当前线程数量
@@ -192,8 +192,6 @@ namespace dpool
         std::unordered_map<ThreadID, Thread> threads_; // 存储线程ID和线程对象的map
     };
 
-    constexpr size_t ThreadPool::WAIT_SECONDS;
-
 } // namespace dpool
 
 #endif /* THREADPOOL_H */
\ No newline at end of file
@@ -0,0 +1,431 @@
+#ifndef WORKSTEALINGTHREADPOOL_H
+#define WORKSTEALINGTHREADPOOL_H
+
+#include <atomic>               // 用于无锁计数
+#include <cassert>              // 用于断言
+#include <condition_variable>   // 用于空闲线程休眠
+#include <cstddef>              // 用于 std::max_align_t
+#include <cstdlib>              // 用于 malloc/free
+#include <functional>           // 用于 std::bind
+#include <future>               // 用于 std::future 和 std::promise
+#include <memory>               // 用于 std::allocator_arg
+#include <mutex>                // 用于互斥锁
+#include <new>                  // 用于 placement new
+#include <thread>               // 用于线程操作
+#include <type_traits>          // 用于 std::result_of
+#include <utility>              // 用于 std::move
+#include <vector>               // 用于存储线程对象
+
+namespace dpool
+{
+
+    // 自旋锁, 每个工作线程队列的临界区只有几次拷贝, 比std::mutex更便宜
+    class SpinLock
+    {
+    public:
+        void lock()
+        {
+            while (flag_.test_and_set(std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+        void unlock() { flag_.clear(std::memory_order_release); }
+
+    private:
+        std::atomic_flag flag_ = ATOMIC_FLAG_INIT;
+    };
+
+    /**
+     * @brief future共享状态的内存池, 按64字节分级复用, 稳态下submit不再调用malloc
+     */
+    class StatePool
+    {
+    public:
+        static void *allocate(size_t bytes)
+        {
+            size_t cls = sizeClass(bytes);
+            if (cls >= CLASSES)
+                return ::operator new(bytes);
+            Bucket &bucket = instance().buckets_[cls];
+            {
+                std::lock_guard<SpinLock> guard(bucket.lock);
+                if (bucket.head != nullptr)
+                {
+                    Node *node = bucket.head;
+                    bucket.head = node->next;
+                    return node;
+                }
+            }
+            return ::operator new((cls + 1) * GRANULE);
+        }
+
+        static void deallocate(void *p, size_t bytes)
+        {
+            size_t cls = sizeClass(bytes);
+            if (cls >= CLASSES)
+            {
+                ::operator delete(p);
+                return;
+            }
+            Bucket &bucket = instance().buckets_[cls];
+            std::lock_guard<SpinLock> guard(bucket.lock);
+            Node *node = static_cast<Node *>(p);
+            node->next = bucket.head;
+            bucket.head = node;
+        }
+
+    private:
+        struct Node
+        {
+            Node *next;
+        };
+        struct Bucket
+        {
+            SpinLock lock;
+            Node *head = nullptr;
+        };
+
+        static constexpr size_t GRANULE = 64;
+        static constexpr size_t CLASSES = 16; // 最大复用 1KB 的块
+
+        static size_t sizeClass(size_t bytes) { return bytes == 0 ? 0 : (bytes - 1) / GRANULE; }
+
+        static StatePool &instance()
+        {
+            // 故意不析构: 线程池或future可能在静态析构阶段之后才归还内存
+            static StatePool *pool = new StatePool();
+            return *pool;
+        }
+
+        Bucket buckets_[CLASSES];
+    };
+
+    // 供 std::promise 使用的分配器, 把共享状态放进 StatePool
+    template <typename T>
+    struct StateAllocator
+    {
+        using value_type = T;
+
+        StateAllocator() = default;
+        template <typename U>
+        StateAllocator(const StateAllocator<U> &) {}
+
+        T *allocate(size_t n) { return static_cast<T *>(StatePool::allocate(n * sizeof(T))); }
+        void deallocate(T *p, size_t n) { StatePool::deallocate(p, n * sizeof(T)); }
+
+        template <typename U>
+        bool operator==(const StateAllocator<U> &) const { return true; }
+        template <typename U>
+        bool operator!=(const StateAllocator<U> &) const { return false; }
+    };
+
+    /**
+     * @brief 类型擦除的任务, 可调用对象放在内联存储中, 避免 std::function 的堆分配
+     */
+    class InlineTask
+    {
+    public:
+        static constexpr size_t STORAGE = 192; // 足够放下 bind(成员函数, shared_ptr, cv::Mat) + promise
+
+        InlineTask() = default;
+
+        template <typename Func>
+        explicit InlineTask(Func &&func)
+        {
+            using F = typename std::decay<Func>::type;
+            static_assert(sizeof(F) <= STORAGE, "task is too large for InlineTask storage");
+            new (storage_) F(std::forward<Func>(func));
+            ops_ = &opsFor<F>();
+        }
+
+        InlineTask(InlineTask &&other) noexcept { moveFrom(other); }
+
+        InlineTask &operator=(InlineTask &&other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                moveFrom(other);
+            }
+            return *this;
+        }
+
+        InlineTask(const InlineTask &) = delete;
+        InlineTask &operator=(const InlineTask &) = delete;
+
+        ~InlineTask() { reset(); }
+
+        void operator()() { ops_->invoke(storage_); }
+
+    private:
+        struct Ops
+        {
+            void (*invoke)(void *);
+            void (*move)(void *dst, void *src);
+            void (*destroy)(void *);
+        };
+
+        template <typename F>
+        static const Ops &opsFor()
+        {
+            static const Ops ops = {
+                [](void *p) { (*static_cast<F *>(p))(); },
+                [](void *dst, void *src) { new (dst) F(std::move(*static_cast<F *>(src))); },
+                [](void *p) { static_cast<F *>(p)->~F(); }};
+            return ops;
+        }
+
+        void moveFrom(InlineTask &other)
+        {
+            ops_ = other.ops_;
+            if (ops_ != nullptr)
+            {
+                ops_->move(storage_, other.storage_);
+                other.reset();
+            }
+        }
+
+        void reset()
+        {
+            if (ops_ != nullptr)
+            {
+                ops_->destroy(storage_);
+                ops_ = nullptr;
+            }
+        }
+
+        alignas(std::max_align_t) unsigned char storage_[STORAGE];
+        const Ops *ops_ = nullptr;
+    };
+
+    /**
+     * @brief 工作窃取线程池: 每个工作线程一个定长任务队列, 空闲时从其他线程队列尾部窃取。
+     * 线程在构造时全部创建并常驻, submit 的接口与 ThreadPool 相同。
+     */
+    class WorkStealingThreadPool
+    {
+    public:
+        using Thread = std::thread;
+
+        // 默认构造函数，线程数默认为CPU核心数
+        WorkStealingThreadPool()
+            : WorkStealingThreadPool(Thread::hardware_concurrency())
+        {
+        }
+
+        explicit WorkStealingThreadPool(size_t threads)
+            : quit_(false),
+              pending_(0),
+              sleepers_(0),
+              next_(0),
+              queues_(threads == 0 ? 1 : threads)
+        {
+            for (size_t i = 0; i < queues_.size(); i++)
+                threads_.emplace_back(&WorkStealingThreadPool::worker, this, i);
+        }
+
+        WorkStealingThreadPool(const WorkStealingThreadPool &) = delete;
+        WorkStealingThreadPool &operator=(const WorkStealingThreadPool &) = delete;
+
+        // 析构时先执行完所有已提交的任务, 再让线程退出
+        ~WorkStealingThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> guard(sleepMutex_);
+                quit_ = true;
+            }
+            sleepCv_.notify_all();
+            for (auto &t : threads_)
+            {
+                assert(t.joinable());
+                t.join();
+            }
+        }
+
+        /**
+         * @brief 提交一个任务到线程池
+         * @tparam Func 函数类型
+         * @tparam Ts 参数类型
+         * @param func 函数对象
+         * @param params 函数参数
+         * @return std::future<ReturnType> 一个与任务关联的future对象，用于获取任务的返回值
+         */
+        template <typename Func, typename... Ts>
+        auto submit(Func &&func, Ts &&...params)
+            -> std::future<typename std::result_of<Func(Ts...)>::type>
+        {
+            using ReturnType = typename std::result_of<Func(Ts...)>::type;
+            auto execute = std::bind(std::forward<Func>(func), std::forward<Ts>(params)...);
+
+            // 共享状态由 StatePool 分配
+            std::promise<ReturnType> promise(std::allocator_arg, StateAllocator<char>());
+            auto result = promise.get_future();
+            push(InlineTask(PromiseTask<ReturnType, decltype(execute)>(std::move(promise), std::move(execute))));
+            return result;
+        }
+
+        // 获取当前线程池中的线程数量
+        size_t threadsNum() const { return threads_.size(); }
+
+    private:
+        static constexpr size_t QUEUE_CAPACITY = 256; // 每个工作线程队列的容量, 必须是2的幂
+        static constexpr int SPIN_ROUNDS = 64;        // 休眠前的自旋窃取次数
+
+        // 把执行结果写入 promise
+        template <typename R, typename F>
+        struct PromiseTask
+        {
+            std::promise<R> promise;
+            F func;
+
+            PromiseTask(std::promise<R> &&p, F &&f) : promise(std::move(p)), func(std::move(f)) {}
+
+            void operator()()
+            {
+                try
+                {
+                    fulfill(promise, func);
+                }
+                catch (...)
+                {
+                    promise.set_exception(std::current_exception());
+                }
+            }
+
+            template <typename P>
+            static void fulfill(std::promise<P> &p, F &f) { p.set_value(f()); }
+            static void fulfill(std::promise<void> &p, F &f)
+            {
+                f();
+                p.set_value();
+            }
+        };
+
+        // 定长环形队列; 所属线程从头部取, 窃取者从尾部取
+        struct WorkQueue
+        {
+            SpinLock lock;
+            size_t head = 0;
+            size_t tail = 0;
+            std::vector<InlineTask> slots;
+
+            WorkQueue() : slots(QUEUE_CAPACITY) {}
+
+            bool push(InlineTask &task)
+            {
+                std::lock_guard<SpinLock> guard(lock);
+                if (tail - head >= QUEUE_CAPACITY)
+                    return false;
+                slots[tail++ & (QUEUE_CAPACITY - 1)] = std::move(task);
+                return true;
+            }
+
+            bool popFront(InlineTask &task)
+            {
+                std::lock_guard<SpinLock> guard(lock);
+                if (head == tail)
+                    return false;
+                task = std::move(slots[head++ & (QUEUE_CAPACITY - 1)]);
+                return true;
+            }
+
+            bool popBack(InlineTask &task)
+            {
+                std::lock_guard<SpinLock> guard(lock);
+                if (head == tail)
+                    return false;
+                task = std::move(slots[--tail & (QUEUE_CAPACITY - 1)]);
+                return true;
+            }
+        };
+
+        static size_t &workerIndex()
+        {
+            // 非工作线程为 SIZE_MAX
+            static thread_local size_t index = SIZE_MAX;
+            return index;
+        }
+
+        void push(InlineTask &&task)
+        {
+            assert(!quit_);
+            // 工作线程内部提交的任务放进自己的队列, 外部提交轮流分配
+            size_t start = workerIndex() < queues_.size() ? workerIndex() : next_.fetch_add(1, std::memory_order_relaxed);
+            // 先计数再入队, 保证取走任务的线程看到的 pending_ 不会小于0
+            pending_.fetch_add(1);
+            while (true)
+            {
+                for (size_t i = 0; i < queues_.size(); i++)
+                {
+                    if (queues_[(start + i) % queues_.size()].push(task))
+                    {
+                        if (sleepers_.load() > 0)
+                        {
+                            std::lock_guard<std::mutex> guard(sleepMutex_);
+                            sleepCv_.notify_one();
+                        }
+                        return;
+                    }
+                }
+                // 所有队列都满了, 等工作线程消化
+                std::this_thread::yield();
+            }
+        }
+
+        bool take(size_t self, InlineTask &task)
+        {
+            if (queues_[self].popFront(task))
+                return true;
+            for (size_t i = 1; i < queues_.size(); i++)
+            {
+                if (queues_[(self + i) % queues_.size()].popBack(task))
+                    return true;
+            }
+            return false;
+        }
+
+        // 工作线程的主函数
+        void worker(size_t self)
+        {
+            workerIndex() = self;
+            InlineTask task;
+            int idleRounds = 0;
+            while (true)
+            {
+                if (take(self, task))
+                {
+                    pending_.fetch_sub(1);
+                    task();
+                    task = InlineTask();
+                    idleRounds = 0;
+                    continue;
+                }
+                if (++idleRounds < SPIN_ROUNDS)
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                idleRounds = 0;
+
+                std::unique_lock<std::mutex> lock(sleepMutex_);
+                if (quit_ && pending_.load() == 0)
+                    return;
+                ++sleepers_;
+                sleepCv_.wait(lock, [this]()
+                              { return quit_ || pending_.load() > 0; });
+                --sleepers_;
+            }
+        }
+
+        bool quit_;                          // 线程池退出标志, 受 sleepMutex_ 保护
+        std::atomic<size_t> pending_;        // 已提交但尚未被取走的任务数
+        std::atomic<size_t> sleepers_;       // 正在休眠的线程数
+        std::atomic<size_t> next_;           // 外部提交的轮转起点
+        std::vector<WorkQueue> queues_;      // 每个工作线程一个队列
+        std::vector<Thread> threads_;        // 常驻工作线程
+        std::mutex sleepMutex_;
+        std::condition_variable sleepCv_;
+    };
+
+} // namespace dpool
+
+#endif /* WORKSTEALINGTHREADPOOL_H */
@@ -4,14 +4,50 @@
 #include "rknn_api.h"
 #include "postprocess.h" // 使用新的postprocess.h
 #include "preprocess.h"  // 预处理可以复用
+#include "DetectionRecord.hpp"
+#include "coreNum.hpp"
 #include "opencv2/core/core.hpp"
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+// 预处理缩放方式: STRETCH 直接拉伸到模型尺寸; LETTERBOX 保持纵横比缩放, 其余部分填充
+enum class ResizeMode
+{
+    STRETCH,
+    LETTERBOX
+};
+
+// 后处理读取的输出格式: INT8 量化输出按查表解码; FP16 直接读取运行时的原生半精度输出;
+// FP32 由运行时转换为float(want_float = 1)
+enum class OutputType
+{
+    INT8,
+    FP16,
+    FP32
+};
+
+// 构造模型时传入的配置, 同一进程中的多个池(如大小模型)可以各用一份
+struct Yolo11Options
+{
+    ResizeMode resize_mode = ResizeMode::STRETCH; // 预处理缩放方式, 之后可用 set_resize_mode 修改
+    bool want_float = false; // 总是让运行时把输出转换为float32, 不使用int8/fp16的原生输出
+    decode_config decode;    // 解码参数和标签文件
+    std::vector<std::vector<int>> stream_classes; // 各视频流只解码的类别, 下标为视频流编号, 为空的流解码所有类别; 编号都超出类别数的流没有检测结果
+    bool zero_copy = false;  // 输入用 rknn_create_mem 分配并绑定, 预处理直接写入, 省去 rknn_inputs_set 的拷贝
+    bool native_output = false; // int8 模型由 detect/infer 直接解码原生 NC1HWC2 布局的输出; 非int8模型及分阶段接口仍使用 NCHW
+    // 异步推理: detect/infer 提交一帧后释放上下文再等待结果, 其他线程可以在这期间上传并提交下一帧;
+    // 同一模型应由多个线程调用(如 rknnPool::setFramesPerModel), 分阶段接口不支持异步推理
+    bool async = false;
+};
 
 class Yolo11
 {
 private:
     rknn_context rknn_ctx;
-    std::mutex mtx;
+    std::mutex mtx;       // 保护rknn上下文(run阶段)
     std::string model_path;
 
     rknn_input_output_num io_num;
@@ -22,6 +58,51 @@ private:
     int model_height;
     int model_channel;
     bool is_quant;
+    rknn_core_mask core_mask; // 绑定的NPU核心, RKNN_NPU_CORE_UNDEFINED 表示 init 时按轮询绑定单个核心
+    int npu_cores;            // init 时检测到的NPU核心数
+    std::atomic<long long> run_count, run_wall_us, run_npu_us; // rknn_run 的累计耗时
+    void record_run(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point done, bool query_perf);
+    std::atomic<bool> use_rga; // 没有librga或RGA连续失败后改用CPU预处理
+    std::atomic<int> rga_failures; // RGA连续失败的帧数, 成功一帧后清零
+    ResizeMode resize_mode;
+    std::vector<float> dfl_exp_lut; // 每个int8输出256项的exp表, 供DFL解码查表
+    OutputType output_type;
+    bool want_float; // 构造时指定, init 时据此确定 output_type
+    bool zero_copy; // 输入用 rknn_create_mem 分配并以 rknn_set_io_mem 绑定, 预处理直接写入
+    rknn_tensor_attr input_mem_attr; // 绑定输入内存时的属性(uint8 NHWC)
+    rknn_tensor_mem *bound_input;    // 当前绑定到上下文的输入内存, 受mtx保护
+    bool native_output; // int8 输出以原生 NC1HWC2 布局绑定到 rknn_create_mem 的内存, 运行时不再转换为 NCHW
+    bool async_run; // 以 RKNN_FLAG_ASYNC_MASK 初始化, rknn_run 只提交不等待, 同一上下文可以有多帧在途
+    bool async_overlap; // 运行时在 rknn_run 时记下当时的输出绑定(init 时试跑检查); 为false时异步上下文持锁等待, 同一时刻只有一帧在途
+    std::chrono::steady_clock::time_point async_last_done; // 异步上下文上一帧等待结束的时间, 受mtx保护
+    bool check_async_bindings();
+    std::vector<rknn_tensor_attr> output_mem_attrs; // 绑定输出内存时的属性: 原生布局, 或异步推理时的 NCHW
+    rknn_tensor_mem *const *bound_outputs;          // 当前绑定到上下文的一组输出内存, 受mtx保护
+    int num_class; // 由 score 输出的通道数得到
+    decode_config decode_cfg;
+    std::vector<std::string> labels;
+    std::vector<std::vector<int>> stream_classes; // 各视频流允许的类别
+    std::vector<char> stream_class_set; // 对应的流设置过非空的类别列表; 列表中的编号都超出类别数时过滤后为空, 该流不输出检测结果
+    bool filter_classes(std::vector<int> &classes) const;
+
+    // infer 每帧复用的临时缓冲; 同一模型可能被多个线程同时调用, 按需创建, 用完归还
+    struct Scratch
+    {
+        cv::Mat input_img; // 模型尺寸的输入; 零拷贝时指向 input_mem, 行间距为 w_stride
+        rknn_tensor_mem *input_mem = nullptr;
+        std::vector<rknn_tensor_mem *> output_mems; // 原生布局输出或异步推理时每个输出一块, outputs[i].buf 指向其中
+        BOX_RECT letter_box; // 预处理的填充量和还原比例
+        std::vector<std::vector<uint8_t>> out_bufs;
+        std::vector<rknn_output> outputs; // 预分配输出, 不占用rknn上下文的内部缓冲
+        post_process_buffers post;
+    };
+    std::mutex scratch_mtx;
+    std::vector<std::unique_ptr<Scratch>> scratch_all;
+    std::vector<Scratch *> scratch_free;
+    Scratch *acquire_scratch();
+    void destroy_scratch_mems(Scratch *scratch);
+    void release_scratch(Scratch *scratch);
+    std::shared_ptr<DetectionRecordPool> record_pool; // infer(DetectionRequest) 返回的记录
 
 public:
     // 公共getter方法，供postprocess函数访问
@@ -30,13 +111,74 @@ public:
     int get_io_num_n_output() const { return io_num.n_output; }
     bool get_is_quant() const { return is_quant; }
     rknn_tensor_attr* get_output_attrs() const { return output_attrs; }
+    OutputType get_output_type() const { return output_type; }
+    // 第index个输出的DFL exp表, 非int8模型返回nullptr
+    const float *get_dfl_exp_lut(int index) const { return dfl_exp_lut.empty() ? nullptr : &dfl_exp_lut[index * 256]; }
+    // 绑定的编号最小的核心, 未绑定(RKNN_NPU_CORE_AUTO)时为-1
+    int get_core_id() const { return get_first_core(core_mask); }
+    rknn_core_mask get_core_mask() const { return core_mask; }
+    int get_npu_cores() const { return npu_cores; }
+    // 累计的推理次数和耗时, 供 rknnPool 统计各核心的负载
+    rknnRunStats get_run_stats() const { return {run_count.load(), run_wall_us.load(), run_npu_us.load()}; }
+    // 设置上下文使用的NPU核心: init 之前调用时由 init 绑定, 之后调用对下一次提交的帧生效; 失败返回-1
+    int set_core_mask(rknn_core_mask mask);
+    ResizeMode get_resize_mode() const { return resize_mode; }
+    // 只影响之后的预处理, 应在开始推理前设置
+    void set_resize_mode(ResizeMode mode) { resize_mode = mode; }
+    bool get_zero_copy() const { return zero_copy; }
+    bool get_native_output() const { return native_output; }
+    const rknn_tensor_attr *get_output_mem_attrs() const { return native_output ? output_mem_attrs.data() : nullptr; }
+    bool get_async() const { return async_run; }
+    int get_num_class() const { return num_class; }
+    const decode_config &get_decode_config() const { return decode_cfg; }
+    // 标签文件在 init 时读取, 应在 init 前设置
+    void set_decode_config(const decode_config &config) { decode_cfg = config; }
+    // 设置某一路视频流只解码的类别, 空列表表示所有类别; 需在 init 之后、开始推理前调用
+    void set_stream_classes(int stream, const std::vector<int> &classes);
+    // 第stream路的类别列表, 不限制时返回nullptr; 返回空列表表示没有可检测的类别
+    const std::vector<int> *get_stream_classes(int stream) const
+    {
+        return stream >= 0 && stream < (int)stream_class_set.size() && stream_class_set[stream] ? &stream_classes[stream] : nullptr;
+    }
+    // 类别名, 标签文件缺少该类别时返回"null"
+    const char *get_label(int cls_id) const { return cls_id >= 0 && cls_id < (int)labels.size() ? labels[cls_id].c_str() : "null"; }
+    // 按 output_type 为每个输出准备预分配缓冲, 供 run 使用; 成功返回0
+    int prepare_outputs(std::vector<std::vector<uint8_t>> &bufs, std::vector<rknn_output> &outputs) const;
 
 public:
-    Yolo11(const std::string &model_path);
+    Yolo11(const std::string &model_path, const Yolo11Options &options = Yolo11Options());
     int init(rknn_context *ctx_in, bool isChild); // 保持与rknnPool兼容的init接口
     rknn_context *get_pctx();
-    cv::Mat infer(cv::Mat &ori_img);
+    // stream 为视频流编号, 决定解码的类别
+    cv::Mat infer(cv::Mat &ori_img, int stream = 0);
+    // 只返回检测记录, 不绘制; 供 rknnPool<Yolo11, DetectionRequest, DetectionHandle> 使用
+    // 检测失败时返回没有检测框的记录, 内存不足时返回空
+    DetectionHandle infer(const DetectionRequest &request, int stream = 0);
+    // 只做检测不绘制, 稳定运行后不再分配堆内存
+    int detect(const cv::Mat &orig_img, object_detect_result_list *od_results, int stream = 0);
     ~Yolo11();
+
+public:
+    // 以下为infer拆分出的各阶段, 供流水线(rknnPipeline.hpp)由不同线程分别调用
+    // 预处理: BGR原图 -> 模型尺寸的RGB输入(缩放和颜色转换一次完成), 不访问rknn上下文, 可并发调用
+    // letter_box 输出填充量和坐标还原比例, 交给 postprocess
+    int preprocess(const cv::Mat &orig_img, cv::Mat &input_img, BOX_RECT &letter_box);
+    // NPU推理: 持有mtx执行 inputs_set/run/outputs_get; outputs 由调用方准备, 可为预分配内存
+    // input_mem 不为空时 input_img 必须是该内存的视图, 推理直接读取它而不经过 rknn_inputs_set 的拷贝
+    // output_mems 不为空时为每个输出绑定的内存(属性见 output_mem_attrs), 推理结果直接写入, 不调用 rknn_outputs_get;
+    // 异步模式下只在提交时持有mtx, 等待结果时其他线程可以提交下一帧; 异步模式必须提供 output_mems, 否则返回-1
+    int run(const cv::Mat &input_img, rknn_output *outputs, rknn_tensor_mem *input_mem = nullptr,
+            rknn_tensor_mem *const *output_mems = nullptr);
+    // 释放run得到的非预分配输出
+    void release_outputs(rknn_output *outputs);
+    // 后处理: 解码+NMS, 按 letter_box 去掉填充并把坐标还原到原图尺寸, 只读模型属性, 可并发调用
+    // native_layout 表示 outputs 为 run 写入 output_mems 的原生布局输出
+    int postprocess(rknn_output *outputs, const BOX_RECT &letter_box, object_detect_result_list *od_results,
+                    post_process_buffers *buffers = nullptr, int stream = 0, bool native_layout = false);
+    // 绘制检测结果
+    void draw(cv::Mat &img, const object_detect_result_list &od_results) const;
+    // 绘制记录中的检测结果, 可以在推理之后由其他线程单独进行
+    void draw(cv::Mat &img, const DetectionRecord &record) const;
 };
 
 #endif // YOLO11_HPP
\ No newline at end of file
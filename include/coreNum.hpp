@@ -2,22 +2,146 @@
 #define CORENUM_H
 
 #include <stdio.h>
+#include <mutex>
+#include <memory>
+#include <vector>
 
 #include "rknn_api.h"
 
-const int RK3588 = 3;
+// rknn_core_mask 最多描述3个核心(RK3588)
+const int NPU_MAX_CORES = 3;
 
-// 设置模型需要绑定的核心
+// 一个上下文累计的 rknn_run 耗时/Accumulated rknn_run timing of one context
+struct rknnRunStats
+{
+    long long runs;
+    long long wallUs; // 提交到完成的墙钟时间, 包括等待核心空闲
+    long long npuUs;  // RKNN_QUERY_PERF_RUN 得到的执行时间, 查询失败时同墙钟时间
+};
+
+// 一组上下文的NPU核心分配策略/Core-mask strategy for the contexts of a pool
+enum class rknnCoreStrategy
+{
+    SINGLE, // 每个上下文绑定一个核心, 各上下文轮流分到不同核心, 吞吐最高(默认)
+    MULTI,  // 每个上下文在所有可用核心上联合推理(RKNN_NPU_CORE_0_1 / 0_1_2), 单帧延迟最低
+    MIXED,  // 第一个上下文在核心0/1上联合推理, 其余上下文各绑定一个剩下的核心
+    AUTO    // 由运行时为每帧挑选空闲核心(RKNN_NPU_CORE_AUTO)
+};
+
+// 检测NPU核心数(1~3): 依次尝试绑定核心2、核心1, 运行时拒绝时说明没有该核心; 结果只检测一次。
+// 会改变 ctx 的核心掩码, 调用后需重新设置
+inline int get_npu_core_num(rknn_context ctx)
+{
+    static int core_count = 0;
+    static std::mutex mtx;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (core_count == 0)
+    {
+        core_count = 1;
+        for (int i = NPU_MAX_CORES - 1; i > 0; i--)
+        {
+            if (rknn_set_core_mask(ctx, (rknn_core_mask)(RKNN_NPU_CORE_0 << i)) == RKNN_SUCC)
+            {
+                core_count = i + 1;
+                break;
+            }
+        }
+        printf("NPU cores: %d\n", core_count);
+    }
+    return core_count;
+}
+
+// 设置模型需要绑定的核心, 在 cores 个核心中依次轮换; 供不经过 init_models 单独创建的模型使用
 // Set the core of the model that needs to be bound
-int get_core_num()
+inline int get_core_num(int cores)
 {
     static int core_num = 0;
     static std::mutex mtx;
 
     std::lock_guard<std::mutex> lock(mtx);
 
-    int temp = core_num % RK3588;
+    int temp = core_num % cores;
     core_num++;
     return temp;
 }
-#endif
\ No newline at end of file
+
+// 第index个上下文的核心掩码; cores 为检测到的核心数, coreSet 为允许使用的核心, RKNN_NPU_CORE_AUTO 表示全部。
+// 单核绑定时第index个上下文使用 coreSet 中的第 index % 核心数 个核心, 只取决于 index, 不受其他池创建的上下文影响。
+// 运行时只支持核心0/1及0/1/2联合推理, coreSet 中没有这样的组合时 MULTI/MIXED 退化为单核轮换; AUTO 不受 coreSet 限制
+inline rknn_core_mask get_core_mask(rknnCoreStrategy strategy, int index, int cores, rknn_core_mask coreSet)
+{
+    // 单核平台不支持设置核心
+    if (cores <= 1 || strategy == rknnCoreStrategy::AUTO)
+        return RKNN_NPU_CORE_AUTO;
+    int all = (1 << cores) - 1;
+    int set = coreSet & all;
+    if (coreSet == RKNN_NPU_CORE_AUTO || set == 0)
+        set = all;
+
+    int combined = 0;
+    if ((set & RKNN_NPU_CORE_0_1_2) == RKNN_NPU_CORE_0_1_2)
+        combined = RKNN_NPU_CORE_0_1_2;
+    else if ((set & RKNN_NPU_CORE_0_1) == RKNN_NPU_CORE_0_1)
+        combined = RKNN_NPU_CORE_0_1;
+    if (strategy == rknnCoreStrategy::MULTI && combined != 0)
+        return (rknn_core_mask)combined;
+    if (strategy == rknnCoreStrategy::MIXED && combined != 0)
+    {
+        if (index == 0)
+            return RKNN_NPU_CORE_0_1;
+        // 其余上下文使用核心0/1以外的核心, 没有时与第一个上下文共用
+        if ((set & ~RKNN_NPU_CORE_0_1) != 0)
+            set &= ~RKNN_NPU_CORE_0_1;
+    }
+
+    int n = 0;
+    for (int i = 0; i < cores; i++)
+        n += (set >> i) & 1;
+    // MIXED 的第一个上下文已占用核心0/1, 其余上下文从剩下的第一个核心开始
+    int k = (strategy == rknnCoreStrategy::MIXED && combined != 0 ? index - 1 : index) % n;
+    for (int i = 0; i < cores; i++)
+    {
+        if (((set >> i) & 1) && k-- == 0)
+            return (rknn_core_mask)(RKNN_NPU_CORE_0 << i);
+    }
+    return RKNN_NPU_CORE_AUTO;
+}
+
+// 掩码中编号最小的核心, RKNN_NPU_CORE_AUTO 返回-1
+inline int get_first_core(rknn_core_mask mask)
+{
+    for (int i = 0; i < NPU_MAX_CORES; i++)
+    {
+        if (mask & (1 << i))
+            return i;
+    }
+    return -1;
+}
+
+// 初始化共享权重的一组模型(第一个创建上下文, 其余复制), 并按策略为各上下文绑定核心。
+// 第一个模型先以 RKNN_NPU_CORE_AUTO 初始化, 用它的上下文检测核心数后再绑定; rknnModel 需提供 set_core_mask/get_npu_cores
+template <typename rknnModel>
+int init_models(std::vector<std::shared_ptr<rknnModel>> &models, rknnCoreStrategy strategy, rknn_core_mask coreSet)
+{
+    int ret = 0;
+    for (int i = 0; i < (int)models.size(); i++)
+    {
+        if (i == 0)
+        {
+            models[0]->set_core_mask(RKNN_NPU_CORE_AUTO);
+            ret = models[0]->init(nullptr, false);
+            if (ret == 0)
+                ret = models[0]->set_core_mask(get_core_mask(strategy, 0, models[0]->get_npu_cores(), coreSet));
+        }
+        else
+        {
+            models[i]->set_core_mask(get_core_mask(strategy, i, models[0]->get_npu_cores(), coreSet));
+            ret = models[i]->init(models[0]->get_pctx(), true);
+        }
+        if (ret != 0)
+            return ret;
+    }
+    return 0;
+}
+#endif
@@ -2,14 +2,13 @@
 #define _RKNN_YOLO11_DEMO_POSTPROCESS_H_
 
 #include <stdint.h>
+#include <string>
 #include <vector>
 #include "rknn_api.h"
 
 #define OBJ_NAME_MAX_SIZE 64
-#define OBJ_NUMB_MAX_SIZE 128
-#define OBJ_CLASS_NUM 80
-#define NMS_THRESH 0.45
-#define BOX_THRESH 0.25
+#define OBJ_NUMB_MAX_SIZE 128   // 每帧检测结果的容量, decode_config::max_detections 不能超过它
+#define OBJ_CLASS_MAX_NUM 127   // int8 类别扫描用 int8_t 记录类别编号
 
 class Yolo11;
 
@@ -36,9 +35,90 @@ typedef struct {
     object_detect_result results[OBJ_NUMB_MAX_SIZE];
 } object_detect_result_list;
 
-int init_post_process();
-void deinit_post_process();
-char *coco_cls_to_name(int cls_id);
-int post_process(Yolo11 *model_instance, rknn_output *outputs, BOX_RECT *letter_box, float conf_threshold, float nms_threshold, object_detect_result_list *od_results);
+// post_process 的中间结果缓冲, 由调用方持有并跨帧复用, 容量稳定后不再分配内存
+typedef struct {
+    std::vector<float> boxes;     // 候选框 x, y, w, h
+    std::vector<float> probs;     // 候选框得分
+    std::vector<int> class_ids;   // 候选框类别
+    std::vector<int> order;       // 按类别分桶、桶内按得分排序后的候选框下标
+    // NMS 的中间数据(见 nms_select)
+    std::vector<int> class_start; // 每个类别的桶在 order 中的起点
+    std::vector<float> nms_x1, nms_y1, nms_x2, nms_y2, nms_area; // 桶内排序后的候选框, SoA 排列便于向量化计算IoU
+    std::vector<uint8_t> suppressed;
+    std::vector<int> keep;        // NMS 保留的候选框下标, 按得分降序
+} post_process_buffers;
+
+// NMS 参数
+typedef struct {
+    int pre_nms_topk;   // 每个类别(class_offset 时为全部候选)只取得分最高的前K个参与NMS, <=0 表示不限制
+    bool class_offset;  // 按类别编号平移坐标后对所有候选一次做NMS, 不同类别的框互不重叠, 省去逐类别处理
+} nms_options;
+
+// 每个模型的解码参数, 在 Yolo11::init 时确定; 类别数由模型的 score 输出读取, 不在这里配置
+struct decode_config
+{
+    float conf_threshold = 0.25f;
+    float nms_threshold = 0.45f;
+    std::vector<float> class_thresholds; // 按类别编号的分数阈值, 未给出的类别使用 conf_threshold
+    int max_detections = OBJ_NUMB_MAX_SIZE;
+    std::string label_path = "./model/coco_80_labels_list.txt";
+    nms_options nms = {0, false};
+};
+
+/*
+ * process_i8 的类别扫描(src/class_scan.cc): 对一行 grid_w 个格子, 在 num_class 个连续排列的类别平面上
+ * 求每个格子中分数严格大于该类别阈值 bars[c] 的最大分数和第一个取得该分数的类别(没有则为-1, 分数无意义),
+ * 返回这一行是否有格子通过。score_row 指向第0个类别平面中该行的起点, 相邻类别平面相距 grid_len。
+ * 1/3/20/80 类有编译期展开的专用版本, 其他类别数(不超过 OBJ_CLASS_MAX_NUM)使用通用版本。
+ */
+bool class_scan_row(const int8_t *score_row, int grid_len, int grid_w, int num_class, const int8_t *bars,
+                    int8_t *row_max, int8_t *row_cls);
+// 只扫描 class_ids 中列出的 n_ids 个类别平面(升序), 其余类别平面不读取; bars 按列表顺序给出, row_cls 为实际的类别编号
+bool class_scan_row_list(const int8_t *score_row, int grid_len, int grid_w, const int *class_ids, int n_ids,
+                         const int8_t *bars, int8_t *row_max, int8_t *row_cls);
+// 逐格子的标量版本, 结果与 class_scan_row 完全一致, 供对比测试
+bool class_scan_row_scalar(const int8_t *score_row, int grid_len, int grid_w, int num_class, const int8_t *bars,
+                           int8_t *row_max, int8_t *row_cls);
+/*
+ * 原生 NC1HWC2 布局的类别扫描, 结果与 class_scan_row 相同(类别编号为 b * c2 + l)。
+ * score_row 指向第0组中该行第一个格子, 格子j第b组的 c2 个类别位于 score_row + b * block_stride + j * c2;
+ * 只读取 groups 中列出的 n_groups 个组(升序), 不限制类别时为全部 c1 组, 限制类别时为含有所选类别的组;
+ * bars 共 c1 * c2 项, 补齐的通道及不解码的类别应为127。c2 == 16 时使用 NEON/SSE2, 其他宽度为标量版本。
+ */
+bool class_scan_row_native(const int8_t *score_row, int block_stride, int grid_w, const int *groups, int n_groups, int c2,
+                           const int8_t *bars, int8_t *row_max, int8_t *row_cls);
+bool class_scan_row_native_scalar(const int8_t *score_row, int block_stride, int grid_w, const int *groups, int n_groups, int c2,
+                                  const int8_t *bars, int8_t *row_max, int8_t *row_cls);
+// 运行时选中的指令集("neon"/"sse2"/"avx2"/"scalar")
+const char *class_scan_isa();
+
+/*
+ * int8框张量的DFL解码: 每个张量的 zp/scale 固定, 只有256种输入, exp 结果预先查表。
+ * build_dfl_exp_lut 生成256项的表(下标为 q + 128); compute_dfl_i8 的 box_cell 指向第0个bin平面中该格子的位置,
+ * 相邻bin平面相距 grid_len, 输出4条边到格子中心的距离(以stride为单位)。
+ */
+void build_dfl_exp_lut(int32_t zp, float scale, float *lut);
+void compute_dfl_i8(const int8_t *box_cell, int grid_len, int dfl_len, const float *exp_lut, float *box);
+
+/*
+ * 对 buffers 中的 boxes/probs/class_ids 做按类别的NMS(src/postprocess.cc): 候选按类别一次分桶,
+ * 桶内用 nth_element 取前 pre_nms_topk 个后排序, IoU 按 NEON/SSE2 四路成块计算, IoU 大于 threshold 的低分框被抑制。
+ * 保留的候选下标按得分降序写入 buffers->keep, 最多 max_keep 个, 返回保留的数量。
+ */
+int nms_select(post_process_buffers *buffers, int num_class, float threshold, const nms_options *opts, int max_keep);
+
+// 半精度输出转单精度(src/postprocess.cc), 原生fp16输出的后处理按行调用; 运行时选择 F16C/NEON/标量实现
+void fp16_to_fp32(const uint16_t *src, float *dst, int n);
+const char *fp16_convert_isa();
+
+// 按行读取标签文件, 最多 max_count 行; 打开失败返回-1
+int load_labels(const char *path, int max_count, std::vector<std::string> &labels);
+// 阈值和NMS参数取自模型的 decode_config
+// letter_box: left/top 为预处理的填充量, scale_w/scale_h 为去掉填充后还原到原图的比例; buffers 为空时使用临时缓冲
+// classes: 只解码其中的类别(升序且不重复), 为nullptr时解码所有类别, 为空列表时没有检测结果
+// native_attrs: 不为空时 outputs 为 int8 原生 NC1HWC2 布局, 各输出的组宽等取自这些属性, 量化参数仍取自模型的 NCHW 输出属性
+int post_process(Yolo11 *model_instance, rknn_output *outputs, const BOX_RECT *letter_box, object_detect_result_list *od_results,
+                 post_process_buffers *buffers = nullptr, const std::vector<int> *classes = nullptr,
+                 const rknn_tensor_attr *native_attrs = nullptr);
 
 #endif //_RKNN_YOLO11_DEMO_POSTPROCESS_H_
\ No newline at end of file
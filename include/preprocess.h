@@ -20,15 +20,77 @@
  */
 void letterbox(const cv::Mat &image, cv::Mat &padded_image, BOX_RECT &pads, const float scale, const cv::Size &target_size, const cv::Scalar &pad_color = cv::Scalar(128, 128, 128));
 
+/**
+ * @brief 计算letterbox的填充量, 以及把模型输入上的坐标(减去填充后)还原到原图的比例。
+ * @param image_size    [in] 原图尺寸。
+ * @param scale         [in] 缩放因子。
+ * @param target_size   [in] 最终的目标尺寸。
+ * @param pads          [out] left/right/top/bottom 为填充量, scale_w/scale_h 为原图与缩放后内部区域的尺寸比。
+ */
+void letterbox_pads(const cv::Size &image_size, const float scale, const cv::Size &target_size, BOX_RECT &pads);
+
 /**
  * @brief 使用Rockchip RGA硬件加速单元来调整图像尺寸。
  * @param src           [in] RGA源缓冲区的句柄。
  * @param dst           [in] RGA目标缓冲区的句柄。
  * @param image         [in] 输入的原始cv::Mat图像。
- * @param resized_image [out] 经过缩放后的输出cv::Mat图像。
+ * @param resized_image [out] 经过缩放后的输出cv::Mat图像(RGB888)。
+ * @param target_size   [in] 最终的目标尺寸。
+ * @param src_format    [in] 输入图像格式; 为RK_FORMAT_BGR_888时RGA在缩放的同一次处理中转换为RGB。
+ * @return int 0表示成功，其他值表示失败。
+ */
+int resize_rga(rga_buffer_t &src, rga_buffer_t &dst, const cv::Mat &image, cv::Mat &resized_image, const cv::Size &target_size,
+               int src_format = RK_FORMAT_RGB_888);
+
+/**
+ * @brief 使用RGA一次完成letterbox: 缩放写入目标图像的内部区域, 边框由RGA填充。
+ * @param src           [in] RGA源缓冲区的句柄。
+ * @param dst           [in] RGA目标缓冲区的句柄。
+ * @param image         [in] 输入的原始cv::Mat图像。
+ * @param padded_image  [in/out] 已分配为目标尺寸的输出图像(RGB888)。
+ * @param pads          [out] 填充量和坐标还原比例, 见 letterbox_pads。
+ * @param scale         [in] 缩放因子。
  * @param target_size   [in] 最终的目标尺寸。
+ * @param src_format    [in] 输入图像格式; 为RK_FORMAT_BGR_888时同时转换为RGB。
+ * @param pad_color     [in] 填充颜色, 按RGB顺序给出。
  * @return int 0表示成功，其他值表示失败。
  */
-int resize_rga(rga_buffer_t &src, rga_buffer_t &dst, const cv::Mat &image, cv::Mat &resized_image, const cv::Size &target_size);
+int letterbox_rga(rga_buffer_t &src, rga_buffer_t &dst, const cv::Mat &image, cv::Mat &padded_image, BOX_RECT &pads,
+                  const float scale, const cv::Size &target_size, int src_format = RK_FORMAT_RGB_888,
+                  const cv::Scalar &pad_color = cv::Scalar(128, 128, 128));
+
+/**
+ * @brief 查询librga是否可用。librga在首次调用时通过dlopen加载, 缺失(如x86测试机)时返回false,
+ *        此时 resize_rga 直接返回-1, 调用方应改用下面的CPU预处理。
+ */
+bool rga_available();
+
+/**
+ * @brief 在CPU上一次完成双线性缩放和BGR->RGB通道交换(NEON/SSE2/AVX2), 代替全分辨率cvtColor + 缩放两步。
+ * @param image         [in] 输入的BGR888图像。
+ * @param resized_image [out] 缩放后的RGB888图像。
+ * @param target_size   [in] 目标尺寸。
+ * @return int 0表示成功，-1表示失败。
+ */
+int resize_bgr2rgb_cpu(const cv::Mat &image, cv::Mat &resized_image, const cv::Size &target_size);
+
+/**
+ * @brief letterbox() 的CPU单遍实现: 缩放结果直接写入填充后图像的内部区域, 只填充边框, 可同时交换通道。
+ * @param image         [in] 输入的BGR888图像。
+ * @param padded_image  [out] 经过处理后的输出图像。
+ * @param pads          [out] 填充量和坐标还原比例, 见 letterbox_pads。
+ * @param scale         [in] 缩放因子。
+ * @param target_size   [in] 最终的目标尺寸。
+ * @param pad_color     [in] 填充颜色, 按输出图像的通道顺序给出。
+ * @param bgr2rgb       [in] 为true时输出RGB, 否则保持BGR。
+ * @return int 0表示成功，-1表示失败。
+ */
+int letterbox_cpu(const cv::Mat &image, cv::Mat &padded_image, BOX_RECT &pads, const float scale, const cv::Size &target_size,
+                  const cv::Scalar &pad_color = cv::Scalar(128, 128, 128), bool bgr2rgb = true);
+
+/**
+ * @brief 返回CPU预处理在运行时选中的向量指令集("neon"/"sse2"/"avx2"/"scalar")。
+ */
+const char *resize_cpu_isa();
 
 #endif //_RKNN_YOLOV5_DEMO_PREPROCESS_H_
\ No newline at end of file
@@ -0,0 +1,252 @@
+#ifndef RKNNPIPELINE_H
+#define RKNNPIPELINE_H
+
+#include "BoundedQueue.hpp"
+#include "coreNum.hpp"
+#include "postprocess.h"
+#include "opencv2/core/core.hpp"
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+// 流水线各阶段的线程数
+struct PipelineConfig
+{
+    int npuThreads = 3;    // NPU阶段线程数, 每个线程独占一个rknn上下文
+    int preThreads = 2;    // 预处理(颜色转换+缩放)线程数
+    int postThreads = 2;   // 后处理(解码+NMS)线程数
+    int renderThreads = 1; // 绘制线程数
+    int depth = 0;         // 同时在流水线中的最大帧数, 0表示按线程数自动计算
+    rknnCoreStrategy coreStrategy = rknnCoreStrategy::SINGLE; // NPU阶段各上下文的核心分配策略
+    rknn_core_mask coreSet = RKNN_NPU_CORE_AUTO;              // 允许使用的核心, RKNN_NPU_CORE_AUTO 表示全部
+};
+
+/*
+ * 分阶段流水线: 预处理 -> NPU -> 后处理 -> 绘制, 阶段之间用有界队列连接,
+ * 使NPU上下文在CPU阶段处理上一帧时就能拿到下一帧的输入。
+ * rknnModel 需提供 preprocess/run/postprocess/draw (见 Yolo11.hpp)。
+ * 接口与 rknnPool 一致: put 提交一帧, get 按提交顺序取回绘制好的结果。
+ */
+template <typename rknnModel>
+class rknnPipeline
+{
+private:
+    struct Job
+    {
+        long long seq;
+        bool ok;
+        cv::Mat frame; // 原图, 绘制后作为结果返回
+        cv::Mat input; // 模型尺寸的输入
+        BOX_RECT letterBox; // 预处理的填充量和还原比例
+        std::vector<std::vector<uint8_t>> outBufs;
+        std::vector<rknn_output> outputs;
+        object_detect_result_list results;
+        post_process_buffers post;
+    };
+    using JobQueue = BoundedQueue<Job *>;
+
+    std::string modelPath;
+    PipelineConfig config;
+    std::function<std::shared_ptr<rknnModel>(const std::string &)> makeModel; // 为空时只以模型路径构造
+    std::vector<std::shared_ptr<rknnModel>> models;
+
+    // 所有帧对象在init时一次性分配, 通过freeQ循环使用
+    std::vector<Job> jobs;
+    std::unique_ptr<JobQueue> freeQ, preQ, npuQ, postQ, renderQ;
+    std::vector<std::vector<std::thread>> stages;
+
+    // 完成区: 在途帧数不超过depth, 以 seq % depth 为槽位即可按提交顺序取回
+    std::mutex doneMtx;
+    std::condition_variable doneCv;
+    std::vector<Job *> done;
+    long long putSeq, getSeq;
+
+    void startStage(int threads, JobQueue *in, JobQueue *out, std::function<void(Job *)> work);
+    void finish(Job *job);
+
+public:
+    rknnPipeline(const std::string modelPath, const PipelineConfig &config);
+    // 设置构造模型时传入的配置(如 Yolo11Options), 需在init之前调用
+    template <typename modelOptions>
+    void setModelOptions(const modelOptions &options);
+    int init();
+    // 提交一帧, 流水线满时阻塞/Submit a frame, blocks while the pipeline is full
+    int put(const cv::Mat &inputData);
+    // 按提交顺序获取结果/Get results in submission order
+    int get(cv::Mat &outputData);
+    // 流水线中最多同时存在的帧数
+    int getDepth() const { return config.depth; }
+    ~rknnPipeline();
+};
+
+template <typename rknnModel>
+rknnPipeline<rknnModel>::rknnPipeline(const std::string modelPath, const PipelineConfig &config)
+{
+    this->modelPath = modelPath;
+    this->config = config;
+    if (this->config.depth <= 0)
+        this->config.depth = config.npuThreads * 2 + config.preThreads + config.postThreads + config.renderThreads;
+    this->putSeq = 0;
+    this->getSeq = 0;
+}
+
+template <typename rknnModel>
+template <typename modelOptions>
+void rknnPipeline<rknnModel>::setModelOptions(const modelOptions &options)
+{
+    this->makeModel = [options](const std::string &path)
+    { return std::make_shared<rknnModel>(path, options); };
+}
+
+template <typename rknnModel>
+int rknnPipeline<rknnModel>::init()
+{
+    int depth = config.depth;
+    try
+    {
+        for (int i = 0; i < config.npuThreads; i++)
+            models.push_back(makeModel ? makeModel(this->modelPath) : std::make_shared<rknnModel>(this->modelPath.c_str()));
+        jobs.resize(depth);
+        freeQ.reset(new JobQueue(depth));
+        preQ.reset(new JobQueue(depth));
+        npuQ.reset(new JobQueue(depth));
+        postQ.reset(new JobQueue(depth));
+        renderQ.reset(new JobQueue(depth));
+        done.assign(depth, nullptr);
+    }
+    catch (const std::bad_alloc &e)
+    {
+        std::cout << "Out of memory: " << e.what() << std::endl;
+        return -1;
+    }
+    // 初始化模型并按策略绑定核心/Initialize the model
+    int ret = init_models(models, config.coreStrategy, config.coreSet);
+    if (ret != 0)
+        return ret;
+    // NPU阶段通过 rknn_outputs_get 取输出, 异步上下文取到的是上一帧的结果
+    if (models[0]->get_async())
+    {
+        std::cout << "rknnPipeline does not support async models" << std::endl;
+        return -1;
+    }
+
+    // 输出缓冲按模型属性和输出格式预分配, 由帧对象持有, 不依赖rknn上下文的生命周期
+    for (auto &job : jobs)
+    {
+        if (models[0]->prepare_outputs(job.outBufs, job.outputs) != 0)
+            return -1;
+        freeQ->push(&job);
+    }
+
+    std::shared_ptr<rknnModel> front = models[0];
+    startStage(config.preThreads, preQ.get(), npuQ.get(), [front](Job *job)
+               { job->ok = front->preprocess(job->frame, job->input, job->letterBox) == 0; });
+    // NPU阶段每个线程绑定一个上下文
+    stages.emplace_back();
+    for (int i = 0; i < config.npuThreads; i++)
+    {
+        std::shared_ptr<rknnModel> model = models[i];
+        stages.back().emplace_back([this, model]()
+                                   {
+            Job *job;
+            while (npuQ->pop(job))
+            {
+                if (job->ok)
+                    job->ok = model->run(job->input, job->outputs.data()) == 0;
+                postQ->push(job);
+            } });
+    }
+    startStage(config.postThreads, postQ.get(), renderQ.get(), [front](Job *job)
+               { job->ok = front->postprocess(job->outputs.data(), job->letterBox, &job->results, &job->post) == 0; });
+    startStage(config.renderThreads, renderQ.get(), nullptr, [front](Job *job)
+               { front->draw(job->frame, job->results); });
+    return 0;
+}
+
+template <typename rknnModel>
+void rknnPipeline<rknnModel>::startStage(int threads, JobQueue *in, JobQueue *out, std::function<void(Job *)> work)
+{
+    stages.emplace_back();
+    for (int i = 0; i < threads; i++)
+    {
+        stages.back().emplace_back([this, in, out, work]()
+                                   {
+            Job *job;
+            while (in->pop(job))
+            {
+                // 前面阶段失败的帧直接原样向后传递
+                if (job->ok)
+                    work(job);
+                if (out != nullptr)
+                    out->push(job);
+                else
+                    finish(job);
+            } });
+    }
+}
+
+template <typename rknnModel>
+void rknnPipeline<rknnModel>::finish(Job *job)
+{
+    std::lock_guard<std::mutex> lock(doneMtx);
+    done[job->seq % config.depth] = job;
+    doneCv.notify_all();
+}
+
+template <typename rknnModel>
+int rknnPipeline<rknnModel>::put(const cv::Mat &inputData)
+{
+    Job *job;
+    if (!freeQ->pop(job))
+        return -1;
+    {
+        std::lock_guard<std::mutex> lock(doneMtx);
+        job->seq = putSeq++;
+    }
+    job->ok = true;
+    job->frame = inputData;
+    return preQ->push(job) ? 0 : -1;
+}
+
+template <typename rknnModel>
+int rknnPipeline<rknnModel>::get(cv::Mat &outputData)
+{
+    Job *job;
+    {
+        std::unique_lock<std::mutex> lock(doneMtx);
+        if (getSeq == putSeq)
+            return 1;
+        int slot = getSeq % config.depth;
+        doneCv.wait(lock, [this, slot]()
+                    { return done[slot] != nullptr; });
+        job = done[slot];
+        done[slot] = nullptr;
+        getSeq++;
+    }
+    outputData = job->frame;
+    job->frame = cv::Mat();
+    freeQ->push(job);
+    return 0;
+}
+
+template <typename rknnModel>
+rknnPipeline<rknnModel>::~rknnPipeline()
+{
+    // 按阶段顺序关闭输入队列并等待线程退出, 保证在途帧全部处理完
+    JobQueue *inputs[] = {preQ.get(), npuQ.get(), postQ.get(), renderQ.get()};
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        inputs[i]->close();
+        for (auto &t : stages[i])
+            t.join();
+    }
+    if (freeQ)
+        freeQ->close();
+}
+
+#endif
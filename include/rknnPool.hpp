@@ -2,108 +2,967 @@
 #define RKNNPOOL_H
 
 #include "ThreadPool.hpp"
+#include "WorkStealingThreadPool.hpp"
+#include "coreNum.hpp"
 #include <vector>
 #include <iostream>
 #include <mutex>
 #include <queue>
+#include <deque>
+#include <algorithm>
 #include <memory>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+
+// 单个模型(rknn上下文)的负载统计/Per-model load statistics
+struct rknnModelStats
+{
+    int core;              // 绑定的编号最小的NPU核心, -1表示未绑定
+    int coreMask;          // 绑定的核心掩码(rknn_core_mask), 多核联合推理时包含多个核心
+    int inflight;          // 已派发未完成的帧数(排队+执行中)
+    int maxInflight;       // 出现过的最大在途帧数
+    long long dispatched;  // 累计派发帧数
+};
+
+// 单个NPU核心的负载统计/Per-core load statistics
+struct rknnCoreStats
+{
+    int contexts;        // 绑定到该核心的模型数, 多核上下文计入其所有核心
+    long long runs;      // 在该核心上完成的推理次数
+    double avgRunMs;     // 单核上下文在该核心上每帧的平均墙钟耗时(含等待核心), 没有推理时为0
+    double busyMs;       // 累计NPU执行时间, 多核推理计入其所有核心
+    double utilization;  // busyMs 占init以来时长的比例
+    long long movedIn;   // 核心均衡迁入的上下文数
+    long long movedOut;  // 核心均衡迁出的上下文数
+};
+
+// 结果交付顺序/Result delivery order
+enum class rknnOrder
+{
+    STRICT,     // 按提交顺序交付, 先完成的帧在重排序缓冲中等待
+    UNORDERED,  // 谁先完成先交付, 没有队头阻塞
+    PER_STREAM  // 同一路流内按提交顺序交付, 不同流之间互不阻塞
+};
+
+// 在途帧达到上限时的处理策略/Load-shedding policy once the in-flight limit is reached
+enum class rknnShedPolicy
+{
+    BLOCK,        // put 阻塞直到有帧完成
+    DROP_NEWEST,  // 丢弃新提交的帧
+    DROP_OLDEST,  // 取消最早一个尚未开始推理的帧, 为新帧腾出位置
+    KEEP_LATEST   // 每路流最多保留一个等待推理的帧, 新帧替换同一路的旧帧
+};
+
+// 丢帧与超时统计/Shedding counters
+struct rknnShedStats
+{
+    long long accepted;   // 被接受的帧
+    long long dropped;    // 提交时直接丢弃的帧(DROP_NEWEST, 或结果缓冲已满)
+    long long cancelled;  // 排队后被新帧替换掉的帧(DROP_OLDEST/KEEP_LATEST)
+    long long late;       // 从put到推理完成超过延迟预算的帧
+};
+
+// 单路视频流的统计/Per-stream statistics
+struct rknnStreamStats
+{
+    long long accepted;
+    long long dropped;
+    long long cancelled;
+    long long completed;   // 推理完成的帧
+    double fps;            // 首帧到末帧完成之间的平均帧率
+    double avgLatencyMs;   // put到推理完成的平均延迟
+    double maxLatencyMs;
+};
 
 // rknnModel模型类, inputType模型输入类型, outputType模型输出类型
-template <typename rknnModel, typename inputType, typename outputType>
+// threadPool线程池类型, 默认使用工作窃取线程池, 也可换回 dpool::ThreadPool
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool = dpool::WorkStealingThreadPool>
 class rknnPool
 {
 private:
     int threadNum;
+    int framesPerModel;              // 每个模型同时在途的帧数, 线程数为 threadNum * framesPerModel
+    rknnCoreStrategy coreStrategy;   // 各模型的NPU核心分配策略
+    rknn_core_mask coreSet;          // 允许使用的核心, RKNN_NPU_CORE_AUTO 表示全部
     std::string modelPath;
+    std::function<std::shared_ptr<rknnModel>(const std::string &)> makeModel; // 为空时只以模型路径构造
 
     long long id;
     std::mutex idMtx, queueMtx;
-    std::unique_ptr<dpool::ThreadPool> pool;
-    std::queue<std::future<outputType>> futs;
+    std::unique_ptr<threadPool> pool;
     std::vector<std::shared_ptr<rknnModel>> models;
 
+    // 结果缓冲, 以下数据受 queueMtx 保护
+    enum SlotState
+    {
+        SLOT_FREE,
+        SLOT_QUEUED,     // 已提交到线程池, 尚未开始推理
+        SLOT_RUNNING,
+        SLOT_DONE,
+        SLOT_CANCELLED   // 被丢帧策略取消, STRICT 模式下等待 get 跳过
+    };
+    struct ResultSlot
+    {
+        long long seq;
+        int stream;
+        SlotState state;
+        std::chrono::steady_clock::time_point putTime;
+        outputType value;
+        std::exception_ptr error;
+    };
+    struct StreamState
+    {
+        std::deque<int> pending;   // 该流占用的槽位, 按提交顺序
+        int inflight;
+        rknnStreamStats stats;
+        double latencySumMs;
+        std::chrono::steady_clock::time_point firstDone, lastDone;
+    };
+    rknnOrder order;
+    int bufferSize;                  // 结果缓冲容量
+    std::vector<ResultSlot> slots;   // STRICT 模式以 seq % bufferSize 为槽位
+    std::vector<int> freeSlots;      // UNORDERED/PER_STREAM 模式的空闲槽位
+    std::queue<int> readySlots;      // UNORDERED 模式按完成顺序排列的槽位
+    long long putSeq, getSeq;        // 下一个提交/交付(STRICT)的序号
+    int outstanding;                 // 占用槽位(尚未被取走或跳过)的帧数
+    int inflight;                    // 排队或推理中的帧数
+    int tasks;                       // 已交给线程池但尚未返回的任务数
+    rknnShedPolicy shedPolicy;
+    int maxInflight;                 // 在途帧上限
+    std::chrono::milliseconds latencyBudget;
+    rknnShedStats shedStats;
+    int streamCount;
+    std::vector<StreamState> streams;
+    int nextStream;                  // PER_STREAM 模式下轮询交付的起始流
+    std::condition_variable resultCv, spaceCv;
+    // 以下负载数据受 idMtx 保护
+    std::vector<rknnModelStats> modelStats;
+    std::vector<int> coreLoad;       // 各核心上的在途帧数, 多核上下文的帧计入其所有核心
+    // 各核心的推理耗时与均衡状态, 同样受 idMtx 保护
+    struct CoreState
+    {
+        long long runs;
+        double npuUs;
+        long long singleRuns;    // 单核上下文完成的帧数及墙钟耗时
+        double singleWallUs;
+        long long windowRuns;    // 单核上下文在当前统计窗口内完成的帧数, 慢核心的窗口可能跨越多个周期
+        double windowWallUs;
+        double periodRunMs;      // 上一个统计窗口内单核上下文每帧的平均墙钟耗时, 0表示未知
+        double execUs;           // 估计的单帧执行时间(每帧墙钟耗时 / 核心上的上下文数), 迁空后保留最后的测量值, 0表示未知
+        int emptyPeriods;        // 没有上下文的连续周期数
+        int probePeriods;        // 迁空后隔多少个周期重新试用, 每次迁出加倍, 避免反复试用仍然很慢的核心
+        bool probeDue;           // 已迁空 probePeriods 个周期, 保留的 execUs 可能过时, 可以迁入一个上下文试用
+        long long movedIn, movedOut;
+    };
+    int npuCores;
+    std::vector<CoreState> cores;
+    int probeModel;                  // 正在试用迁空核心的上下文, -1表示没有
+    rknn_core_mask probeFrom;        // 试用的上下文原来所在的核心, 试用核心仍然慢时迁回
+    std::vector<rknnRunStats> runBase;  // 各模型上次统计时的累计耗时
+    std::chrono::steady_clock::time_point statsStart, lastBalance;
+    bool balanceEnabled;
+    std::chrono::milliseconds balancePeriod;
+    double balanceThreshold;
+
 protected:
+    // 选择在途帧最少的模型, 相同时选所在核心更空闲的, 再相同时按轮询
     int getModelId();
+    void releaseModel(int modelId);
+    void addCoreLoad(int modelId, int delta); // 调用方持有 idMtx
+    void setModelMask(int modelId, rknn_core_mask mask); // 调用方持有 idMtx
+    void collectRunStats();                   // 调用方持有 idMtx
+    int balanceCores(rknn_core_mask &from, rknn_core_mask &to); // 调用方持有 idMtx
+    void runModel(int modelId, int slot, long long seq, inputType inputData);
+    int streamQuota();
+    int findQueued(int stream);
+    void cancelSlot(int slot);
+    void skipCancelled();
+    int readySlot();
+    int takeResult(std::unique_lock<std::mutex> &lock, int slot, outputType &outputData, long long *seq, int *stream);
 
 public:
-    rknnPool(const std::string modelPath, int threadNum);
+    // bufferSize 为0时取 threadNum * 4
+    rknnPool(const std::string modelPath, int threadNum, rknnOrder order = rknnOrder::STRICT, int bufferSize = 0);
+    // 设置丢帧策略, 需在put之前调用; maxInflight 为0时等于 bufferSize, latencyBudgetMs 为0时不统计超时
+    void setShedPolicy(rknnShedPolicy policy, int maxInflight = 0, int latencyBudgetMs = 0);
+    // 设置视频流数量, 需在init之前调用; 多路流时每路最多占用 maxInflight / count 个在途帧, 避免单路流占满模型
+    void setStreamCount(int count);
+    // 设置每个模型(rknn上下文)同时推理的帧数, 需在init之前调用; 线程数随之增加, 模型数仍为 threadNum。
+    // 模型需支持在等待结果时释放上下文(如异步模式的 Yolo11), 否则多出的线程只会在模型上排队
+    void setFramesPerModel(int frames);
+    // 设置NPU核心分配策略和允许使用的核心(如 RKNN_NPU_CORE_0_1), 需在init之前调用; 默认每个模型轮流绑定单个核心。
+    // 多个池可以分别使用不同的核心, 如大模型 MULTI 占用核心0/1降低延迟, 小模型 SINGLE 只用核心2
+    void setCoreStrategy(rknnCoreStrategy strategy, rknn_core_mask cores = RKNN_NPU_CORE_AUTO);
+    // 开启核心均衡: 每 periodMs 统计各核心单帧的 rknn_run 耗时, 某个核心(降频或被其他进程占用)每帧耗时超过
+    // 迁到最快核心后预计耗时的 threshold 倍时, 把它上面的一个单核上下文迁走(rknn_set_core_mask), 每周期最多迁移一个。
+    // 迁空的核心在10个周期后重新视为可用(再次迁出后间隔加倍), 核心恢复后上下文可以迁回; 多核及 AUTO 上下文不迁移
+    void setCoreBalancer(bool enable, int periodMs = 1000, double threshold = 1.5);
+    // 设置构造模型时传入的配置(如 Yolo11Options), 需在init之前调用; 不设置时只以模型路径构造
+    template <typename modelOptions>
+    void setModelOptions(const modelOptions &options);
     int init();
-    // 模型推理/Model inference
-    int put(inputType inputData);
-    // 获取推理结果/Get the results of your inference
-    int get(outputType &outputData);
+    // 模型推理, stream 为视频流编号(0 ~ count-1)/Model inference
+    // 返回0已接受, 1被丢帧策略丢弃, -1流编号无效
+    int put(inputType inputData, int stream = 0);
+    // 获取推理结果, seq 返回该帧的提交序号, stream 返回所属视频流/Get the results of your inference
+    // 返回0成功, 1没有在途帧
+    int get(outputType &outputData, long long *seq = nullptr, int *stream = nullptr);
+    // 非阻塞获取, 返回0成功, 1没有在途帧, 2结果尚未就绪/Non-blocking get
+    int try_get(outputType &outputData, long long *seq = nullptr, int *stream = nullptr);
+    // 最多等待 timeout, 返回值同 try_get/Get with a deadline
+    template <typename Rep, typename Period>
+    int get_for(outputType &outputData, const std::chrono::duration<Rep, Period> &timeout, long long *seq = nullptr, int *stream = nullptr);
+    // 获取各模型的负载统计/Get per-model queue depth and dispatch counts
+    std::vector<rknnModelStats> getModelStats();
+    // 获取各NPU核心的负载统计, AUTO 上下文的推理不计入任何核心/Get per-core utilization and balancer moves
+    std::vector<rknnCoreStats> getCoreStats();
+    // 获取丢帧与超时统计/Get shedding counters
+    rknnShedStats getShedStats();
+    // 获取各路视频流的统计/Get per-stream FPS, latency and drop counters
+    std::vector<rknnStreamStats> getStreamStats();
+    // 第i个模型, init之后有效; 供绘制等只读模型属性的操作使用/Borrow a model, e.g. for drawing
+    std::shared_ptr<rknnModel> getModel(int i) { return models[i]; }
     ~rknnPool();
 };
 
-template <typename rknnModel, typename inputType, typename outputType>
-rknnPool<rknnModel, inputType, outputType>::rknnPool(const std::string modelPath, int threadNum)
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+rknnPool<rknnModel, inputType, outputType, threadPool>::rknnPool(const std::string modelPath, int threadNum, rknnOrder order, int bufferSize)
 {
     this->modelPath = modelPath;
     this->threadNum = threadNum;
+    this->framesPerModel = 1;
+    this->coreStrategy = rknnCoreStrategy::SINGLE;
+    this->coreSet = RKNN_NPU_CORE_AUTO;
+    this->npuCores = 1;
+    this->balanceEnabled = false;
+    this->balancePeriod = std::chrono::milliseconds(1000);
+    this->balanceThreshold = 1.5;
     this->id = 0;
+    this->order = order;
+    this->bufferSize = bufferSize > 0 ? bufferSize : threadNum * 4;
+    this->putSeq = 0;
+    this->getSeq = 0;
+    this->outstanding = 0;
+    this->inflight = 0;
+    this->tasks = 0;
+    this->shedPolicy = rknnShedPolicy::BLOCK;
+    this->maxInflight = this->bufferSize;
+    this->latencyBudget = std::chrono::milliseconds(0);
+    this->shedStats = rknnShedStats();
+    this->streamCount = 1;
+    this->nextStream = 0;
 }
 
-template <typename rknnModel, typename inputType, typename outputType>
-int rknnPool<rknnModel, inputType, outputType>::init()
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+void rknnPool<rknnModel, inputType, outputType, threadPool>::setShedPolicy(rknnShedPolicy policy, int maxInflight, int latencyBudgetMs)
+{
+    std::lock_guard<std::mutex> lock(queueMtx);
+    this->shedPolicy = policy;
+    this->maxInflight = maxInflight > 0 ? maxInflight : bufferSize;
+    this->latencyBudget = std::chrono::milliseconds(latencyBudgetMs);
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+void rknnPool<rknnModel, inputType, outputType, threadPool>::setStreamCount(int count)
+{
+    std::lock_guard<std::mutex> lock(queueMtx);
+    this->streamCount = count > 0 ? count : 1;
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+void rknnPool<rknnModel, inputType, outputType, threadPool>::setFramesPerModel(int frames)
+{
+    std::lock_guard<std::mutex> lock(queueMtx);
+    this->framesPerModel = frames > 0 ? frames : 1;
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+void rknnPool<rknnModel, inputType, outputType, threadPool>::setCoreStrategy(rknnCoreStrategy strategy, rknn_core_mask cores)
+{
+    std::lock_guard<std::mutex> lock(queueMtx);
+    this->coreStrategy = strategy;
+    this->coreSet = cores;
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+void rknnPool<rknnModel, inputType, outputType, threadPool>::setCoreBalancer(bool enable, int periodMs, double threshold)
+{
+    std::lock_guard<std::mutex> lock(idMtx);
+    this->balanceEnabled = enable;
+    this->balancePeriod = std::chrono::milliseconds(periodMs > 0 ? periodMs : 1000);
+    this->balanceThreshold = threshold > 1 ? threshold : 1.5;
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+template <typename modelOptions>
+void rknnPool<rknnModel, inputType, outputType, threadPool>::setModelOptions(const modelOptions &options)
+{
+    std::lock_guard<std::mutex> lock(queueMtx);
+    this->makeModel = [options](const std::string &path)
+    { return std::make_shared<rknnModel>(path, options); };
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+int rknnPool<rknnModel, inputType, outputType, threadPool>::init()
 {
     try
     {
-        this->pool = std::make_unique<dpool::ThreadPool>(this->threadNum);
+        this->pool = std::make_unique<threadPool>(this->threadNum * this->framesPerModel);
         for (int i = 0; i < this->threadNum; i++)
-            models.push_back(std::make_shared<rknnModel>(this->modelPath.c_str()));
+            models.push_back(makeModel ? makeModel(this->modelPath) : std::make_shared<rknnModel>(this->modelPath.c_str()));
+        slots.resize(bufferSize);
+        for (auto &slot : slots)
+            slot.state = SLOT_FREE;
+        for (int i = bufferSize - 1; i >= 0; i--)
+            freeSlots.push_back(i);
+        streams.resize(streamCount);
+        for (auto &st : streams)
+        {
+            st.inflight = 0;
+            st.stats = rknnStreamStats();
+            st.latencySumMs = 0;
+        }
     }
     catch (const std::bad_alloc &e)
     {
         std::cout << "Out of memory: " << e.what() << std::endl;
         return -1;
     }
-    // 初始化模型/Initialize the model
-    for (int i = 0, ret = 0; i < threadNum; i++)
+    // 初始化模型并按策略绑定核心/Initialize the model
+    int ret = init_models(models, coreStrategy, coreSet);
+    if (ret != 0)
+        return ret;
+
+    std::lock_guard<std::mutex> lock(idMtx);
+    coreLoad.assign(NPU_MAX_CORES, 0);
+    cores.assign(NPU_MAX_CORES, CoreState());
+    for (auto &core : cores)
+        core.probePeriods = 5;
+    probeModel = -1;
+    npuCores = models[0]->get_npu_cores();
+    for (int i = 0; i < threadNum; i++)
     {
-        ret = models[i]->init(models[0]->get_pctx(), i != 0);
-        if (ret != 0)
-            return ret;
+        rknnModelStats stats = {models[i]->get_core_id(), models[i]->get_core_mask(), 0, 0, 0};
+        modelStats.push_back(stats);
+        runBase.push_back(models[i]->get_run_stats());
     }
+    statsStart = std::chrono::steady_clock::now();
+    lastBalance = statsStart;
 
     return 0;
 }
 
-template <typename rknnModel, typename inputType, typename outputType>
-int rknnPool<rknnModel, inputType, outputType>::getModelId()
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+int rknnPool<rknnModel, inputType, outputType, threadPool>::getModelId()
 {
     std::lock_guard<std::mutex> lock(idMtx);
+    // 多核上下文按其中最忙的核心计
+    auto coreOf = [this](int i)
+    {
+        int load = 0;
+        for (int c = 0; c < NPU_MAX_CORES; c++)
+        {
+            if (modelStats[i].coreMask & (1 << c))
+                load = std::max(load, coreLoad[c]);
+        }
+        return load;
+    };
+    // 从轮询位置开始找, 负载相同时退化为原来的轮询分配
     int modelId = id % threadNum;
+    for (int k = 1; k < threadNum; k++)
+    {
+        int i = (id + k) % threadNum;
+        if (modelStats[i].inflight < modelStats[modelId].inflight ||
+            (modelStats[i].inflight == modelStats[modelId].inflight && coreOf(i) < coreOf(modelId)))
+            modelId = i;
+    }
     id++;
+
+    rknnModelStats &stats = modelStats[modelId];
+    stats.inflight++;
+    stats.dispatched++;
+    if (stats.inflight > stats.maxInflight)
+        stats.maxInflight = stats.inflight;
+    addCoreLoad(modelId, 1);
+    return modelId;
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+void rknnPool<rknnModel, inputType, outputType, threadPool>::addCoreLoad(int modelId, int delta)
+{
+    for (int c = 0; c < NPU_MAX_CORES; c++)
+    {
+        if (modelStats[modelId].coreMask & (1 << c))
+            coreLoad[c] += delta;
+    }
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+void rknnPool<rknnModel, inputType, outputType, threadPool>::setModelMask(int modelId, rknn_core_mask mask)
+{
+    // 在途帧随模型一起计到新核心上
+    addCoreLoad(modelId, -modelStats[modelId].inflight);
+    modelStats[modelId].coreMask = mask;
+    modelStats[modelId].core = get_first_core(mask);
+    addCoreLoad(modelId, modelStats[modelId].inflight);
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+void rknnPool<rknnModel, inputType, outputType, threadPool>::releaseModel(int modelId)
+{
+    int moved = -1;
+    rknn_core_mask from = RKNN_NPU_CORE_AUTO, to = RKNN_NPU_CORE_AUTO;
+    {
+        std::lock_guard<std::mutex> lock(idMtx);
+        modelStats[modelId].inflight--;
+        addCoreLoad(modelId, -1);
+        auto now = std::chrono::steady_clock::now();
+        if (balanceEnabled && now - lastBalance >= balancePeriod)
+        {
+            lastBalance = now;
+            moved = balanceCores(from, to);
+        }
+    }
+    // 设置核心需要等待模型当前的推理提交完成, 不持有 idMtx 以免阻塞派发
+    if (moved >= 0 && models[moved]->set_core_mask(to) != 0)
+    {
+        std::lock_guard<std::mutex> lock(idMtx);
+        setModelMask(moved, from);
+        if (moved == probeModel)
+            probeModel = -1;
+    }
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+void rknnPool<rknnModel, inputType, outputType, threadPool>::collectRunStats()
+{
+    // 把各模型自上次统计以来的推理耗时计到它当前绑定的核心上
+    for (int i = 0; i < threadNum; i++)
+    {
+        rknnRunStats now = models[i]->get_run_stats();
+        long long runs = now.runs - runBase[i].runs;
+        long long wallUs = now.wallUs - runBase[i].wallUs;
+        long long npuUs = now.npuUs - runBase[i].npuUs;
+        runBase[i] = now;
+        int mask = modelStats[i].coreMask;
+        for (int c = 0; c < NPU_MAX_CORES; c++)
+        {
+            if (!(mask & (1 << c)))
+                continue;
+            cores[c].runs += runs;
+            cores[c].npuUs += npuUs;
+            // 只有单核上下文的耗时能反映该核心的快慢
+            if (mask == (1 << c))
+            {
+                cores[c].singleRuns += runs;
+                cores[c].singleWallUs += wallUs;
+                cores[c].windowRuns += runs;
+                cores[c].windowWallUs += wallUs;
+            }
+        }
+    }
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+int rknnPool<rknnModel, inputType, outputType, threadPool>::balanceCores(rknn_core_mask &from, rknn_core_mask &to)
+{
+    collectRunStats();
+    int all = (1 << npuCores) - 1;
+    int allowed = coreSet == RKNN_NPU_CORE_AUTO || (coreSet & all) == 0 ? all : (coreSet & all);
+    int contexts[NPU_MAX_CORES] = {0};
+    int movable[NPU_MAX_CORES] = {0};
+    for (int i = 0; i < threadNum; i++)
+    {
+        for (int c = 0; c < NPU_MAX_CORES; c++)
+        {
+            if (modelStats[i].coreMask & (1 << c))
+                contexts[c]++;
+            if (modelStats[i].coreMask == (1 << c))
+                movable[c]++;
+        }
+    }
+
+    // 窗口内攒够帧数后更新每帧耗时; 同一核心上的上下文互相等待, 除以上下文数得到单帧执行时间的估计
+    const int minRuns = 4;
+    double minExecUs = 0;
+    bool measured[NPU_MAX_CORES] = {false};
+    for (int c = 0; c < npuCores; c++)
+    {
+        CoreState &core = cores[c];
+        if (core.windowRuns >= minRuns)
+        {
+            double wallUs = core.windowWallUs / core.windowRuns;
+            core.periodRunMs = wallUs / 1000;
+            core.execUs = wallUs / std::max(contexts[c], 1);
+            core.windowRuns = 0;
+            core.windowWallUs = 0;
+            measured[c] = true;
+        }
+        if (contexts[c] > 0)
+        {
+            core.emptyPeriods = 0;
+        }
+        else if (++core.emptyPeriods >= core.probePeriods)
+        {
+            // 迁空的核心保留最后的测量值, 只是过一段时间后允许试用一次, 核心恢复后上下文才能迁回
+            core.periodRunMs = 0;
+            core.probeDue = true;
+            core.emptyPeriods = 0;
+        }
+        if (core.execUs > 0 && !core.probeDue && (minExecUs == 0 || core.execUs < minExecUs))
+            minExecUs = core.execUs;
+    }
+    if (minExecUs == 0)
+        return -1;
+
+    // 试用: 迁入的上下文在新核心上跑满 minRuns 帧后立即判断, 仍比迁回原核心的预计耗时慢时马上迁回,
+    // 试用核心的下一次试用间隔加倍; 判断之前不做其他迁移
+    if (probeModel >= 0)
+    {
+        int probe = modelStats[probeModel].coreMask;
+        int c = 0;
+        while (c < npuCores && probe != (1 << c))
+            c++;
+        if (c == npuCores)
+        {
+            probeModel = -1;
+        }
+        else if (!measured[c])
+        {
+            return -1;
+        }
+        else
+        {
+            int back = 0;
+            while (back < npuCores && probeFrom != (1 << back))
+                back++;
+            double backUs = cores[back].execUs * (contexts[back] + 1);
+            int modelId = probeModel;
+            probeModel = -1;
+            if (cores[c].periodRunMs * 1000 <= backUs * balanceThreshold)
+                return -1;
+            from = (rknn_core_mask)(1 << c);
+            to = probeFrom;
+            printf("rknnPool: core %d still %.1f ms/frame, moving model %d back to core %d\n", c, cores[c].periodRunMs, modelId, back);
+            setModelMask(modelId, to);
+            for (int k : {c, back})
+            {
+                cores[k].periodRunMs = 0;
+                cores[k].windowRuns = 0;
+                cores[k].windowWallUs = 0;
+            }
+            cores[c].movedOut++;
+            cores[c].probePeriods = std::min(cores[c].probePeriods * 2, 80);
+            cores[back].movedIn++;
+            return modelId;
+        }
+    }
+
+    // 最慢的核心: 本周期有测量值且有可迁移的单核上下文
+    int slow = -1;
+    for (int c = 0; c < npuCores; c++)
+    {
+        if (!(allowed & (1 << c)) || movable[c] == 0 || cores[c].periodRunMs == 0)
+            continue;
+        if (slow < 0 || cores[c].periodRunMs > cores[slow].periodRunMs)
+            slow = c;
+    }
+    if (slow < 0)
+        return -1;
+    // 迁入后预计每帧耗时最短的核心, 未知及可以试用的核心按最快的核心估计
+    int fast = -1;
+    double fastUs = 0;
+    for (int c = 0; c < npuCores; c++)
+    {
+        if (c == slow || !(allowed & (1 << c)))
+            continue;
+        double us = (cores[c].execUs > 0 && !cores[c].probeDue ? cores[c].execUs : minExecUs) * (contexts[c] + 1);
+        if (fast < 0 || us < fastUs)
+        {
+            fast = c;
+            fastUs = us;
+        }
+    }
+    if (fast < 0 || cores[slow].periodRunMs * 1000 <= fastUs * balanceThreshold)
+        return -1;
+
+    // 迁走慢核心上在途帧最少的上下文
+    int modelId = -1;
+    for (int i = 0; i < threadNum; i++)
+    {
+        if (modelStats[i].coreMask == (1 << slow) && (modelId < 0 || modelStats[i].inflight < modelStats[modelId].inflight))
+            modelId = i;
+    }
+    from = (rknn_core_mask)(1 << slow);
+    to = (rknn_core_mask)(1 << fast);
+    printf("rknnPool: core %d %.1f ms/frame, moving model %d to core %d (expected %.1f ms/frame)\n", slow, cores[slow].periodRunMs,
+           modelId, fast, fastUs / 1000);
+    setModelMask(modelId, to);
+    if (cores[fast].probeDue)
+    {
+        cores[fast].probeDue = false;
+        probeModel = modelId;
+        probeFrom = from;
+    }
+    // 两个核心上的上下文数变了, 之前的测量不再适用
+    for (int c : {slow, fast})
+    {
+        cores[c].periodRunMs = 0;
+        cores[c].windowRuns = 0;
+        cores[c].windowWallUs = 0;
+    }
+    cores[slow].movedOut++;
+    cores[slow].probePeriods = std::min(cores[slow].probePeriods * 2, 80);
+    cores[fast].movedIn++;
     return modelId;
 }
 
-template <typename rknnModel, typename inputType, typename outputType>
-int rknnPool<rknnModel, inputType, outputType>::put(inputType inputData)
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+void rknnPool<rknnModel, inputType, outputType, threadPool>::runModel(int modelId, int slot, long long seq, inputType inputData)
 {
+    bool cancelled;
+    int stream;
+    {
+        std::lock_guard<std::mutex> lock(queueMtx);
+        // 槽位被取消(UNORDERED 下还可能已被新帧复用)时跳过推理
+        cancelled = slots[slot].seq != seq || slots[slot].state != SLOT_QUEUED;
+        if (!cancelled)
+            slots[slot].state = SLOT_RUNNING;
+        stream = slots[slot].stream;
+    }
+
+    outputType result;
+    std::exception_ptr error;
+    if (!cancelled)
+    {
+        try
+        {
+            // 按所属视频流解码, 各路可以只检测不同的类别
+            result = models[modelId]->infer(inputData, stream);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+    }
+    releaseModel(modelId);
+
     std::lock_guard<std::mutex> lock(queueMtx);
-    futs.push(pool->submit(&rknnModel::infer, models[this->getModelId()], inputData));
+    if (!cancelled)
+    {
+        ResultSlot &done = slots[slot];
+        done.value = std::move(result);
+        done.error = error;
+        done.state = SLOT_DONE;
+        auto now = std::chrono::steady_clock::now();
+        if (latencyBudget.count() > 0 && now - done.putTime > latencyBudget)
+            shedStats.late++;
+        if (order == rknnOrder::UNORDERED)
+            readySlots.push(slot);
+        inflight--;
+
+        StreamState &st = streams[done.stream];
+        double latencyMs = std::chrono::duration<double, std::milli>(now - done.putTime).count();
+        if (st.stats.completed == 0)
+            st.firstDone = now;
+        st.lastDone = now;
+        st.stats.completed++;
+        st.latencySumMs += latencyMs;
+        st.stats.maxLatencyMs = std::max(st.stats.maxLatencyMs, latencyMs);
+        st.inflight--;
+    }
+    tasks--;
+    // 持锁通知, 保证析构函数看到 tasks == 0 时本线程已不再访问成员
+    resultCv.notify_all();
+    spaceCv.notify_all();
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+int rknnPool<rknnModel, inputType, outputType, threadPool>::streamQuota()
+{
+    return std::max(1, maxInflight / streamCount);
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+int rknnPool<rknnModel, inputType, outputType, threadPool>::findQueued(int stream)
+{
+    // 找到最早的尚未开始推理的帧, stream 为-1时不限流编号
+    int oldest = -1;
+    for (int i = 0; i < bufferSize; i++)
+    {
+        if (slots[i].state == SLOT_QUEUED && (stream < 0 || slots[i].stream == stream) &&
+            (oldest < 0 || slots[i].seq < slots[oldest].seq))
+            oldest = i;
+    }
+    return oldest;
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+void rknnPool<rknnModel, inputType, outputType, threadPool>::cancelSlot(int slot)
+{
+    StreamState &st = streams[slots[slot].stream];
+    st.pending.erase(std::find(st.pending.begin(), st.pending.end(), slot));
+    st.inflight--;
+    st.stats.cancelled++;
+    inflight--;
+    shedStats.cancelled++;
+    if (order == rknnOrder::STRICT)
+    {
+        // 槽位保留到 get 按序跳过, 避免打乱序号与槽位的对应关系
+        slots[slot].state = SLOT_CANCELLED;
+        skipCancelled();
+    }
+    else
+    {
+        slots[slot].state = SLOT_FREE;
+        freeSlots.push_back(slot);
+        outstanding--;
+    }
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+void rknnPool<rknnModel, inputType, outputType, threadPool>::skipCancelled()
+{
+    while (order == rknnOrder::STRICT && outstanding > 0)
+    {
+        ResultSlot &head = slots[getSeq % bufferSize];
+        if (head.seq != getSeq || head.state != SLOT_CANCELLED)
+            break;
+        head.state = SLOT_FREE;
+        getSeq++;
+        outstanding--;
+    }
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+int rknnPool<rknnModel, inputType, outputType, threadPool>::put(inputType inputData, int stream)
+{
+    int slot;
+    long long seq;
+    {
+        std::unique_lock<std::mutex> lock(queueMtx);
+        if (stream < 0 || stream >= (int)streams.size())
+            return -1;
+        StreamState &st = streams[stream];
+        if (shedPolicy == rknnShedPolicy::KEEP_LATEST)
+        {
+            int old = findQueued(stream);
+            if (old >= 0)
+                cancelSlot(old);
+        }
+        while (inflight >= maxInflight || st.inflight >= streamQuota() || outstanding >= bufferSize)
+        {
+            // 结果缓冲满说明消费者跟不上, 调用方可能就是消费者, 除 BLOCK 外都不能在此等待
+            if (shedPolicy == rknnShedPolicy::DROP_NEWEST ||
+                (shedPolicy != rknnShedPolicy::BLOCK && outstanding >= bufferSize))
+            {
+                shedStats.dropped++;
+                st.stats.dropped++;
+                return 1;
+            }
+            if (shedPolicy == rknnShedPolicy::DROP_OLDEST)
+            {
+                // 本路流超出配额时只取消自己的帧; 否则从在途帧最多的流里取消, 不影响其他流
+                int victim = stream;
+                if (st.inflight < streamQuota())
+                {
+                    for (int i = 0; i < streamCount; i++)
+                        if (streams[i].inflight > streams[victim].inflight)
+                            victim = i;
+                }
+                int old = findQueued(victim);
+                if (old >= 0)
+                {
+                    cancelSlot(old);
+                    continue;
+                }
+            }
+            // 没有可取消的帧(都已在推理), 等待有帧完成
+            spaceCv.wait(lock);
+        }
+
+        seq = putSeq++;
+        if (order == rknnOrder::STRICT)
+        {
+            // 占用的槽位恰好是 [getSeq, putSeq) 且少于 bufferSize 个, 不会冲突
+            slot = seq % bufferSize;
+        }
+        else
+        {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        ResultSlot &pending = slots[slot];
+        pending.seq = seq;
+        pending.stream = stream;
+        pending.state = SLOT_QUEUED;
+        pending.putTime = std::chrono::steady_clock::now();
+        st.pending.push_back(slot);
+        st.inflight++;
+        st.stats.accepted++;
+        outstanding++;
+        inflight++;
+        tasks++;
+        shedStats.accepted++;
+    }
+    // 结果通过槽位交付, 不再需要 future
+    pool->submit(&rknnPool::runModel, this, this->getModelId(), slot, seq, inputData);
     return 0;
 }
 
-template <typename rknnModel, typename inputType, typename outputType>
-int rknnPool<rknnModel, inputType, outputType>::get(outputType &outputData)
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+int rknnPool<rknnModel, inputType, outputType, threadPool>::readySlot()
 {
-    std::lock_guard<std::mutex> lock(queueMtx);
-    if(futs.empty() == true)
-        return 1;
-    outputData = futs.front().get();
-    futs.pop();
+    // 返回下一个可交付的槽位, 没有时返回-1
+    if (order == rknnOrder::STRICT)
+    {
+        skipCancelled();
+        int slot = getSeq % bufferSize;
+        if (outstanding > 0 && slots[slot].seq == getSeq && slots[slot].state == SLOT_DONE)
+            return slot;
+        return -1;
+    }
+    if (order == rknnOrder::UNORDERED)
+        return readySlots.empty() ? -1 : readySlots.front();
+    // PER_STREAM: 每路流只看最早的帧, 从上次交付的下一路开始轮询, 各路交付机会均等
+    for (int k = 0; k < streamCount; k++)
+    {
+        const StreamState &st = streams[(nextStream + k) % streamCount];
+        if (!st.pending.empty() && slots[st.pending.front()].state == SLOT_DONE)
+            return st.pending.front();
+    }
+    return -1;
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+int rknnPool<rknnModel, inputType, outputType, threadPool>::takeResult(std::unique_lock<std::mutex> &lock, int slot, outputType &outputData, long long *seq, int *stream)
+{
+    ResultSlot &result = slots[slot];
+    StreamState &st = streams[result.stream];
+    st.pending.erase(std::find(st.pending.begin(), st.pending.end(), slot));
+    if (order == rknnOrder::STRICT)
+    {
+        getSeq++;
+    }
+    else
+    {
+        if (order == rknnOrder::UNORDERED)
+            readySlots.pop();
+        else
+            nextStream = (result.stream + 1) % streamCount;
+        freeSlots.push_back(slot);
+    }
+    if (seq != nullptr)
+        *seq = result.seq;
+    if (stream != nullptr)
+        *stream = result.stream;
+    outputData = std::move(result.value);
+    result.value = outputType();
+    result.state = SLOT_FREE;
+    std::exception_ptr error = result.error;
+    result.error = nullptr;
+    outstanding--;
+    lock.unlock();
+    spaceCv.notify_all();
+
+    if (error)
+        std::rethrow_exception(error);
     return 0;
 }
 
-template <typename rknnModel, typename inputType, typename outputType>
-rknnPool<rknnModel, inputType, outputType>::~rknnPool()
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+int rknnPool<rknnModel, inputType, outputType, threadPool>::get(outputType &outputData, long long *seq, int *stream)
+{
+    std::unique_lock<std::mutex> lock(queueMtx);
+    int slot = -1;
+    resultCv.wait(lock, [this, &slot]()
+                  { return (slot = readySlot()) >= 0 || outstanding == 0; });
+    if (slot < 0)
+        return 1;
+    return takeResult(lock, slot, outputData, seq, stream);
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+int rknnPool<rknnModel, inputType, outputType, threadPool>::try_get(outputType &outputData, long long *seq, int *stream)
+{
+    std::unique_lock<std::mutex> lock(queueMtx);
+    int slot = readySlot();
+    if (slot < 0)
+        return outstanding == 0 ? 1 : 2;
+    return takeResult(lock, slot, outputData, seq, stream);
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+template <typename Rep, typename Period>
+int rknnPool<rknnModel, inputType, outputType, threadPool>::get_for(outputType &outputData, const std::chrono::duration<Rep, Period> &timeout, long long *seq, int *stream)
+{
+    std::unique_lock<std::mutex> lock(queueMtx);
+    int slot = -1;
+    resultCv.wait_for(lock, timeout, [this, &slot]()
+                      { return (slot = readySlot()) >= 0 || outstanding == 0; });
+    if (slot < 0)
+        return outstanding == 0 ? 1 : 2;
+    return takeResult(lock, slot, outputData, seq, stream);
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+std::vector<rknnModelStats> rknnPool<rknnModel, inputType, outputType, threadPool>::getModelStats()
+{
+    std::lock_guard<std::mutex> lock(idMtx);
+    return modelStats;
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+std::vector<rknnCoreStats> rknnPool<rknnModel, inputType, outputType, threadPool>::getCoreStats()
+{
+    std::lock_guard<std::mutex> lock(idMtx);
+    collectRunStats();
+    double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - statsStart).count();
+    std::vector<rknnCoreStats> result;
+    for (int c = 0; c < npuCores; c++)
+    {
+        const CoreState &core = cores[c];
+        rknnCoreStats stats = {0, core.runs, core.singleRuns > 0 ? core.singleWallUs / core.singleRuns / 1000 : 0, core.npuUs / 1000,
+                               elapsedUs > 0 ? core.npuUs / elapsedUs : 0, core.movedIn, core.movedOut};
+        for (int i = 0; i < threadNum; i++)
+            stats.contexts += (modelStats[i].coreMask >> c) & 1;
+        result.push_back(stats);
+    }
+    return result;
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+rknnShedStats rknnPool<rknnModel, inputType, outputType, threadPool>::getShedStats()
 {
-    while (!futs.empty())
+    std::lock_guard<std::mutex> lock(queueMtx);
+    return shedStats;
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+std::vector<rknnStreamStats> rknnPool<rknnModel, inputType, outputType, threadPool>::getStreamStats()
+{
+    std::lock_guard<std::mutex> lock(queueMtx);
+    std::vector<rknnStreamStats> result;
+    for (const auto &st : streams)
     {
-        outputType temp = futs.front().get();
-        futs.pop();
+        rknnStreamStats stats = st.stats;
+        double seconds = std::chrono::duration<double>(st.lastDone - st.firstDone).count();
+        stats.fps = stats.completed > 1 && seconds > 0 ? (stats.completed - 1) / seconds : 0;
+        stats.avgLatencyMs = stats.completed > 0 ? st.latencySumMs / stats.completed : 0;
+        result.push_back(stats);
     }
+    return result;
+}
+
+template <typename rknnModel, typename inputType, typename outputType, typename threadPool>
+rknnPool<rknnModel, inputType, outputType, threadPool>::~rknnPool()
+{
+    // 等待线程池中的任务全部返回, 它们仍会访问结果缓冲
+    std::unique_lock<std::mutex> lock(queueMtx);
+    resultCv.wait(lock, [this]()
+                  { return tasks == 0; });
 }
 
 #endif
@@ -0,0 +1,117 @@
+#ifndef _RKNN_MOCK_H_
+#define _RKNN_MOCK_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include "rknn_api.h"
+
+/*
+ * librknnrt 的软件替身(rknnrt_mock), 用于在没有 NPU 的 Linux 主机上压测线程池/调度/后处理。
+ *
+ * 模拟 RK3588 的三个 NPU 核心, 每个核心同一时刻只执行一个 rknn_run, 执行时间由配置的单核延迟决定;
+ * 输出张量回放自录制目录, 未指定录制目录时使用确定性的合成 YOLO11 输出。
+ *
+ * 环境变量:
+ *   RKNN_MOCK_CORE_LATENCY_US  各核心单帧延迟(微秒), 逗号分隔, 如 "20000,20000,35000", 默认每核 20000
+ *   RKNN_MOCK_DATA_DIR         录制目录, 包含 tensors.txt 及 output_<i>.bin (见 rknn_mock_dump_outputs)
+ *   RKNN_MOCK_DENSITY          合成输出中超过阈值的网格比例, 默认 0.002
+ *   RKNN_MOCK_CLASSES          合成输出的类别数, 默认 80
+ *   RKNN_MOCK_OUTPUT_TYPE      合成输出的类型: int8(默认, 量化输出), fp16 或 fp32(非量化输出, 模拟混合精度模型)
+ *   RKNN_MOCK_INPUT_W_STRIDE   合成输入的 w_stride(像素), 大于640时零拷贝输入的每行末尾有填充
+ *   RKNN_MOCK_CORES            模拟的核心数(1~3), 默认3; 为1时模拟 RK3568 等单核平台, rknn_set_core_mask 只接受 AUTO
+ *   RKNN_MOCK_LATE_BINDING     为1时异步上下文的帧在执行时才读取输出绑定(不在提交时记录), 模拟不按提交保留绑定的运行时
+ *
+ * 输入可以由 rknn_inputs_set 拷贝, 也可以用 rknn_create_mem + rknn_set_io_mem 绑定后直接读取;
+ * 输出可以由 rknn_outputs_get 拷贝, 也可以用 rknn_set_io_mem 绑定输出内存由 rknn_run 直接写入;
+ * RKNN_QUERY_NATIVE_NC1HWC2_OUTPUT_ATTR 返回原生布局(int8 时 C2 = 16, 补齐的通道为0分), 按原生布局绑定的输出不经过运行时转换。
+ * rknn_mock_get_io_stats 统计各种方式拷贝了多少字节。
+ *
+ * rknn_init 带 RKNN_FLAG_ASYNC_MASK 时(rknn_dup_context 得到的上下文沿用), rknn_run_extend.non_block = 1 的 rknn_run
+ * 只提交不等待, 返回的 frame_id 供 rknn_wait 等待该帧完成; 每个上下文提交的帧按顺序执行, 结果写入提交时绑定的输出内存。
+ */
+
+#define RKNN_MOCK_MAX_CORES 3
+#define RKNN_MOCK_MAX_INFLIGHT 4 /* 异步上下文最多同时提交的帧数, 再提交时 rknn_run 阻塞 */
+#define RKNN_MOCK_TENSOR_DESC "tensors.txt"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _rknn_mock_core_stats {
+    uint64_t runs;          /* 在该核心上完成的 rknn_run 次数 */
+    uint64_t busy_us;       /* 该核心累计忙碌时间(微秒) */
+    int latency_us;         /* 当前配置的单帧延迟(微秒) */
+} rknn_mock_core_stats;
+
+typedef struct _rknn_mock_io_stats {
+    uint64_t runs;              /* rknn_run 次数 */
+    uint64_t input_copy_bytes;  /* rknn_inputs_set 拷贝的输入字节数, 绑定输入内存推理时为0 */
+    uint64_t output_copy_bytes; /* rknn_outputs_get 及绑定的 NCHW 输出内存拷贝(及转换)的字节数, 原生布局输出为0 */
+    uint64_t input_checksum;    /* 推理时读到的输入内容的校验和之和, 只计有效像素, 与输入方式无关 */
+} rknn_mock_io_stats;
+
+/* 以下接口仅由 rknnrt_mock 导出, 链接真实 librknnrt.so 时不可用 */
+
+// 运行时修改某个核心的单帧延迟, 用于模拟降频或被其他进程占用的核心
+int rknn_mock_set_core_latency(int core, int latency_us);
+// 读取某个核心的统计数据
+int rknn_mock_get_core_stats(int core, rknn_mock_core_stats *stats);
+// 清零所有核心的统计数据及输入输出统计
+void rknn_mock_reset_stats(void);
+// 读取所有上下文累计的输入输出拷贝统计
+int rknn_mock_get_io_stats(rknn_mock_io_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @brief 把一帧的真实输出录制到目录, 供 rknnrt_mock 回放。需要在板端(链接真实运行时)调用。
+ * @param dir       [in] 已存在或可创建的目录
+ * @param io_num    [in] 输入输出数量
+ * @param in_attrs  [in] 输入张量属性
+ * @param out_attrs [in] 输出张量属性
+ * @param outputs   [in] rknn_outputs_get 得到的输出(want_float = 0)
+ * @return int 0表示成功, -1表示失败
+ */
+static inline int rknn_mock_dump_outputs(const char *dir, const rknn_input_output_num *io_num,
+                                         const rknn_tensor_attr *in_attrs, const rknn_tensor_attr *out_attrs,
+                                         const rknn_output *outputs)
+{
+    char path[512];
+    mkdir(dir, 0755);
+    snprintf(path, sizeof(path), "%s/%s", dir, RKNN_MOCK_TENSOR_DESC);
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL)
+    {
+        printf("open %s fail!\n", path);
+        return -1;
+    }
+    // 每行: in|out index n_dims dims[4] fmt type qnt_type zp scale
+    for (uint32_t i = 0; i < io_num->n_input + io_num->n_output; i++)
+    {
+        int is_in = i < io_num->n_input;
+        const rknn_tensor_attr *a = is_in ? &in_attrs[i] : &out_attrs[i - io_num->n_input];
+        fprintf(fp, "%s %u %u %u %u %u %u %d %d %d %d %.9g\n", is_in ? "in" : "out", a->index, a->n_dims,
+                a->dims[0], a->dims[1], a->dims[2], a->dims[3], a->fmt, a->type, a->qnt_type, a->zp, a->scale);
+    }
+    fclose(fp);
+
+    for (uint32_t i = 0; i < io_num->n_output; i++)
+    {
+        snprintf(path, sizeof(path), "%s/output_%u.bin", dir, i);
+        fp = fopen(path, "wb");
+        if (fp == NULL)
+        {
+            printf("open %s fail!\n", path);
+            return -1;
+        }
+        fwrite(outputs[i].buf, 1, outputs[i].size, fp);
+        fclose(fp);
+    }
+    return 0;
+}
+
+#endif //_RKNN_MOCK_H_
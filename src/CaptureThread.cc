@@ -0,0 +1,236 @@
+#include "CaptureThread.hpp"
+#include <chrono>
+#include <iostream>
+
+#if CV_VERSION_MAJOR >= 4
+typedef cv::AccessFlag SlotAccessFlag;
+#else
+typedef int SlotAccessFlag;
+#endif
+
+/*
+ * read() 交出的帧使用的分配器: 每次交出时新建一份 UMatData, 数据仍指向环形缓冲,
+ * 下游持有的最后一个引用释放时 OpenCV 调用 deallocate, 把槽位还给读帧线程。
+ * 每份 UMatData 通过 Lease 持有分配器和环形缓冲的数据, CaptureThread 先析构时只释放帧本身。
+ */
+class CaptureThread::SlotAllocator : public cv::MatAllocator
+{
+public:
+    struct Lease
+    {
+        std::shared_ptr<SlotAllocator> allocator;
+        cv::Mat buffer;
+        int slot;
+    };
+
+    explicit SlotAllocator(CaptureThread *owner) : owner(owner) {}
+
+    // CaptureThread 析构后未释放的帧不再归还槽位
+    void detach()
+    {
+        std::lock_guard<std::mutex> lock(ownerMtx);
+        owner = nullptr;
+    }
+
+    // 交出的帧的 Mat::allocator 为空, 下游重新 create 时不经过这里
+    cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step, SlotAccessFlag flags,
+                           cv::UMatUsageFlags usageFlags) const override
+    {
+        return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usageFlags);
+    }
+
+    bool allocate(cv::UMatData *u, SlotAccessFlag, cv::UMatUsageFlags) const override
+    {
+        return u != nullptr;
+    }
+
+    void deallocate(cv::UMatData *u) const override
+    {
+        Lease *lease = static_cast<Lease *>(u->userdata);
+        // 最后一份 Lease 可能持有分配器自身, 延长到函数返回
+        std::shared_ptr<SlotAllocator> self = std::move(lease->allocator);
+        int slot = lease->slot;
+        delete lease;
+        delete u;
+        std::lock_guard<std::mutex> lock(ownerMtx);
+        if (owner != nullptr)
+            owner->releaseSlot(slot);
+    }
+
+private:
+    mutable std::mutex ownerMtx;
+    CaptureThread *owner;
+};
+
+CaptureThread::CaptureThread(cv::VideoCapture &capture, int ringSize, bool live)
+    : capture(capture), live(live), ring(ringSize > 1 ? ringSize : 2)
+{
+    this->decodeMs.assign(ring.size(), 0);
+    this->queued.assign(ring.size(), false);
+    this->leased.assign(ring.size(), false);
+    this->allocator = std::make_shared<SlotAllocator>(this);
+    this->nextSlot = 0;
+    this->stopping = false;
+    this->finished = false;
+    this->stats = CaptureStats();
+    this->decodeSumMs = 0;
+}
+
+int CaptureThread::start()
+{
+    if (!capture.isOpened())
+        return -1;
+    // 按视频尺寸预分配缓冲, 尺寸未知时由第一次read分配
+    int width = capture.get(cv::CAP_PROP_FRAME_WIDTH);
+    int height = capture.get(cv::CAP_PROP_FRAME_HEIGHT);
+    try
+    {
+        if (width > 0 && height > 0)
+        {
+            for (auto &frame : ring)
+                frame.create(height, width, CV_8UC3);
+        }
+    }
+    catch (const std::bad_alloc &e)
+    {
+        std::cout << "Out of memory: " << e.what() << std::endl;
+        return -1;
+    }
+    worker = std::thread(&CaptureThread::loop, this);
+    return 0;
+}
+
+bool CaptureThread::slotFree(int slot)
+{
+    return !queued[slot] && !leased[slot];
+}
+
+int CaptureThread::acquireSlot()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    bool stalled = false;
+    while (!stopping)
+    {
+        for (size_t k = 0; k < ring.size(); k++)
+        {
+            int slot = (nextSlot + k) % ring.size();
+            if (slotFree(slot))
+            {
+                nextSlot = (slot + 1) % ring.size();
+                return slot;
+            }
+        }
+        if (live && !ready.empty())
+        {
+            // 摄像头不能暂停, 丢弃最旧的未取帧
+            int slot = ready.front();
+            ready.pop_front();
+            queued[slot] = false;
+            stats.overwritten++;
+            return slot;
+        }
+        if (!stalled)
+        {
+            stats.stalls++;
+            stalled = true;
+        }
+        // 下游释放帧时由 releaseSlot 唤醒
+        freeCv.wait(lock);
+    }
+    return -1;
+}
+
+void CaptureThread::releaseSlot(int slot)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    leased[slot] = false;
+    freeCv.notify_one();
+}
+
+void CaptureThread::loop()
+{
+    while (true)
+    {
+        int slot = acquireSlot();
+        if (slot < 0)
+            break;
+
+        // 解码在锁外进行, 该槽位此时只属于读帧线程
+        auto t0 = std::chrono::steady_clock::now();
+        bool ok = capture.read(ring[slot]);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!ok || ring[slot].empty())
+            break;
+        decodeMs[slot] = ms;
+        stats.frames++;
+        decodeSumMs += ms;
+        if (ms > stats.maxDecodeMs)
+            stats.maxDecodeMs = ms;
+        ready.push_back(slot);
+        queued[slot] = true;
+        readyCv.notify_one();
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    finished = true;
+    readyCv.notify_all();
+}
+
+bool CaptureThread::isOpened()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return worker.joinable() && !(finished && ready.empty());
+}
+
+bool CaptureThread::read(cv::Mat &frame, double *frameDecodeMs)
+{
+    // frame 可能持有之前交出的帧, 释放时会进入 releaseSlot, 须在加锁前释放
+    frame.release();
+    std::unique_lock<std::mutex> lock(mtx);
+    readyCv.wait(lock, [this]()
+                 { return !ready.empty() || finished; });
+    if (ready.empty())
+        return false;
+    int slot = ready.front();
+    ready.pop_front();
+    queued[slot] = false;
+    // 交出的帧与槽位共享数据, 引用计数记在新的 UMatData 上, 全部释放后由分配器归还槽位
+    const cv::Mat &buffer = ring[slot];
+    cv::UMatData *u = new cv::UMatData(allocator.get());
+    u->data = u->origdata = buffer.data;
+    u->size = buffer.total() * buffer.elemSize();
+    u->userdata = new SlotAllocator::Lease{allocator, buffer, slot};
+    u->refcount = 1;
+    frame = cv::Mat(buffer.rows, buffer.cols, buffer.type(), buffer.data, buffer.step);
+    frame.u = u;
+    leased[slot] = true;
+    if (frameDecodeMs != nullptr)
+        *frameDecodeMs = decodeMs[slot];
+    return true;
+}
+
+void CaptureThread::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+        freeCv.notify_all();
+    }
+    if (worker.joinable())
+        worker.join();
+}
+
+CaptureStats CaptureThread::getStats()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    CaptureStats result = stats;
+    result.avgDecodeMs = stats.frames > 0 ? decodeSumMs / stats.frames : 0;
+    return result;
+}
+
+CaptureThread::~CaptureThread()
+{
+    stop();
+    allocator->detach();
+}
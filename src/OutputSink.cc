@@ -0,0 +1,196 @@
+#include "OutputSink.hpp"
+#include "opencv2/highgui/highgui.hpp"
+#include <algorithm>
+
+OutputSink::OutputSink(const std::string &name, int capacity, bool dropToLatest)
+    : name(name), capacity(capacity > 0 ? capacity : 1), dropToLatest(dropToLatest)
+{
+    this->openResult = 1;
+    this->closing = false;
+    this->quit = false;
+    this->stats = SinkStats();
+    this->latencySumMs = 0;
+    this->writeSumMs = 0;
+}
+
+int OutputSink::start()
+{
+    worker = std::thread(&OutputSink::loop, this);
+    std::unique_lock<std::mutex> lock(mtx);
+    openCv.wait(lock, [this]()
+                { return openResult != 1; });
+    int ret = openResult;
+    lock.unlock();
+    if (ret != 0)
+        worker.join();
+    return ret;
+}
+
+void OutputSink::loop()
+{
+    int ret = open();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        openResult = ret;
+        openCv.notify_all();
+    }
+    if (ret != 0)
+        return;
+
+    while (true)
+    {
+        Item item;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            notEmpty.wait(lock, [this]()
+                          { return closing || !items.empty(); });
+            if (items.empty())
+                break;
+            item = std::move(items.front());
+            items.pop_front();
+            // 等待的可能是其他路的 push
+            notFull.notify_all();
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        bool ok = write(item.frame, item.stream);
+        auto t1 = std::chrono::steady_clock::now();
+        // 尽早释放帧, 让读帧线程复用缓冲
+        item.frame = cv::Mat();
+
+        double writeMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        double latencyMs = std::chrono::duration<double, std::milli>(t1 - item.pushTime).count();
+        std::lock_guard<std::mutex> lock(mtx);
+        stats.written++;
+        writeSumMs += writeMs;
+        latencySumMs += latencyMs;
+        stats.maxWriteMs = std::max(stats.maxWriteMs, writeMs);
+        stats.maxLatencyMs = std::max(stats.maxLatencyMs, latencyMs);
+        if (!ok)
+        {
+            // 用户要求退出, 丢弃剩余的帧
+            quit = true;
+            items.clear();
+            notFull.notify_all();
+            break;
+        }
+    }
+    release();
+}
+
+size_t OutputSink::queued(int stream) const
+{
+    return std::count_if(items.begin(), items.end(), [stream](const Item &item)
+                         { return item.stream == stream; });
+}
+
+bool OutputSink::push(const cv::Mat &frame, int stream)
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    if (!dropToLatest)
+        notFull.wait(lock, [this, stream]()
+                     { return quit || closing || queued(stream) < capacity; });
+    if (quit || closing)
+        return !quit;
+    if (queued(stream) >= capacity)
+    {
+        // 只挤掉同一路最旧的帧, 其他路的帧不受影响
+        auto oldest = std::find_if(items.begin(), items.end(), [stream](const Item &item)
+                                   { return item.stream == stream; });
+        items.erase(oldest);
+        stats.dropped++;
+    }
+    Item item;
+    item.frame = frame;
+    item.stream = stream;
+    item.pushTime = std::chrono::steady_clock::now();
+    items.push_back(std::move(item));
+    notEmpty.notify_one();
+    return true;
+}
+
+void OutputSink::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        closing = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+    if (worker.joinable())
+        worker.join();
+}
+
+SinkStats OutputSink::getStats()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    SinkStats result = stats;
+    result.avgLatencyMs = stats.written > 0 ? latencySumMs / stats.written : 0;
+    result.avgWriteMs = stats.written > 0 ? writeSumMs / stats.written : 0;
+    return result;
+}
+
+OutputSink::~OutputSink()
+{
+    // 子类应已调用 close(), 这里只是兜底, 此时虚函数已不可用
+    if (worker.joinable())
+        worker.join();
+}
+
+DisplaySink::DisplaySink(const std::vector<std::string> &windows, int capacity)
+    : OutputSink("display", capacity, true), windows(windows)
+{
+}
+
+int DisplaySink::open()
+{
+    // 窗口的创建、刷新和销毁都在输出线程中完成
+    for (const auto &window : windows)
+        cv::namedWindow(window, cv::WINDOW_AUTOSIZE);
+    return 0;
+}
+
+bool DisplaySink::write(const cv::Mat &frame, int stream)
+{
+    if (stream < 0 || stream >= (int)windows.size())
+        return true;
+    cv::imshow(windows[stream], frame);
+    return cv::waitKey(1) != 'q';
+}
+
+void DisplaySink::release()
+{
+    cv::destroyAllWindows();
+}
+
+DisplaySink::~DisplaySink()
+{
+    close();
+}
+
+VideoWriterSink::VideoWriterSink(const std::string &pipeline, double fps, cv::Size size, int capacity)
+    : OutputSink("rtp", capacity, true), pipeline(pipeline), fps(fps), size(size)
+{
+}
+
+int VideoWriterSink::open()
+{
+    writer.open(pipeline, cv::CAP_GSTREAMER, 0, fps, size, true);
+    return writer.isOpened() ? 0 : -1;
+}
+
+bool VideoWriterSink::write(const cv::Mat &frame, int stream)
+{
+    writer.write(frame);
+    return true;
+}
+
+void VideoWriterSink::release()
+{
+    writer.release();
+}
+
+VideoWriterSink::~VideoWriterSink()
+{
+    close();
+}
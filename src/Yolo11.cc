@@ -1,4 +1,5 @@
 #include "Yolo11.hpp"
+#include "rknn_mock.h"
 #include "opencv2/imgproc/imgproc.hpp"
 #include "opencv2/highgui/highgui.hpp"
 #include <stdio.h>
@@ -22,24 +23,62 @@ static unsigned char *load_model(const char *filename, int *model_size)
     return data;
 }
 
-Yolo11::Yolo11(const std::string &path) : model_path(path) {
-    init_post_process();
+Yolo11::Yolo11(const std::string &path, const Yolo11Options &options) : model_path(path) {
+    rknn_ctx = 0;
+    input_attrs = nullptr;
+    output_attrs = nullptr;
+    memset(&io_num, 0, sizeof(io_num));
+    core_mask = RKNN_NPU_CORE_UNDEFINED;
+    npu_cores = 1;
+    run_count = 0;
+    run_wall_us = 0;
+    run_npu_us = 0;
+    use_rga = true;
+    rga_failures = 0;
+    resize_mode = options.resize_mode;
+    want_float = options.want_float;
+    num_class = 0;
+    decode_cfg = options.decode;
+    stream_classes = options.stream_classes;
+    zero_copy = options.zero_copy;
+    bound_input = nullptr;
+    native_output = options.native_output;
+    async_run = options.async;
+    async_overlap = false;
+    bound_outputs = nullptr;
 }
 
+
 Yolo11::~Yolo11()
 {
+    // 输入输出内存属于rknn上下文, 先于上下文释放
+    for (auto &scratch : scratch_all)
+        destroy_scratch_mems(scratch.get());
     if (rknn_ctx != 0) {
         rknn_destroy(rknn_ctx);
     }
     if (input_attrs) free(input_attrs);
     if (output_attrs) free(output_attrs);
-    deinit_post_process();
 }
 
 rknn_context* Yolo11::get_pctx() {
     return &rknn_ctx;
 }
 
+int Yolo11::set_core_mask(rknn_core_mask mask)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if (rknn_ctx != 0 && npu_cores > 1) {
+        int ret = rknn_set_core_mask(rknn_ctx, mask);
+        if (ret < 0) {
+            printf("rknn_set_core_mask fail! ret=%d\n", ret);
+            return -1;
+        }
+    }
+    core_mask = rknn_ctx != 0 && npu_cores <= 1 ? RKNN_NPU_CORE_AUTO : mask;
+    return 0;
+}
+
 int Yolo11::init(rknn_context *ctx_in, bool isChild)
 {
     int ret;
@@ -47,10 +86,11 @@ int Yolo11::init(rknn_context *ctx_in, bool isChild)
     unsigned char *model = load_model(model_path.c_str(), &model_len);
     if (model == NULL) { return -1; }
 
+    // 复制的上下文沿用原上下文的异步标志, 同一组模型应使用相同的配置
     if (isChild) {
         ret = rknn_dup_context(ctx_in, &rknn_ctx);
     } else {
-        ret = rknn_init(&rknn_ctx, model, model_len, 0, NULL);
+        ret = rknn_init(&rknn_ctx, model, model_len, async_run ? RKNN_FLAG_ASYNC_MASK : 0, NULL);
     }
     free(model);
 
@@ -59,6 +99,20 @@ int Yolo11::init(rknn_context *ctx_in, bool isChild)
         return -1;
     }
 
+    // 设置此上下文需要绑定的NPU核心, 未指定时各上下文依次分到不同核心; 单核平台不设置
+    npu_cores = get_npu_core_num(rknn_ctx);
+    if (core_mask == RKNN_NPU_CORE_UNDEFINED)
+        core_mask = ::get_core_mask(rknnCoreStrategy::SINGLE, get_core_num(npu_cores), npu_cores, RKNN_NPU_CORE_AUTO);
+    if (npu_cores <= 1)
+        core_mask = RKNN_NPU_CORE_AUTO;
+    else {
+        ret = rknn_set_core_mask(rknn_ctx, core_mask);
+        if (ret < 0) {
+            printf("rknn_set_core_mask fail! ret=%d\n", ret);
+            return -1;
+        }
+    }
+
     ret = rknn_query(rknn_ctx, RKNN_QUERY_IN_OUT_NUM, &io_num, sizeof(io_num));
     if (ret != RKNN_SUCC) return -1;
 
@@ -87,81 +141,530 @@ int Yolo11::init(rknn_context *ctx_in, bool isChild)
         model_channel = input_attrs[0].dims[3];
     }
 
-    is_quant = (output_attrs[0].qnt_type == RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC && output_attrs[0].type == RKNN_TENSOR_INT8);
+    // 类别数取自 score 输出(每个分支的第二个输出, NCHW)的通道数
+    num_class = io_num.n_output >= 6 ? output_attrs[1].dims[1] : 0;
+    if (num_class <= 0 || num_class > OBJ_CLASS_MAX_NUM) {
+        printf("unsupported class count %d (1~%d)\n", num_class, OBJ_CLASS_MAX_NUM);
+        return -1;
+    }
+    if ((int)decode_cfg.class_thresholds.size() > num_class)
+        printf("model has %d classes, ignoring extra class thresholds\n", num_class);
+    if (decode_cfg.max_detections < 1 || decode_cfg.max_detections > OBJ_NUMB_MAX_SIZE) {
+        printf("max detections %d outside 1~%d, clamped\n", decode_cfg.max_detections, OBJ_NUMB_MAX_SIZE);
+        decode_cfg.max_detections = std::max(1, std::min(decode_cfg.max_detections, OBJ_NUMB_MAX_SIZE));
+    }
+    int n_label = load_labels(decode_cfg.label_path.c_str(), num_class, labels);
+    if (n_label >= 0 && n_label < num_class)
+        printf("%s has %d labels, model has %d classes\n", decode_cfg.label_path.c_str(), n_label, num_class);
+
+    // 构造时传入的类别列表在知道类别数后才能检查
+    stream_class_set.assign(stream_classes.size(), 0);
+    for (size_t s = 0; s < stream_classes.size(); s++) {
+        stream_class_set[s] = !stream_classes[s].empty();
+        if (!filter_classes(stream_classes[s]))
+            printf("stream %d: no valid class ids, nothing will be detected\n", (int)s);
+    }
+
+    // 没有librga时直接使用CPU预处理
+    use_rga = rga_available();
 
+    if (zero_copy) {
+        // 预处理输出 uint8 RGB, 由运行时在NPU侧完成格式转换
+        input_mem_attr = input_attrs[0];
+        input_mem_attr.type = RKNN_TENSOR_UINT8;
+        input_mem_attr.fmt = RKNN_TENSOR_NHWC;
+        input_mem_attr.pass_through = 0;
+    }
+
+    // int8/fp16 输出默认直接读取原生格式, 省去运行时逐元素转换float32和4倍大小的拷贝
+    bool quant_i8 = (output_attrs[0].qnt_type == RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC && output_attrs[0].type == RKNN_TENSOR_INT8);
+    if (quant_i8 && !want_float)
+        output_type = OutputType::INT8;
+    else if (output_attrs[0].type == RKNN_TENSOR_FLOAT16 && !want_float)
+        output_type = OutputType::FP16;
+    else
+        output_type = OutputType::FP32;
+    is_quant = output_type == OutputType::INT8;
+    if (is_quant) {
+        // 各输出的 zp/scale 在模型中固定, 初始化时一次生成DFL的exp表
+        dfl_exp_lut.resize(io_num.n_output * 256);
+        for (int i = 0; i < io_num.n_output; i++)
+            build_dfl_exp_lut(output_attrs[i].zp, output_attrs[i].scale, &dfl_exp_lut[i * 256]);
+    }
+
+    bool want_native = native_output;
+    native_output = want_native && output_type == OutputType::INT8;
+    if (want_native && !native_output)
+        printf("native output layout needs int8 outputs, using NCHW\n");
+    if (native_output) {
+        output_mem_attrs.resize(io_num.n_output);
+        for (int i = 0; i < io_num.n_output && native_output; i++) {
+            memset(&output_mem_attrs[i], 0, sizeof(rknn_tensor_attr));
+            output_mem_attrs[i].index = i;
+            ret = rknn_query(rknn_ctx, RKNN_QUERY_NATIVE_NC1HWC2_OUTPUT_ATTR, &output_mem_attrs[i], sizeof(rknn_tensor_attr));
+            // 后处理按 [N, C1, H, W, C2] 读取, 其他布局仍由运行时转换为 NCHW
+            const rknn_tensor_attr &a = output_mem_attrs[i];
+            if (ret != RKNN_SUCC || a.fmt != RKNN_TENSOR_NC1HWC2 || a.n_dims != 5 || a.dims[4] == 0 ||
+                a.dims[1] * a.dims[4] < output_attrs[i].dims[1] || a.dims[2] != output_attrs[i].dims[2] ||
+                a.dims[3] != output_attrs[i].dims[3]) {
+                printf("output %d has no NC1HWC2 layout (ret=%d), using NCHW\n", i, ret);
+                native_output = false;
+            }
+        }
+    }
+    // 异步推理时多帧在途, 每帧的输出写入各自绑定的内存; 不使用原生布局时按 NCHW 绑定, 由运行时转换
+    if (async_run && !native_output) {
+        output_mem_attrs.assign(output_attrs, output_attrs + io_num.n_output);
+        if (output_type == OutputType::FP32) {
+            for (auto &attr : output_mem_attrs) {
+                attr.type = RKNN_TENSOR_FLOAT32;
+                attr.size = attr.n_elems * sizeof(float);
+            }
+        }
+    }
+
+    if (async_run) {
+        async_overlap = check_async_bindings();
+        if (!async_overlap)
+            printf("runtime does not keep output bindings per rknn_run, async contexts run one frame at a time\n");
+    }
+
+    // 并发调用同一模型的线程数一般不超过核心数, 预留容量避免运行中扩容
+    scratch_all.reserve(8);
+    scratch_free.reserve(8);
+    try {
+        // 记录由调用方持有到处理完, 在途数一般多于线程数
+        record_pool = DetectionRecordPool::create(8);
+    } catch (const std::bad_alloc &e) {
+        printf("Out of memory: %s\n", e.what());
+        return -1;
+    }
     return 0;
 }
 
-cv::Mat Yolo11::infer(cv::Mat &orig_img)
+Yolo11::Scratch *Yolo11::acquire_scratch()
 {
-    std::lock_guard<std::mutex> lock(mtx);
-    int ret;
+    std::lock_guard<std::mutex> lock(scratch_mtx);
+    if (!scratch_free.empty()) {
+        Scratch *scratch = scratch_free.back();
+        scratch_free.pop_back();
+        return scratch;
+    }
+    try {
+        std::unique_ptr<Scratch> scratch(new Scratch());
+        if (native_output || async_run) {
+            // 每份临时缓冲一组输出内存, 后处理读取上一帧时另一个线程的推理写入各自的内存
+            scratch->outputs.resize(io_num.n_output);
+            scratch->output_mems.resize(io_num.n_output, nullptr);
+            for (uint32_t i = 0; i < io_num.n_output; i++) {
+                rknn_tensor_mem *mem = rknn_create_mem(rknn_ctx, output_mem_attrs[i].size);
+                if (mem == nullptr) {
+                    printf("rknn_create_mem fail!\n");
+                    destroy_scratch_mems(scratch.get());
+                    return nullptr;
+                }
+                scratch->output_mems[i] = mem;
+                memset(&scratch->outputs[i], 0, sizeof(rknn_output));
+                scratch->outputs[i].is_prealloc = 1;
+                scratch->outputs[i].index = i;
+                scratch->outputs[i].buf = mem->virt_addr;
+                scratch->outputs[i].size = output_mem_attrs[i].size;
+            }
+        } else if (prepare_outputs(scratch->out_bufs, scratch->outputs) != 0) {
+            return nullptr;
+        }
+        if (zero_copy) {
+            // 每份临时缓冲一块输入内存, 一个线程预处理时另一个线程的输入仍可在NPU上推理
+            int w_stride = input_attrs[0].w_stride > 0 ? input_attrs[0].w_stride : model_width;
+            uint32_t size = std::max<uint32_t>(input_attrs[0].size_with_stride, (uint32_t)(w_stride * model_height * 3));
+            scratch->input_mem = rknn_create_mem(rknn_ctx, size);
+            if (scratch->input_mem == nullptr) {
+                printf("rknn_create_mem fail!\n");
+                destroy_scratch_mems(scratch.get());
+                return nullptr;
+            }
+            scratch->input_img = cv::Mat(model_height, model_width, CV_8UC3, scratch->input_mem->virt_addr, (size_t)w_stride * 3);
+        }
+        scratch_all.push_back(std::move(scratch));
+        scratch_free.reserve(scratch_all.capacity());
+    } catch (const std::bad_alloc &e) {
+        printf("Out of memory: %s\n", e.what());
+        return nullptr;
+    }
+    return scratch_all.back().get();
+}
 
-    cv::Mat img;
-    cv::cvtColor(orig_img, img, cv::COLOR_BGR2RGB);
+void Yolo11::destroy_scratch_mems(Scratch *scratch)
+{
+    if (scratch->input_mem != nullptr)
+        rknn_destroy_mem(rknn_ctx, scratch->input_mem);
+    scratch->input_mem = nullptr;
+    for (auto &mem : scratch->output_mems) {
+        if (mem != nullptr)
+            rknn_destroy_mem(rknn_ctx, mem);
+        mem = nullptr;
+    }
+}
 
-    cv::Mat resized_img(model_height, model_width, CV_8UC3);
-    rga_buffer_t src_rga, dst_rga;
-    memset(&src_rga, 0, sizeof(src_rga));
-    memset(&dst_rga, 0, sizeof(dst_rga));
+int Yolo11::prepare_outputs(std::vector<std::vector<uint8_t>> &bufs, std::vector<rknn_output> &outputs) const
+{
+    bool want_float = output_type == OutputType::FP32;
+    try {
+        bufs.resize(io_num.n_output);
+        outputs.resize(io_num.n_output);
+        for (uint32_t i = 0; i < io_num.n_output; i++) {
+            uint32_t size = want_float ? output_attrs[i].n_elems * sizeof(float) : output_attrs[i].size;
+            bufs[i].resize(size);
+            memset(&outputs[i], 0, sizeof(rknn_output));
+            outputs[i].want_float = want_float;
+            outputs[i].is_prealloc = 1;
+            outputs[i].index = i;
+            outputs[i].buf = bufs[i].data();
+            outputs[i].size = size;
+        }
+    } catch (const std::bad_alloc &e) {
+        printf("Out of memory: %s\n", e.what());
+        return -1;
+    }
+    return 0;
+}
+
+void Yolo11::release_scratch(Scratch *scratch)
+{
+    std::lock_guard<std::mutex> lock(scratch_mtx);
+    scratch_free.push_back(scratch);
+}
+
+int Yolo11::preprocess(const cv::Mat &orig_img, cv::Mat &input_img, BOX_RECT &letter_box)
+{
+    cv::Size size(model_width, model_height);
+    input_img.create(model_height, model_width, CV_8UC3);
+    memset(&letter_box, 0, sizeof(letter_box));
+    bool letterbox_mode = resize_mode == ResizeMode::LETTERBOX;
+    // RGA和CPU预处理都只接受BGR888, 其他类型的帧直接报错, 不计为RGA失败
+    if (orig_img.empty() || orig_img.type() != CV_8UC3) {
+        fprintf(stderr, "unsupported frame type %d\n", orig_img.type());
+        return -1;
+    }
+    float scale = std::min((float)model_width / orig_img.cols, (float)model_height / orig_img.rows);
+    int ret = -1;
+    if (use_rga) {
+        rga_buffer_t src_rga, dst_rga;
+        memset(&src_rga, 0, sizeof(src_rga));
+        memset(&dst_rga, 0, sizeof(dst_rga));
+        // 直接以BGR为源格式, RGA缩放时顺带转成RGB, 不再对整帧做cvtColor
+        if (letterbox_mode)
+            ret = letterbox_rga(src_rga, dst_rga, orig_img, input_img, letter_box, scale, size, RK_FORMAT_BGR_888);
+        else
+            ret = resize_rga(src_rga, dst_rga, orig_img, input_img, size, RK_FORMAT_BGR_888);
+        // 偶发的失败(如RGA被其他进程占满)只让这一帧用CPU处理, 连续失败才不再使用RGA
+        const int max_rga_failures = 3;
+        if (ret == 0) {
+            rga_failures = 0;
+        } else if (++rga_failures >= max_rga_failures) {
+            fprintf(stderr, "resize with rga failed %d times in a row, falling back to cpu (%s)\n", max_rga_failures, resize_cpu_isa());
+            use_rga = false;
+        } else {
+            fprintf(stderr, "resize with rga error, using cpu for this frame\n");
+        }
+    }
 
-    ret = resize_rga(src_rga, dst_rga, img, resized_img, cv::Size(model_width, model_height));
     if (ret != 0) {
-        fprintf(stderr, "resize with rga error\n");
-        return orig_img;
+        ret = letterbox_mode ? letterbox_cpu(orig_img, input_img, letter_box, scale, size)
+                             : resize_bgr2rgb_cpu(orig_img, input_img, size);
+        if (ret != 0) {
+            fprintf(stderr, "resize with cpu error\n");
+            return -1;
+        }
+    }
+
+    if (!letterbox_mode) {
+        // 拉伸模式没有填充, 宽高分别还原
+        letter_box.scale_w = (float)orig_img.cols / model_width;
+        letter_box.scale_h = (float)orig_img.rows / model_height;
+    }
+    return 0;
+}
+
+int Yolo11::run(const cv::Mat &input_img, rknn_output *outputs, rknn_tensor_mem *input_mem, rknn_tensor_mem *const *output_mems)
+{
+    // 异步上下文的 rknn_outputs_get 返回的是上一帧的输出, 必须把输出写入绑定的内存
+    if (async_run && output_mems == nullptr) {
+        printf("async context needs bound output memory\n");
+        return -1;
+    }
+
+    std::unique_lock<std::mutex> lock(mtx);
+    int ret;
+
+    if (input_mem != nullptr) {
+        // 只有一个线程使用该上下文时始终是同一块内存, 只绑定一次
+        if (bound_input != input_mem) {
+            ret = rknn_set_io_mem(rknn_ctx, input_mem, &input_mem_attr);
+            if (ret < 0) {
+                printf("rknn_set_io_mem fail! ret=%d\n", ret);
+                return -1;
+            }
+            bound_input = input_mem;
+        }
+    } else {
+        rknn_input inputs[1];
+        memset(inputs, 0, sizeof(inputs));
+        inputs[0].index = 0;
+        inputs[0].type = RKNN_TENSOR_UINT8;
+        inputs[0].fmt = RKNN_TENSOR_NHWC;
+        inputs[0].size = model_width * model_height * model_channel;
+        inputs[0].buf = input_img.data;
+
+        ret = rknn_inputs_set(rknn_ctx, io_num.n_input, inputs);
+        if (ret < 0) return -1;
+        bound_input = nullptr;
     }
 
+    if (output_mems != nullptr && bound_outputs != output_mems) {
+        for (uint32_t i = 0; i < io_num.n_output; i++) {
+            ret = rknn_set_io_mem(rknn_ctx, output_mems[i], &output_mem_attrs[i]);
+            if (ret < 0) {
+                printf("rknn_set_io_mem fail! ret=%d\n", ret);
+                bound_outputs = nullptr;
+                return -1;
+            }
+        }
+        bound_outputs = output_mems;
+    }
+
+    if (async_run && output_mems != nullptr) {
+        // 提交后释放上下文, 在等待期间其他线程可以上传并提交下一帧, 使同一上下文的两帧前后衔接;
+        // 运行时不按提交保留输出绑定时(见 check_async_bindings)持锁等待, 下一帧不能改绑定
+        rknn_run_extend extend;
+        memset(&extend, 0, sizeof(extend));
+        extend.non_block = 1;
+        auto start = std::chrono::steady_clock::now();
+        ret = rknn_run(rknn_ctx, &extend);
+        if (async_overlap)
+            lock.unlock();
+        if (ret < 0) return -1;
+        ret = rknn_wait(rknn_ctx, &extend);
+        if (ret < 0) {
+            printf("rknn_wait fail! ret=%d\n", ret);
+            return -1;
+        }
+        auto done = std::chrono::steady_clock::now();
+        if (!lock.owns_lock())
+            lock.lock();
+        // RKNN_QUERY_PERF_RUN 不区分帧, 其他线程的帧可能已经完成; 同一上下文的帧依次执行,
+        // 从提交和上一帧结束两者中较晚的时刻算起, 作为这一帧的执行时间
+        if (async_last_done > start)
+            start = async_last_done;
+        if (done > async_last_done)
+            async_last_done = done;
+        record_run(start, std::max(start, done), false);
+        return 0;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ret = rknn_run(rknn_ctx, nullptr);
+    if (ret < 0) return -1;
+    auto done = std::chrono::steady_clock::now();
+
+    // 输出已由NPU写入绑定的内存
+    if (output_mems != nullptr) {
+        record_run(start, done, true);
+        return 0;
+    }
+
+    ret = rknn_outputs_get(rknn_ctx, io_num.n_output, outputs, NULL);
+    if (ret < 0) return -1;
+    // RKNN_QUERY_PERF_RUN 在 rknn_outputs_get 之后才有效
+    record_run(start, done, true);
+
+    // 设置 RKNN_MOCK_DUMP_DIR 时录制第一帧输出, 供 rknnrt_mock 回放
+    static const char *dump_dir = getenv("RKNN_MOCK_DUMP_DIR");
+    static std::once_flag dump_once;
+    if (dump_dir != NULL) {
+        std::call_once(dump_once, [&]() {
+            rknn_mock_dump_outputs(dump_dir, &io_num, input_attrs, output_attrs, outputs);
+        });
+    }
+    return 0;
+}
+
+// 累计一帧的墙钟耗时和NPU执行时间, 调用方持有mtx; query_perf 为false时NPU时间取墙钟耗时
+void Yolo11::record_run(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point done, bool query_perf)
+{
+    long long wall = std::chrono::duration_cast<std::chrono::microseconds>(done - start).count();
+    rknn_perf_run perf;
+    long long npu = wall;
+    if (query_perf && rknn_query(rknn_ctx, RKNN_QUERY_PERF_RUN, &perf, sizeof(perf)) == RKNN_SUCC && perf.run_duration > 0)
+        npu = perf.run_duration;
+    run_wall_us += wall;
+    run_npu_us += npu;
+    run_count++;
+}
+
+/*
+ * 异步上下文两帧在途时各写各的输出内存, 依赖运行时在 rknn_run 时记下当时绑定的输出内存, rknn_api 文档没有写明这一点。
+ * 试跑两帧: 两组输出内存填充相同的标记, 分别绑定后连续非阻塞提交, 等两帧完成后两组都被改写才说明绑定按提交保留;
+ * 否则之前提交的帧写入了后绑定的内存, 两帧同时在途时会互相覆盖输出。
+ */
+bool Yolo11::check_async_bindings()
+{
+    const unsigned char mark = 0xA5;
+    std::vector<unsigned char> input(model_width * model_height * model_channel, 0);
     rknn_input inputs[1];
     memset(inputs, 0, sizeof(inputs));
     inputs[0].index = 0;
     inputs[0].type = RKNN_TENSOR_UINT8;
     inputs[0].fmt = RKNN_TENSOR_NHWC;
-    inputs[0].size = model_width * model_height * model_channel;
-    inputs[0].buf = resized_img.data;
-
-    ret = rknn_inputs_set(rknn_ctx, io_num.n_input, inputs);
-    if (ret < 0) return orig_img;
+    inputs[0].size = input.size();
+    inputs[0].buf = input.data();
 
-    ret = rknn_run(rknn_ctx, nullptr);
-    if (ret < 0) return orig_img;
-
-    rknn_output outputs[io_num.n_output];
-    memset(outputs, 0, sizeof(outputs));
-    for (int i = 0; i < io_num.n_output; i++) {
-        outputs[i].want_float = 0;
+    std::vector<rknn_tensor_mem *> mems[2];
+    bool ok = rknn_inputs_set(rknn_ctx, io_num.n_input, inputs) == RKNN_SUCC;
+    rknn_run_extend extend[2];
+    memset(extend, 0, sizeof(extend));
+    for (int k = 0; k < 2 && ok; k++) {
+        for (uint32_t i = 0; i < io_num.n_output && ok; i++) {
+            rknn_tensor_mem *mem = rknn_create_mem(rknn_ctx, output_mem_attrs[i].size);
+            if (mem == nullptr) {
+                ok = false;
+                break;
+            }
+            mems[k].push_back(mem);
+            memset(mem->virt_addr, mark, mem->size);
+            ok = rknn_set_io_mem(rknn_ctx, mem, &output_mem_attrs[i]) == RKNN_SUCC;
+        }
+        extend[k].non_block = 1;
+        ok = ok && rknn_run(rknn_ctx, &extend[k]) == RKNN_SUCC;
     }
-    ret = rknn_outputs_get(rknn_ctx, io_num.n_output, outputs, NULL);
-    if (ret < 0) return orig_img;
+    for (int k = 0; k < 2; k++) {
+        if (extend[k].frame_id != 0 && rknn_wait(rknn_ctx, &extend[k]) != RKNN_SUCC)
+            ok = false;
+    }
+    // 只检查第一个输出: 全部仍是标记时视为没有被写入
+    for (int k = 0; k < 2 && ok; k++) {
+        const unsigned char *p = (const unsigned char *)mems[k][0]->virt_addr;
+        ok = std::any_of(p, p + mems[k][0]->size, [mark](unsigned char v) { return v != mark; });
+    }
+    for (auto &set : mems)
+        for (rknn_tensor_mem *mem : set)
+            rknn_destroy_mem(rknn_ctx, mem);
+    bound_outputs = nullptr;
+    return ok;
+}
 
-    object_detect_result_list od_results;
+void Yolo11::release_outputs(rknn_output *outputs)
+{
+    rknn_outputs_release(rknn_ctx, io_num.n_output, outputs);
+}
 
-    // ** 关键修复：计算独立的宽高缩放比例 **
-    float scale_w = (float)orig_img.cols / model_width;
-    float scale_h = (float)orig_img.rows / model_height;
+int Yolo11::postprocess(rknn_output *outputs, const BOX_RECT &letter_box, object_detect_result_list *od_results,
+                        post_process_buffers *buffers, int stream, bool native_layout)
+{
+    return post_process(this, outputs, &letter_box, od_results, buffers, get_stream_classes(stream),
+                        native_layout ? get_output_mem_attrs() : nullptr);
+}
 
-    // 创建一个临时的BOX_RECT来传递缩放比例
-    BOX_RECT letter_box;
-    // 将两个比例都存入，虽然有点冗余，但可以避免修改post_process的函数签名
-    letter_box.scale_w = scale_w;
-    letter_box.scale_h = scale_h;
+// 排序去重并去掉超出模型类别数的编号; 非空的列表过滤后为空时返回false
+bool Yolo11::filter_classes(std::vector<int> &classes) const
+{
+    bool requested = !classes.empty();
+    std::sort(classes.begin(), classes.end());
+    classes.erase(std::unique(classes.begin(), classes.end()), classes.end());
+    auto valid = std::remove_if(classes.begin(), classes.end(), [this](int c) { return c < 0 || c >= num_class; });
+    if (valid != classes.end()) {
+        printf("ignoring class ids outside 0~%d\n", num_class - 1);
+        classes.erase(valid, classes.end());
+    }
+    return !requested || !classes.empty();
+}
 
-    post_process(this, outputs, &letter_box, BOX_THRESH, NMS_THRESH, &od_results);
+void Yolo11::set_stream_classes(int stream, const std::vector<int> &classes)
+{
+    if (stream < 0)
+        return;
+    if (stream >= (int)stream_classes.size()) {
+        stream_classes.resize(stream + 1);
+        stream_class_set.resize(stream + 1, 0);
+    }
+    stream_classes[stream] = classes;
+    stream_class_set[stream] = !classes.empty();
+    if (!filter_classes(stream_classes[stream]))
+        printf("stream %d: no valid class ids, nothing will be detected\n", stream);
+}
 
-    // 绘制结果
+static void draw_box(cv::Mat &img, int x1, int y1, int x2, int y2, const char *label, float prop)
+{
+    char text[256];
+    sprintf(text, "%s %.1f%%", label, prop * 100);
+    rectangle(img, cv::Point(x1, y1), cv::Point(x2, y2), cv::Scalar(0, 255, 0), 2);
+    putText(img, text, cv::Point(x1, y1 > 10 ? y1 - 10 : y1 + 10), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 0, 255), 2);
+}
+
+void Yolo11::draw(cv::Mat &img, const object_detect_result_list &od_results) const
+{
     for (int i = 0; i < od_results.count; i++) {
-        object_detect_result *det_result = &(od_results.results[i]);
-        char text[256];
-        sprintf(text, "%s %.1f%%", coco_cls_to_name(det_result->cls_id), det_result->prop * 100);
+        const object_detect_result *det_result = &(od_results.results[i]);
+        draw_box(img, det_result->box.left, det_result->box.top, det_result->box.right, det_result->box.bottom,
+                 get_label(det_result->cls_id), det_result->prop);
+    }
+}
+
+void Yolo11::draw(cv::Mat &img, const DetectionRecord &record) const
+{
+    for (int i = 0; i < record.count(); i++)
+        draw_box(img, record.left[i], record.top[i], record.right[i], record.bottom[i], get_label(record.classes[i]), record.scores[i]);
+}
 
-        int x1 = det_result->box.left;
-        int y1 = det_result->box.top;
-        int x2 = det_result->box.right;
-        int y2 = det_result->box.bottom;
+int Yolo11::detect(const cv::Mat &orig_img, object_detect_result_list *od_results, int stream)
+{
+    Scratch *scratch = acquire_scratch();
+    if (scratch == nullptr)
+        return -1;
 
-        rectangle(orig_img, cv::Point(x1, y1), cv::Point(x2, y2), cv::Scalar(0, 255, 0), 2);
-        putText(orig_img, text, cv::Point(x1, y1 > 10 ? y1 - 10 : y1 + 10), cv::FONT_HERSHEY_SIMPLEX, 0.6, cv::Scalar(0, 0, 255), 2);
-    }
+    // 输出写入预分配缓冲, 后处理不需要再持有rknn上下文
+    int ret = -1;
+    rknn_tensor_mem *const *output_mems = scratch->output_mems.empty() ? nullptr : scratch->output_mems.data();
+    if (preprocess(orig_img, scratch->input_img, scratch->letter_box) == 0 &&
+        run(scratch->input_img, scratch->outputs.data(), scratch->input_mem, output_mems) == 0)
+        ret = postprocess(scratch->outputs.data(), scratch->letter_box, od_results, &scratch->post, stream, native_output);
+    release_scratch(scratch);
+    return ret;
+}
 
-    rknn_outputs_release(rknn_ctx, io_num.n_output, outputs);
+cv::Mat Yolo11::infer(cv::Mat &orig_img, int stream)
+{
+    object_detect_result_list od_results;
+    if (detect(orig_img, &od_results, stream) == 0)
+        draw(orig_img, od_results);
     return orig_img;
+}
+
+DetectionHandle Yolo11::infer(const DetectionRequest &request, int stream)
+{
+    DetectionHandle record = record_pool->acquire();
+    if (!record)
+        return record;
+    record->frame_id = request.frame_id;
+    record->stream = stream;
+    record->capture_time = request.capture_time;
+    record->infer_start = std::chrono::steady_clock::now();
+    if (request.keep_frame)
+        record->frame = request.frame;
+
+    // 只拷贝保留下来的 count 个结果
+    object_detect_result_list od_results;
+    if (detect(request.frame, &od_results, stream) == 0) {
+        for (int i = 0; i < od_results.count; i++) {
+            const object_detect_result &r = od_results.results[i];
+            record->left.push_back(r.box.left);
+            record->top.push_back(r.box.top);
+            record->right.push_back(r.box.right);
+            record->bottom.push_back(r.box.bottom);
+            record->scores.push_back(r.prop);
+            record->classes.push_back(r.cls_id);
+        }
+    }
+    record->infer_done = std::chrono::steady_clock::now();
+    return record;
 }
\ No newline at end of file
@@ -0,0 +1,342 @@
+// process_i8 的类别扫描: 一次处理一行格子, 沿类别平面连续读取, 用 NEON/SSE2/AVX2 同时比较多个格子
+// 逐格子沿 grid_len 跨步扫描80个类别对缓存不友好, 按行扫描时每个类别平面只读一段连续内存
+// 原生 NC1HWC2 布局的输出每个格子的16个类别本身连续, 逐格子按组扫描
+
+#include <stdint.h>
+#include "postprocess.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define CLASS_SCAN_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define CLASS_SCAN_SSE2 1
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define CLASS_SCAN_AVX2 1
+#endif
+#endif
+
+// 逐格子的参考实现, 与原 process_i8 内层循环的比较顺序相同: 分数严格大于当前最大值和该类别阈值才更新, 取第一个最大类别
+// ids 不为空时只扫描其中列出的 num_class 个类别平面
+static inline bool scan_cells(const int8_t *score_row, int grid_len, int j, int grid_w, int num_class, const int *ids,
+                              const int8_t *bars, int8_t *row_max, int8_t *row_cls)
+{
+    bool any = false;
+    for (; j < grid_w; j++) {
+        int8_t max_score = -128;
+        int8_t max_class_id = -1;
+        for (int c = 0; c < num_class; c++) {
+            int cls = ids != nullptr ? ids[c] : c;
+            int8_t v = score_row[cls * grid_len + j];
+            if (v > max_score && v > bars[c]) {
+                max_score = v;
+                max_class_id = (int8_t)cls;
+            }
+        }
+        row_max[j] = max_score;
+        row_cls[j] = max_class_id;
+        any |= max_class_id >= 0;
+    }
+    return any;
+}
+
+bool class_scan_row_scalar(const int8_t *score_row, int grid_len, int grid_w, int num_class, const int8_t *bars,
+                           int8_t *row_max, int8_t *row_cls)
+{
+    return scan_cells(score_row, grid_len, 0, grid_w, num_class, nullptr, bars, row_max, row_cls);
+}
+
+// NC > 0 时类别数为编译期常量, 类别循环可以展开; NC == 0 使用运行时的 num_class
+// ids 不为空时第c个类别为 ids[c], 只读取这些类别平面
+template <int NC>
+static bool class_scan_row_simd(const int8_t *score_row, int grid_len, int grid_w, int num_class, const int *ids,
+                                const int8_t *bars, int8_t *row_max, int8_t *row_cls)
+{
+    if (NC > 0)
+        num_class = NC;
+    bool any = false;
+    int j = 0;
+#if defined(CLASS_SCAN_NEON)
+    for (; j + 16 <= grid_w; j += 16) {
+        int8x16_t vmax = vdupq_n_s8(-128);
+        int8x16_t vcls = vdupq_n_s8(-1);
+        for (int c = 0; c < num_class; c++) {
+            int cls = ids != nullptr ? ids[c] : c;
+            int8x16_t v = vld1q_s8(score_row + cls * grid_len + j);
+            uint8x16_t gt = vandq_u8(vcgtq_s8(v, vmax), vcgtq_s8(v, vdupq_n_s8(bars[c])));
+            vmax = vbslq_s8(gt, v, vmax);
+            vcls = vbslq_s8(gt, vdupq_n_s8((int8_t)cls), vcls);
+        }
+        vst1q_s8(row_max + j, vmax);
+        vst1q_s8(row_cls + j, vcls);
+        // 类别编号为-1的格子没有分数超过阈值
+#if defined(__aarch64__)
+        any |= vmaxvq_s8(vcls) >= 0;
+#else
+        int8x8_t m = vpmax_s8(vget_low_s8(vcls), vget_high_s8(vcls));
+        m = vpmax_s8(m, m);
+        m = vpmax_s8(m, m);
+        m = vpmax_s8(m, m);
+        any |= vget_lane_s8(m, 0) >= 0;
+#endif
+    }
+#elif defined(CLASS_SCAN_SSE2)
+    for (; j + 16 <= grid_w; j += 16) {
+        __m128i vmax = _mm_set1_epi8(-128);
+        __m128i vcls = _mm_set1_epi8(-1);
+        for (int c = 0; c < num_class; c++) {
+            int cls = ids != nullptr ? ids[c] : c;
+            __m128i v = _mm_loadu_si128((const __m128i *)(score_row + cls * grid_len + j));
+            __m128i gt = _mm_and_si128(_mm_cmpgt_epi8(v, vmax), _mm_cmpgt_epi8(v, _mm_set1_epi8(bars[c])));
+            // SSE2 没有字节的 blend, 用掩码选择
+            vmax = _mm_or_si128(_mm_and_si128(gt, v), _mm_andnot_si128(gt, vmax));
+            vcls = _mm_or_si128(_mm_and_si128(gt, _mm_set1_epi8((char)cls)), _mm_andnot_si128(gt, vcls));
+        }
+        _mm_storeu_si128((__m128i *)(row_max + j), vmax);
+        _mm_storeu_si128((__m128i *)(row_cls + j), vcls);
+        // 符号位全为1表示16个格子都没有通过
+        any |= _mm_movemask_epi8(vcls) != 0xFFFF;
+    }
+#endif
+    any |= scan_cells(score_row, grid_len, j, grid_w, num_class, ids, bars, row_max, row_cls);
+    return any;
+}
+
+#if defined(CLASS_SCAN_AVX2)
+template <int NC>
+__attribute__((target("avx2"))) static bool class_scan_row_avx2(const int8_t *score_row, int grid_len, int grid_w, int num_class,
+                                                                const int *ids, const int8_t *bars, int8_t *row_max, int8_t *row_cls)
+{
+    if (NC > 0)
+        num_class = NC;
+    bool any = false;
+    int j = 0;
+    for (; j + 32 <= grid_w; j += 32) {
+        __m256i vmax = _mm256_set1_epi8(-128);
+        __m256i vcls = _mm256_set1_epi8(-1);
+        for (int c = 0; c < num_class; c++) {
+            int cls = ids != nullptr ? ids[c] : c;
+            __m256i v = _mm256_loadu_si256((const __m256i *)(score_row + cls * grid_len + j));
+            __m256i gt = _mm256_and_si256(_mm256_cmpgt_epi8(v, vmax), _mm256_cmpgt_epi8(v, _mm256_set1_epi8(bars[c])));
+            vmax = _mm256_blendv_epi8(vmax, v, gt);
+            vcls = _mm256_blendv_epi8(vcls, _mm256_set1_epi8((char)cls), gt);
+        }
+        _mm256_storeu_si256((__m256i *)(row_max + j), vmax);
+        _mm256_storeu_si256((__m256i *)(row_cls + j), vcls);
+        any |= _mm256_movemask_epi8(vcls) != -1;
+    }
+    // 20x20 等较窄的行余下部分交给16字节版本
+    if (j < grid_w)
+        any |= class_scan_row_simd<NC>(score_row + j, grid_len, grid_w - j, num_class, ids, bars, row_max + j, row_cls + j);
+    return any;
+}
+#endif
+
+typedef bool (*class_scan_fn)(const int8_t *, int, int, int, const int *, const int8_t *, int8_t *, int8_t *);
+
+template <int NC>
+static class_scan_fn select_class_scan(const char **name)
+{
+#if defined(CLASS_SCAN_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        *name = "avx2";
+        return class_scan_row_avx2<NC>;
+    }
+#endif
+#if defined(CLASS_SCAN_NEON)
+    *name = "neon";
+#elif defined(CLASS_SCAN_SSE2)
+    *name = "sse2";
+#else
+    *name = "scalar";
+#endif
+    return class_scan_row_simd<NC>;
+}
+
+// 常见类别数(单类、3类、VOC 20类、COCO 80类)各有一个展开的版本
+struct ClassScanKernel
+{
+    class_scan_fn generic, c1, c3, c20, c80;
+    const char *name;
+};
+
+static ClassScanKernel make_class_scan_kernel()
+{
+    ClassScanKernel k;
+    k.generic = select_class_scan<0>(&k.name);
+    k.c1 = select_class_scan<1>(&k.name);
+    k.c3 = select_class_scan<3>(&k.name);
+    k.c20 = select_class_scan<20>(&k.name);
+    k.c80 = select_class_scan<80>(&k.name);
+    return k;
+}
+
+static const ClassScanKernel &class_scan_kernel()
+{
+    static const ClassScanKernel kernel = make_class_scan_kernel();
+    return kernel;
+}
+
+bool class_scan_row(const int8_t *score_row, int grid_len, int grid_w, int num_class, const int8_t *bars,
+                    int8_t *row_max, int8_t *row_cls)
+{
+    const ClassScanKernel &k = class_scan_kernel();
+    class_scan_fn fn;
+    switch (num_class) {
+    case 1:
+        fn = k.c1;
+        break;
+    case 3:
+        fn = k.c3;
+        break;
+    case 20:
+        fn = k.c20;
+        break;
+    case 80:
+        fn = k.c80;
+        break;
+    default:
+        fn = k.generic;
+        break;
+    }
+    return fn(score_row, grid_len, grid_w, num_class, nullptr, bars, row_max, row_cls);
+}
+
+bool class_scan_row_list(const int8_t *score_row, int grid_len, int grid_w, const int *class_ids, int n_ids,
+                         const int8_t *bars, int8_t *row_max, int8_t *row_cls)
+{
+    return class_scan_kernel().generic(score_row, grid_len, grid_w, n_ids, class_ids, bars, row_max, row_cls);
+}
+
+// 原生 NC1HWC2 布局: 一个格子的类别按 c2 个一组连续存放, 逐格子按组比较, 不再跨类别平面读取; 只读取 groups 中的组
+static bool scan_cells_native(const int8_t *score_row, int block_stride, int j, int grid_w, const int *groups, int n_groups, int c2,
+                              const int8_t *bars, int8_t *row_max, int8_t *row_cls)
+{
+    bool any = false;
+    for (; j < grid_w; j++) {
+        int8_t max_score = -128;
+        int8_t max_class_id = -1;
+        for (int g = 0; g < n_groups; g++) {
+            int b = groups[g];
+            const int8_t *p = score_row + b * block_stride + j * c2;
+            for (int l = 0; l < c2; l++) {
+                int8_t v = p[l];
+                if (v > max_score && v > bars[b * c2 + l]) {
+                    max_score = v;
+                    max_class_id = (int8_t)(b * c2 + l);
+                }
+            }
+        }
+        row_max[j] = max_score;
+        row_cls[j] = max_class_id;
+        any |= max_class_id >= 0;
+    }
+    return any;
+}
+
+// c2 == 16 时一组正好是一个向量: 各通道分别保留最大分数及其所在的组(分数相同时保留靠前的组),
+// 再横向取最大分数, 取得该分数的通道中类别编号最小者即为第一个最大类别
+static bool class_scan_row_native16(const int8_t *score_row, int block_stride, int grid_w, const int *groups, int n_groups,
+                                    const int8_t *bars, int8_t *row_max, int8_t *row_cls)
+{
+    bool any = false;
+    int j = 0;
+#if defined(CLASS_SCAN_NEON)
+    static const uint8_t lane_ids[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+    uint8x16_t vlane = vld1q_u8(lane_ids);
+    for (; j < grid_w; j++) {
+        int8x16_t vmax = vdupq_n_s8(-128);
+        uint8x16_t vblk = vdupq_n_u8(0);
+        for (int g = 0; g < n_groups; g++) {
+            int b = groups[g];
+            int8x16_t v = vld1q_s8(score_row + b * block_stride + j * 16);
+            uint8x16_t gt = vandq_u8(vcgtq_s8(v, vmax), vcgtq_s8(v, vld1q_s8(bars + b * 16)));
+            vmax = vbslq_s8(gt, v, vmax);
+            vblk = vbslq_u8(gt, vdupq_n_u8((uint8_t)(b * 16)), vblk);
+        }
+#if defined(__aarch64__)
+        int8_t m = vmaxvq_s8(vmax);
+#else
+        int8x8_t mm = vpmax_s8(vget_low_s8(vmax), vget_high_s8(vmax));
+        mm = vpmax_s8(mm, mm);
+        mm = vpmax_s8(mm, mm);
+        mm = vpmax_s8(mm, mm);
+        int8_t m = vget_lane_s8(mm, 0);
+#endif
+        row_max[j] = m;
+        // 通过的分数严格大于 bars, 不会等于-128
+        if (m == -128) {
+            row_cls[j] = -1;
+            continue;
+        }
+        uint8x16_t ids = vorrq_u8(vaddq_u8(vblk, vlane), vmvnq_u8(vceqq_s8(vmax, vdupq_n_s8(m))));
+#if defined(__aarch64__)
+        row_cls[j] = (int8_t)vminvq_u8(ids);
+#else
+        uint8x8_t mi = vpmin_u8(vget_low_u8(ids), vget_high_u8(ids));
+        mi = vpmin_u8(mi, mi);
+        mi = vpmin_u8(mi, mi);
+        mi = vpmin_u8(mi, mi);
+        row_cls[j] = (int8_t)vget_lane_u8(mi, 0);
+#endif
+        any = true;
+    }
+#elif defined(CLASS_SCAN_SSE2)
+    const __m128i vlane = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    for (; j < grid_w; j++) {
+        __m128i vmax = _mm_set1_epi8(-128);
+        __m128i vblk = _mm_setzero_si128();
+        for (int g = 0; g < n_groups; g++) {
+            int b = groups[g];
+            __m128i v = _mm_loadu_si128((const __m128i *)(score_row + b * block_stride + j * 16));
+            __m128i bar = _mm_loadu_si128((const __m128i *)(bars + b * 16));
+            __m128i gt = _mm_and_si128(_mm_cmpgt_epi8(v, vmax), _mm_cmpgt_epi8(v, bar));
+            vmax = _mm_or_si128(_mm_and_si128(gt, v), _mm_andnot_si128(gt, vmax));
+            vblk = _mm_or_si128(_mm_and_si128(gt, _mm_set1_epi8((char)(b * 16))), _mm_andnot_si128(gt, vblk));
+        }
+        // SSE2 只有无符号字节的 max/min, 有符号分数先加偏移
+        __m128i u = _mm_xor_si128(vmax, bias);
+        u = _mm_max_epu8(u, _mm_srli_si128(u, 8));
+        u = _mm_max_epu8(u, _mm_srli_si128(u, 4));
+        u = _mm_max_epu8(u, _mm_srli_si128(u, 2));
+        u = _mm_max_epu8(u, _mm_srli_si128(u, 1));
+        int8_t m = (int8_t)((_mm_cvtsi128_si32(u) & 0xFF) ^ 0x80);
+        row_max[j] = m;
+        if (m == -128) {
+            row_cls[j] = -1;
+            continue;
+        }
+        __m128i eq = _mm_cmpeq_epi8(vmax, _mm_set1_epi8(m));
+        __m128i ids = _mm_or_si128(_mm_add_epi8(vblk, vlane), _mm_andnot_si128(eq, _mm_set1_epi8((char)0xFF)));
+        ids = _mm_min_epu8(ids, _mm_srli_si128(ids, 8));
+        ids = _mm_min_epu8(ids, _mm_srli_si128(ids, 4));
+        ids = _mm_min_epu8(ids, _mm_srli_si128(ids, 2));
+        ids = _mm_min_epu8(ids, _mm_srli_si128(ids, 1));
+        row_cls[j] = (int8_t)(_mm_cvtsi128_si32(ids) & 0xFF);
+        any = true;
+    }
+#endif
+    any |= scan_cells_native(score_row, block_stride, j, grid_w, groups, n_groups, 16, bars, row_max, row_cls);
+    return any;
+}
+
+bool class_scan_row_native(const int8_t *score_row, int block_stride, int grid_w, const int *groups, int n_groups, int c2,
+                           const int8_t *bars, int8_t *row_max, int8_t *row_cls)
+{
+    if (c2 == 16)
+        return class_scan_row_native16(score_row, block_stride, grid_w, groups, n_groups, bars, row_max, row_cls);
+    return scan_cells_native(score_row, block_stride, 0, grid_w, groups, n_groups, c2, bars, row_max, row_cls);
+}
+
+bool class_scan_row_native_scalar(const int8_t *score_row, int block_stride, int grid_w, const int *groups, int n_groups, int c2,
+                                  const int8_t *bars, int8_t *row_max, int8_t *row_cls)
+{
+    return scan_cells_native(score_row, block_stride, 0, grid_w, groups, n_groups, c2, bars, row_max, row_cls);
+}
+
+const char *class_scan_isa()
+{
+    return class_scan_kernel().name;
+}
@@ -1,9 +1,14 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
 #include <memory>
 #include <sys/time.h>
 #include <string>
 #include <vector>
 #include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
 
 #include "opencv2/core/core.hpp"
 #include "opencv2/highgui/highgui.hpp"
@@ -11,6 +16,9 @@
 #include "opencv2/videoio.hpp" // For cv::VideoWriter
 #include "Yolo11.hpp"
 #include "rknnPool.hpp"
+#include "rknnPipeline.hpp"
+#include "CaptureThread.hpp"
+#include "OutputSink.hpp"
 
 // 定义输出模式
 enum class OutputMode {
@@ -18,59 +26,568 @@ enum class OutputMode {
     RTP_STREAM // RTP推流
 };
 
+// 读帧->推理->输出的主循环, PoolType 为 rknnPool 或 rknnPipeline; 返回处理的帧数
+template <typename PoolType>
+static int run_loop(PoolType &pool, int warmup, CaptureThread &capture, OutputSink &sink)
+{
+    struct timeval time;
+    gettimeofday(&time, nullptr);
+    auto beforeTime = time.tv_sec * 1000 + time.tv_usec / 1000;
+    int frames = 0;
+
+    while (capture.isOpened())
+    {
+        cv::Mat img;
+        if (!capture.read(img))
+            break;
+
+        if (pool.put(img) != 0)
+            break;
+
+        if (frames >= warmup && pool.get(img) != 0)
+            break;
+
+        // --- 交给输出线程 ---
+        if (!sink.push(img))
+            break;
+
+        frames++;
+
+        if (frames % 120 == 0) {
+            gettimeofday(&time, nullptr);
+            auto currentTime = time.tv_sec * 1000 + time.tv_usec / 1000;
+            printf("Average FPS over 120 frames:\t %f fps/s\n", 120.0 / float(currentTime - beforeTime) * 1000.0);
+            beforeTime = currentTime;
+        }
+    }
+
+    // --- 清理剩余帧 ---
+    while (true)
+    {
+        cv::Mat img;
+        if (pool.get(img) != 0)
+            break;
+
+        if (!sink.push(img))
+            break;
+        frames++;
+    }
+    return frames;
+}
+
+// 实时模式主循环: 读帧后立即提交, 只输出已完成的结果, 推理跟不上时由丢帧策略决定丢弃哪些帧
+template <typename PoolType>
+static int run_live_loop(PoolType &pool, CaptureThread &capture, OutputSink &sink)
+{
+    struct timeval time;
+    gettimeofday(&time, nullptr);
+    auto beforeTime = time.tv_sec * 1000 + time.tv_usec / 1000;
+    int frames = 0;
+    bool quit = false;
+
+    while (!quit && capture.isOpened())
+    {
+        cv::Mat img;
+        if (!capture.read(img))
+            break;
+
+        if (pool.put(img) < 0)
+            break;
+
+        while (pool.try_get(img) == 0)
+        {
+            if (!sink.push(img)) {
+                quit = true;
+                break;
+            }
+            frames++;
+
+            if (frames % 120 == 0) {
+                gettimeofday(&time, nullptr);
+                auto currentTime = time.tv_sec * 1000 + time.tv_usec / 1000;
+                printf("Average FPS over 120 frames:\t %f fps/s\n", 120.0 / float(currentTime - beforeTime) * 1000.0);
+                beforeTime = currentTime;
+            }
+        }
+    }
+
+    // --- 清理剩余帧 ---
+    while (!quit)
+    {
+        cv::Mat img;
+        if (pool.get(img) != 0)
+            break;
+
+        if (!sink.push(img))
+            break;
+        frames++;
+    }
+    return frames;
+}
+
+// 检测记录主循环: 推理池只返回检测框, 不绘制; 有输出端时由主线程按记录绘制后交给输出线程
+template <typename PoolType>
+static int run_record_loop(PoolType &pool, int warmup, CaptureThread &capture, OutputSink *sink, const Yolo11 &drawer)
+{
+    struct timeval time;
+    gettimeofday(&time, nullptr);
+    auto beforeTime = time.tv_sec * 1000 + time.tv_usec / 1000;
+    int frames = 0;
+    long long submitted = 0, detections = 0;
+    double latencySumMs = 0, maxLatencyMs = 0;
+    bool quit = false;
+
+    // 返回 false 表示输出端已关闭
+    auto consume = [&](DetectionHandle &record) {
+        if (!record)
+            return true;
+        frames++;
+        detections += record->count();
+        double latencyMs = std::chrono::duration<double, std::milli>(record->infer_done - record->capture_time).count();
+        latencySumMs += latencyMs;
+        maxLatencyMs = std::max(maxLatencyMs, latencyMs);
+        if (frames % 120 == 0) {
+            gettimeofday(&time, nullptr);
+            auto currentTime = time.tv_sec * 1000 + time.tv_usec / 1000;
+            printf("Average FPS over 120 frames:\t %f fps/s\n", 120.0 / float(currentTime - beforeTime) * 1000.0);
+            beforeTime = currentTime;
+        }
+        if (sink != nullptr) {
+            drawer.draw(record->frame, *record);
+            return sink->push(record->frame);
+        }
+        return true;
+    };
+
+    while (!quit && capture.isOpened())
+    {
+        DetectionRequest request;
+        if (!capture.read(request.frame))
+            break;
+        request.frame_id = submitted;
+        request.capture_time = std::chrono::steady_clock::now();
+        // 没有输出端时不保留原图, 帧缓冲在推理后即可复用
+        request.keep_frame = sink != nullptr;
+
+        if (pool.put(request) != 0)
+            break;
+
+        if (submitted++ >= warmup) {
+            DetectionHandle record;
+            if (pool.get(record) != 0)
+                break;
+            quit = !consume(record);
+        }
+    }
+
+    // --- 清理剩余帧 ---
+    while (true)
+    {
+        DetectionHandle record;
+        if (pool.get(record) != 0)
+            break;
+        if (!quit)
+            quit = !consume(record);
+    }
+    printf("Records: %d frames, %.2f detections/frame, capture to result avg %.2f ms max %.2f ms\n", frames,
+           frames > 0 ? (double)detections / frames : 0.0, frames > 0 ? latencySumMs / frames : 0.0, maxLatencyMs);
+    return frames;
+}
+
+// 打开视频文件, 或以单个数字表示的摄像头
+static bool open_capture(cv::VideoCapture &capture, const std::string &video_source)
+{
+    if (video_source.length() == 1 && isdigit(video_source[0])) {
+        std::string gst_pipeline = "libcamerasrc ! image/jpeg,width=1920,height=1080,framerate=30/1 ! jpegdec ! videoconvert ! video/x-raw,format=BGR ! appsink";
+        printf("Using GStreamer pipeline for camera: %s\n", gst_pipeline.c_str());
+        capture.open(gst_pipeline, cv::CAP_GSTREAMER);
+    } else {
+        printf("Opening video file: %s\n", video_source.c_str());
+        capture.open(video_source);
+    }
+
+    if (!capture.isOpened()) {
+        fprintf(stderr, "Error: Could not open video source: %s\n", video_source.c_str());
+        return false;
+    }
+    return true;
+}
+
+// 多路输入主循环: 每路一个读帧线程向同一个 rknnPool 提交, 主线程按流交给输出线程
+template <typename PoolType>
+static int run_multi_loop(PoolType &pool, std::vector<std::unique_ptr<CaptureThread>> &captures, OutputSink &sink)
+{
+    std::atomic<int> readers((int)captures.size());
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < captures.size(); i++) {
+        threads.emplace_back([&pool, &captures, &readers, &stop, i]() {
+            while (!stop) {
+                cv::Mat img;
+                if (!captures[i]->read(img) || pool.put(img, (int)i) < 0)
+                    break;
+            }
+            readers--;
+        });
+    }
+
+    struct timeval time;
+    gettimeofday(&time, nullptr);
+    auto beforeTime = time.tv_sec * 1000 + time.tv_usec / 1000;
+    int frames = 0;
+    while (true)
+    {
+        // 先确认读帧线程已全部退出, 再判断是否还有在途帧
+        bool finished = readers == 0;
+        cv::Mat img;
+        int stream;
+        int ret = pool.get_for(img, std::chrono::milliseconds(100), nullptr, &stream);
+        if (ret == 1 && finished)
+            break;
+        if (ret != 0)
+            continue;
+
+        if (!sink.push(img, stream))
+            break;
+        frames++;
+
+        if (frames % 120 == 0) {
+            gettimeofday(&time, nullptr);
+            auto currentTime = time.tv_sec * 1000 + time.tv_usec / 1000;
+            printf("Average FPS over 120 frames (all streams):\t %f fps/s\n", 120.0 / float(currentTime - beforeTime) * 1000.0);
+            beforeTime = currentTime;
+        }
+    }
+
+    stop = true;
+    // 读帧线程可能阻塞在put上, 取走剩余结果让它们退出
+    while (readers > 0) {
+        cv::Mat img;
+        pool.get_for(img, std::chrono::milliseconds(10));
+    }
+    for (auto &t : threads)
+        t.join();
+    return frames;
+}
+
+// 各NPU核心的利用率及核心均衡迁移的上下文数
+template <typename PoolType>
+static void print_core_stats(PoolType &pool)
+{
+    std::vector<rknnCoreStats> cores = pool.getCoreStats();
+    for (size_t i = 0; i < cores.size(); i++) {
+        printf("Core %zu: %d contexts, %lld runs, %.1f ms/frame, utilization %.0f%%, moved in %lld out %lld\n",
+               i, cores[i].contexts, cores[i].runs, cores[i].avgRunMs, cores[i].utilization * 100, cores[i].movedIn,
+               cores[i].movedOut);
+    }
+}
+
+// 解析 [lo, hi] 内的数值参数, 不是完整的数字或超出范围时打印错误并返回false
+static bool parse_float(const char *name, const char *text, float lo, float hi, float &value)
+{
+    char *end = nullptr;
+    float v = strtof(text, &end);
+    if (end == text || *end != '\0' || !(v >= lo && v <= hi)) {
+        fprintf(stderr, "Invalid %s %s, expected a number in %g~%g\n", name, text, lo, hi);
+        return false;
+    }
+    value = v;
+    return true;
+}
+
+static bool parse_int(const char *name, const char *text, int lo, int hi, int &value)
+{
+    char *end = nullptr;
+    long v = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || v < lo || v > hi) {
+        fprintf(stderr, "Invalid %s %s, expected an integer in %d~%d\n", name, text, lo, hi);
+        return false;
+    }
+    value = (int)v;
+    return true;
+}
+
 int main(int argc, char **argv)
 {
     // --- 参数解析 ---
     if (argc < 3) {
-        printf("Usage: %s <rknn model> <video_path | camera_id> [--stream rtp://<ip>:<port>]\n", argv[0]);
+        printf("Usage: %s <rknn model> <video_path | camera_id> [--stream rtp://<ip>:<port>] [--pipeline] [--unordered] [--shed block|drop-newest|drop-oldest|keep-latest] [--source <video_path | camera_id>]... [--letterbox] [--want-float] [--nms-topk <k>] [--nms-batched] [--labels <path>] [--conf <t>] [--class-conf <id>=<t>]... [--nms-thresh <t>] [--max-det <n>] [--classes <id,id,...>] [--records] [--headless] [--zero-copy] [--native-output] [--async] [--core-strategy single|multi|mixed|auto] [--core-set <core,core,...>] [--core-balance]\n", argv[0]);
         return -1;
     }
 
     char *model_name = argv[1];
-    char *video_name = argv[2];
+    std::vector<std::string> sources(1, argv[2]);
     OutputMode output_mode = OutputMode::DISPLAY;
     std::string rtp_url;
+    bool use_pipeline = false;
+    rknnOrder order = rknnOrder::STRICT;
+    bool live = false;
+    rknnShedPolicy shed_policy = rknnShedPolicy::BLOCK;
+    Yolo11Options model_options;
+    decode_config decode;
+    std::vector<std::vector<int>> stream_classes(1); // 与 sources 一一对应
+    bool use_records = false;
+    bool headless = false;
+    int framesPerModel = 1; // 每个rknn上下文同时在途的帧数
+    rknnCoreStrategy core_strategy = rknnCoreStrategy::SINGLE;
+    int core_set = RKNN_NPU_CORE_AUTO; // 允许使用的NPU核心, 0表示全部
+    bool core_balance = false;
 
     for (int i = 3; i < argc; ++i) {
         if (std::string(argv[i]) == "--stream" && (i + 1) < argc) {
             output_mode = OutputMode::RTP_STREAM;
             rtp_url = argv[i + 1];
             i++; // 跳过URL参数
+        } else if (std::string(argv[i]) == "--pipeline") {
+            use_pipeline = true;
+        } else if (std::string(argv[i]) == "--unordered") {
+            // 按完成顺序输出, 适合不关心显示顺序的分析场景
+            order = rknnOrder::UNORDERED;
+        } else if (std::string(argv[i]) == "--shed" && (i + 1) < argc) {
+            // 实时模式: 推理跟不上输入时按策略丢帧, 而不是拖慢读帧
+            std::string policy = argv[i + 1];
+            if (policy == "block") {
+                shed_policy = rknnShedPolicy::BLOCK;
+            } else if (policy == "drop-newest") {
+                shed_policy = rknnShedPolicy::DROP_NEWEST;
+            } else if (policy == "drop-oldest") {
+                shed_policy = rknnShedPolicy::DROP_OLDEST;
+            } else if (policy == "keep-latest") {
+                shed_policy = rknnShedPolicy::KEEP_LATEST;
+            } else {
+                fprintf(stderr, "Unknown shed policy: %s\n", policy.c_str());
+                return -1;
+            }
+            live = true;
+            i++;
+        } else if (std::string(argv[i]) == "--source" && (i + 1) < argc) {
+            // 额外的输入源, 多路输入共享同一组rknn上下文
+            sources.push_back(argv[i + 1]);
+            stream_classes.emplace_back();
+            i++;
+        } else if (std::string(argv[i]) == "--letterbox") {
+            // 保持纵横比缩放并填充, 16:9画面不再被压扁
+            model_options.resize_mode = ResizeMode::LETTERBOX;
+        } else if (std::string(argv[i]) == "--want-float") {
+            // 由运行时把输出转换为float32, 用于和int8/fp16原生输出的解码对比
+            model_options.want_float = true;
+        } else if (std::string(argv[i]) == "--zero-copy") {
+            // 预处理直接写入绑定到rknn上下文的输入内存, 省去 rknn_inputs_set 的拷贝
+            model_options.zero_copy = true;
+        } else if (std::string(argv[i]) == "--native-output") {
+            // int8输出保持NPU原生的NC1HWC2布局写入预先绑定的内存, 运行时不再转换为NCHW
+            model_options.native_output = true;
+        } else if (std::string(argv[i]) == "--async") {
+            // 每个rknn上下文两帧在途: 一帧在NPU上执行时下一帧上传并提交, 较少的上下文即可占满NPU
+            model_options.async = true;
+            framesPerModel = 2;
+        } else if (std::string(argv[i]) == "--core-strategy" && (i + 1) < argc) {
+            // single: 每个上下文一个核心, 吞吐优先; multi: 每个上下文多核联合推理, 延迟优先;
+            // mixed: 第一个上下文用核心0/1, 其余用剩下的核心; auto: 由运行时选择空闲核心
+            std::string strategy = argv[i + 1];
+            if (strategy == "single") {
+                core_strategy = rknnCoreStrategy::SINGLE;
+            } else if (strategy == "multi") {
+                core_strategy = rknnCoreStrategy::MULTI;
+            } else if (strategy == "mixed") {
+                core_strategy = rknnCoreStrategy::MIXED;
+            } else if (strategy == "auto") {
+                core_strategy = rknnCoreStrategy::AUTO;
+            } else {
+                fprintf(stderr, "Unknown core strategy: %s\n", strategy.c_str());
+                return -1;
+            }
+            i++;
+        } else if (std::string(argv[i]) == "--core-set" && (i + 1) < argc) {
+            // 只使用这些NPU核心, 其余核心留给其他进程或模型
+            std::string list = argv[i + 1];
+            size_t pos = 0;
+            while (pos < list.size()) {
+                size_t next = list.find(',', pos);
+                if (next == std::string::npos)
+                    next = list.size();
+                int core = atoi(list.substr(pos, next - pos).c_str());
+                if (next == pos || core < 0 || core >= NPU_MAX_CORES) {
+                    fprintf(stderr, "Invalid --core-set %s, expected cores 0~%d\n", argv[i + 1], NPU_MAX_CORES - 1);
+                    return -1;
+                }
+                core_set |= 1 << core;
+                pos = next + 1;
+            }
+            i++;
+        } else if (std::string(argv[i]) == "--core-balance") {
+            // 按测得的每帧耗时把慢核心(降频或被其他进程占用)上的上下文迁到快核心
+            core_balance = true;
+        } else if (std::string(argv[i]) == "--nms-topk" && (i + 1) < argc) {
+            // 每个类别只取得分最高的k个候选做NMS, 拥挤场景下限制NMS的耗时
+            decode.nms.pre_nms_topk = atoi(argv[i + 1]);
+            i++;
+        } else if (std::string(argv[i]) == "--nms-batched") {
+            // 按类别平移坐标, 所有类别一次完成NMS
+            decode.nms.class_offset = true;
+        } else if (std::string(argv[i]) == "--labels" && (i + 1) < argc) {
+            // 自定义类别数的模型使用自己的标签文件, 每行一个类别名
+            decode.label_path = argv[i + 1];
+            i++;
+        } else if (std::string(argv[i]) == "--conf" && (i + 1) < argc) {
+            if (!parse_float("--conf", argv[i + 1], 0.f, 1.f, decode.conf_threshold))
+                return -1;
+            i++;
+        } else if (std::string(argv[i]) == "--class-conf" && (i + 1) < argc) {
+            // 单独设置某个类别的阈值, 格式为 类别编号=阈值, 可重复
+            int cls = 0;
+            float thres = 0;
+            if (sscanf(argv[i + 1], "%d=%f", &cls, &thres) != 2 || cls < 0 || cls >= OBJ_CLASS_MAX_NUM || !(thres >= 0.f && thres <= 1.f)) {
+                fprintf(stderr, "Invalid --class-conf %s, expected <id>=<threshold>\n", argv[i + 1]);
+                return -1;
+            }
+            if ((int)decode.class_thresholds.size() <= cls)
+                decode.class_thresholds.resize(cls + 1, -1.f);
+            decode.class_thresholds[cls] = thres;
+            i++;
+        } else if (std::string(argv[i]) == "--nms-thresh" && (i + 1) < argc) {
+            if (!parse_float("--nms-thresh", argv[i + 1], 0.f, 1.f, decode.nms_threshold))
+                return -1;
+            i++;
+        } else if (std::string(argv[i]) == "--max-det" && (i + 1) < argc) {
+            // 超过 OBJ_NUMB_MAX_SIZE 时由模型截断
+            if (!parse_int("--max-det", argv[i + 1], 1, INT_MAX, decode.max_detections))
+                return -1;
+            i++;
+        } else if (std::string(argv[i]) == "--classes" && (i + 1) < argc) {
+            // 前一个输入源只检测这些类别, 其余类别的分数平面不解码; 超出模型类别数的编号在模型初始化时去掉
+            std::string list = argv[i + 1];
+            size_t pos = 0;
+            while (pos < list.size()) {
+                size_t next = list.find(',', pos);
+                if (next == std::string::npos)
+                    next = list.size();
+                int id = 0;
+                if (next > pos) {
+                    if (!parse_int("--classes id", list.substr(pos, next - pos).c_str(), 0, OBJ_CLASS_MAX_NUM - 1, id))
+                        return -1;
+                    stream_classes.back().push_back(id);
+                }
+                pos = next + 1;
+            }
+            if (stream_classes.back().empty()) {
+                fprintf(stderr, "Invalid --classes %s, expected a list of class ids\n", argv[i + 1]);
+                return -1;
+            }
+            i++;
+        } else if (std::string(argv[i]) == "--records") {
+            // 推理池只返回检测记录(坐标/得分/类别), 绘制放到输出之前单独进行
+            use_records = true;
+        } else if (std::string(argv[i]) == "--headless") {
+            // 只做检测不输出画面, 不绘制也不保留原图
+            use_records = true;
+            headless = true;
         }
     }
-
-    // --- 初始化模型线程池 ---
-    int threadNum = 3;
-    rknnPool<Yolo11, cv::Mat, cv::Mat> testPool(model_name, threadNum);
-    if (testPool.init() != 0)
-    {
-        printf("rknnPool init fail!\n");
+    // 未单独设置的类别使用 --conf 的阈值
+    for (float &thres : decode.class_thresholds) {
+        if (thres < 0)
+            thres = decode.conf_threshold;
+    }
+    model_options.decode = decode;
+    model_options.stream_classes = stream_classes;
+    bool multi_stream = sources.size() > 1;
+    if (multi_stream && (use_pipeline || output_mode != OutputMode::DISPLAY)) {
+        fprintf(stderr, "Multiple sources only support local display with rknnPool\n");
+        return -1;
+    }
+    if (core_balance && use_pipeline) {
+        fprintf(stderr, "--core-balance only supports rknnPool\n");
+        return -1;
+    }
+    if (framesPerModel > 1 && use_pipeline) {
+        fprintf(stderr, "--async only supports rknnPool\n");
+        return -1;
+    }
+    if (use_records && (use_pipeline || multi_stream || live)) {
+        fprintf(stderr, "--records/--headless only support a single source with rknnPool\n");
         return -1;
     }
 
-    // --- 初始化视频捕捉 ---
-    cv::VideoCapture capture;
-    std::string video_source = video_name;
-
-    if (video_source.length() == 1 && isdigit(video_source[0])) {
-        std::string gst_pipeline = "libcamerasrc ! image/jpeg,width=1920,height=1080,framerate=30/1 ! jpegdec ! videoconvert ! video/x-raw,format=BGR ! appsink";
-        printf("Using GStreamer pipeline for camera: %s\n", gst_pipeline.c_str());
-        capture.open(gst_pipeline, cv::CAP_GSTREAMER);
+    // --- 初始化模型线程池或分阶段流水线 ---
+    int threadNum = 3;
+    std::unique_ptr<rknnPool<Yolo11, cv::Mat, cv::Mat>> testPool;
+    std::unique_ptr<rknnPool<Yolo11, DetectionRequest, DetectionHandle>> recordPool;
+    std::unique_ptr<rknnPipeline<Yolo11>> pipeline;
+    PipelineConfig pipelineConfig;
+    pipelineConfig.npuThreads = threadNum;
+    pipelineConfig.coreStrategy = core_strategy;
+    pipelineConfig.coreSet = (rknn_core_mask)core_set;
+    if (use_pipeline) {
+        pipeline.reset(new rknnPipeline<Yolo11>(model_name, pipelineConfig));
+        pipeline->setModelOptions(model_options);
+        if (pipeline->init() != 0) {
+            printf("rknnPipeline init fail!\n");
+            return -1;
+        }
+        printf("Mode: Staged pipeline\n");
+    } else if (use_records) {
+        recordPool.reset(new rknnPool<Yolo11, DetectionRequest, DetectionHandle>(model_name, threadNum, order));
+        recordPool->setModelOptions(model_options);
+        recordPool->setFramesPerModel(framesPerModel);
+        recordPool->setCoreStrategy(core_strategy, (rknn_core_mask)core_set);
+        recordPool->setCoreBalancer(core_balance);
+        if (recordPool->init() != 0) {
+            printf("rknnPool init fail!\n");
+            return -1;
+        }
+        printf("Mode: Detection records%s\n", headless ? " (headless)" : "");
     } else {
-        printf("Opening video file: %s\n", video_source.c_str());
-        capture.open(video_source);
+        int streamNum = (int)sources.size();
+        if (multi_stream) {
+            // 各路流内部保持顺序, 流之间互不阻塞; 每路至少能有两帧在途
+            testPool.reset(new rknnPool<Yolo11, cv::Mat, cv::Mat>(model_name, threadNum, rknnOrder::PER_STREAM,
+                                                                  std::max(threadNum * 4, streamNum * 2)));
+            testPool->setStreamCount(streamNum);
+            printf("Mode: %d streams\n", streamNum);
+        } else {
+            testPool.reset(new rknnPool<Yolo11, cv::Mat, cv::Mat>(model_name, threadNum, order));
+        }
+        testPool->setModelOptions(model_options);
+        testPool->setFramesPerModel(framesPerModel);
+        testPool->setCoreStrategy(core_strategy, (rknn_core_mask)core_set);
+        testPool->setCoreBalancer(core_balance);
+        // 在途帧上限为每个推理线程两帧: 一帧推理, 一帧排队
+        if (live)
+            testPool->setShedPolicy(shed_policy, std::max(threadNum * framesPerModel, streamNum) * 2, 100);
+        if (testPool->init() != 0) {
+            printf("rknnPool init fail!\n");
+            return -1;
+        }
     }
 
-    if (!capture.isOpened()) {
-        fprintf(stderr, "Error: Could not open video source: %s\n", video_name);
-        return -1;
+    // --- 初始化视频捕捉 ---
+    std::vector<cv::VideoCapture> videos(sources.size());
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (!open_capture(videos[i], sources[i]))
+            return -1;
     }
+    cv::VideoCapture &capture = videos[0];
 
-    // --- 根据模式初始化输出 (显示窗口或推流) ---
-    cv::VideoWriter video_writer;
+    // --- 根据模式初始化输出 (显示窗口或推流), 输出在独立线程中进行 ---
+    std::unique_ptr<OutputSink> sink;
 
-    if (output_mode == OutputMode::DISPLAY) {
-        cv::namedWindow("Camera FPS", cv::WINDOW_AUTOSIZE);
+    if (headless) {
+        printf("Mode: No output\n");
+    } else if (output_mode == OutputMode::DISPLAY) {
+        std::vector<std::string> windows;
+        if (multi_stream) {
+            for (size_t i = 0; i < sources.size(); i++)
+                windows.push_back("Camera " + std::to_string(i));
+        } else {
+            windows.push_back("Camera FPS");
+        }
+        // 每路保留两帧, 显示跟不上时只显示最新画面
+        sink.reset(new DisplaySink(windows));
+        if (sink->start() != 0) {
+            fprintf(stderr, "Error: Could not open display\n");
+            return -1;
+        }
         printf("Mode: Local Display\n");
     } else {
         // 从RTP URL中解析IP和端口
@@ -102,83 +619,104 @@ int main(int argc, char **argv)
         printf("Streaming to: %s\n", rtp_url.c_str());
         printf("GStreamer Pipeline: %s\n", gst_rtp_pipeline.c_str());
 
-        video_writer.open(gst_rtp_pipeline, cv::CAP_GSTREAMER, 0, fps, cv::Size(frame_width, frame_height), true);
-        if (!video_writer.isOpened()) {
+        sink.reset(new VideoWriterSink(gst_rtp_pipeline, fps, cv::Size(frame_width, frame_height)));
+        if (sink->start() != 0) {
             fprintf(stderr, "Error: Could not open VideoWriter for RTP streaming.\n");
             fprintf(stderr, "Hint: Please check if your OpenCV was built with GStreamer support and GStreamer plugins (especially x264enc) are installed.\n");
             return -1;
         }
     }
 
+    // --- 启动读帧线程 ---
+    // 帧缓冲数需覆盖下游(推理池/流水线+输出队列)同时持有的帧, 多路输入时按路均分
+    int downstream = use_pipeline ? pipeline->getDepth() : std::max(threadNum * 4, (int)sources.size() * 2);
+    int ringSize = downstream / (int)sources.size() + 4 + 2;
+    std::vector<std::unique_ptr<CaptureThread>> captures;
+    for (size_t i = 0; i < sources.size(); i++) {
+        bool camera = sources[i].length() == 1 && isdigit(sources[i][0]);
+        captures.emplace_back(new CaptureThread(videos[i], ringSize, camera));
+        if (captures.back()->start() != 0) {
+            fprintf(stderr, "Error: Could not start capture thread for %s\n", sources[i].c_str());
+            return -1;
+        }
+    }
+
     // --- 主循环 ---
     struct timeval time;
     gettimeofday(&time, nullptr);
     auto startTime = time.tv_sec * 1000 + time.tv_usec / 1000;
-    int frames = 0;
-    auto beforeTime = startTime;
-
-    while (capture.isOpened())
-    {
-        cv::Mat img;
-        if (!capture.read(img))
-            break;
-
-        if (testPool.put(img) != 0)
-            break;
+    int frames;
+    if (use_pipeline) {
+        // 保留一个空闲帧对象, 避免put在get之前因流水线已满而阻塞
+        frames = run_loop(*pipeline, pipeline->getDepth() - 1, *captures[0], *sink);
+    } else if (use_records) {
+        frames = run_record_loop(*recordPool, threadNum * framesPerModel, *captures[0], sink.get(), *recordPool->getModel(0));
+    } else if (multi_stream) {
+        frames = run_multi_loop(*testPool, captures, *sink);
+    } else if (live) {
+        frames = run_live_loop(*testPool, *captures[0], *sink);
+    } else {
+        frames = run_loop(*testPool, threadNum * framesPerModel, *captures[0], *sink);
+    }
 
-        if (frames >= threadNum && testPool.get(img) != 0)
-            break;
+    // 等待输出线程输出剩余的帧并关闭窗口/编码器
+    if (sink)
+        sink->close();
 
-        // --- 根据模式输出 ---
-        if (output_mode == OutputMode::DISPLAY) {
-            cv::imshow("Camera FPS", img);
-            if (cv::waitKey(1) == 'q')
-                break;
-        } else {
-            video_writer.write(img);
-        }
+    gettimeofday(&time, nullptr);
+    auto endTime = time.tv_sec * 1000 + time.tv_usec / 1000;
 
-        frames++;
+    printf("Total frames: %d\n", frames);
+    printf("Total time: %lld ms\n", endTime - startTime);
+    printf("Overall Average FPS:\t %f fps/s\n", float(frames) / float(endTime - startTime) * 1000.0);
 
-        if (frames % 120 == 0) {
-            gettimeofday(&time, nullptr);
-            auto currentTime = time.tv_sec * 1000 + time.tv_usec / 1000;
-            printf("Average FPS over 120 frames:\t %f fps/s\n", 120.0 / float(currentTime - beforeTime) * 1000.0);
-            beforeTime = currentTime;
+    // 各模型的派发数和最大排队深度, 用于确认负载是否均衡
+    if (recordPool) {
+        std::vector<rknnModelStats> stats = recordPool->getModelStats();
+        for (size_t i = 0; i < stats.size(); i++) {
+            printf("Model %zu (core mask 0x%x): dispatched %lld, max queue depth %d\n",
+                   i, stats[i].coreMask, stats[i].dispatched, stats[i].maxInflight);
         }
+        print_core_stats(*recordPool);
     }
-
-    // --- 清理剩余帧 ---
-    while (true)
-    {
-        cv::Mat img;
-        if (testPool.get(img) != 0)
-            break;
-
-        if (output_mode == OutputMode::DISPLAY) {
-            cv::imshow("Camera FPS", img);
-            if (cv::waitKey(1) == 'q')
-                break;
-        } else {
-            video_writer.write(img);
+    if (testPool) {
+        std::vector<rknnModelStats> stats = testPool->getModelStats();
+        for (size_t i = 0; i < stats.size(); i++) {
+            printf("Model %zu (core mask 0x%x): dispatched %lld, max queue depth %d\n",
+                   i, stats[i].coreMask, stats[i].dispatched, stats[i].maxInflight);
+        }
+        print_core_stats(*testPool);
+        rknnShedStats shed = testPool->getShedStats();
+        printf("Accepted %lld, dropped %lld, cancelled %lld, late(>100ms) %lld\n",
+               shed.accepted, shed.dropped, shed.cancelled, shed.late);
+        if (multi_stream) {
+            std::vector<rknnStreamStats> streams = testPool->getStreamStats();
+            for (size_t i = 0; i < streams.size(); i++) {
+                printf("Stream %zu: %lld frames, %.1f fps, latency avg %.1f ms max %.1f ms, dropped %lld, cancelled %lld\n",
+                       i, streams[i].completed, streams[i].fps, streams[i].avgLatencyMs, streams[i].maxLatencyMs,
+                       streams[i].dropped, streams[i].cancelled);
+            }
         }
-        frames++;
     }
 
-    gettimeofday(&time, nullptr);
-    auto endTime = time.tv_sec * 1000 + time.tv_usec / 1000;
+    // 解码耗时单独统计, 用于区分解码抖动和推理瓶颈
+    for (size_t i = 0; i < captures.size(); i++) {
+        captures[i]->stop();
+        CaptureStats cs = captures[i]->getStats();
+        printf("Capture %zu: %lld frames, decode avg %.2f ms max %.2f ms, stalls %lld, overwritten %lld\n",
+               i, cs.frames, cs.avgDecodeMs, cs.maxDecodeMs, cs.stalls, cs.overwritten);
+    }
 
-    printf("Total frames: %d\n", frames);
-    printf("Total time: %lld ms\n", endTime - startTime);
-    printf("Overall Average FPS:\t %f fps/s\n", float(frames) / float(endTime - startTime) * 1000.0);
+    // 输出端的延迟包含排队时间, dropped 表示显示/编码跟不上而跳过的帧
+    if (sink) {
+        SinkStats ss = sink->getStats();
+        printf("Sink %s: %lld frames, dropped %lld, latency avg %.2f ms max %.2f ms, write avg %.2f ms max %.2f ms\n",
+               sink->getName().c_str(), ss.written, ss.dropped, ss.avgLatencyMs, ss.maxLatencyMs, ss.avgWriteMs, ss.maxWriteMs);
+    }
 
     // 释放资源
-    capture.release();
-    if (output_mode == OutputMode::DISPLAY) {
-        cv::destroyAllWindows();
-    } else {
-        video_writer.release();
-    }
+    for (auto &c : videos)
+        c.release();
 
     return 0;
 }
\ No newline at end of file
@@ -9,72 +9,336 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
-#include <set>
+#include <algorithm>
 #include <vector>
 
-#define LABEL_NALE_TXT_PATH "./model/coco_80_labels_list.txt"
-
-static char *labels[OBJ_CLASS_NUM];
-
-// ... (readLine, readLines, loadLabelName, CalculateOverlap, nms, quick_sort_indice_inverse 等辅助函数保持不变，直接从你已有的文件中复制过来即可) ...
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define POSTPROCESS_F16C 1
+#endif
+#endif
+
+// ... (clamp, qnt_f32_to_affine 等辅助函数保持不变，直接从你已有的文件中复制过来即可) ...
 // (为了简洁，这里省略这些未改变的辅助函数)
 
 inline static int clamp(float val, int min, int max) { return val > min ? (val < max ? val : max) : min; }
-static char *readLine(FILE *fp, char *buffer, int *len){int ch;int i = 0;size_t buff_len = 0;buffer = (char *)malloc(buff_len + 1);if (!buffer)return NULL;while ((ch = fgetc(fp)) != '\n' && ch != EOF){buff_len++;void *tmp = realloc(buffer, buff_len + 1);if (tmp == NULL){free(buffer);return NULL;}buffer = (char *)tmp;buffer[i] = (char)ch;i++;}buffer[i] = '\0';*len = buff_len;if (ch == EOF && (i == 0 || ferror(fp))){free(buffer);return NULL;}return buffer;}
-static int readLines(const char *fileName, char *lines[], int max_line){FILE *file = fopen(fileName, "r");char *s;int i = 0;int n = 0;if (file == NULL){printf("Open %s fail!\n", fileName);return -1;}while ((s = readLine(file, s, &n)) != NULL){lines[i++] = s;if (i >= max_line)break;}fclose(file);return i;}
-static int loadLabelName(const char *locationFilename, char *label[]){printf("load lable %s\n", locationFilename);readLines(locationFilename, label, OBJ_CLASS_NUM);return 0;}
-static float CalculateOverlap(float xmin0, float ymin0, float xmax0, float ymax0, float xmin1, float ymin1, float xmax1,float ymax1){float w = fmax(0.f, fmin(xmax0, xmax1) - fmax(xmin0, xmin1) + 1.0);float h = fmax(0.f, fmin(ymax0, ymax1) - fmax(ymin0, ymin1) + 1.0);float i = w * h;float u = (xmax0 - xmin0 + 1.0) * (ymax0 - ymin0 + 1.0) + (xmax1 - xmin1 + 1.0) * (ymax1 - ymin1 + 1.0) - i;return u <= 0.f ? 0.f : (i / u);}
-static int nms(int validCount, std::vector<float> &outputLocations, std::vector<int> classIds, std::vector<int> &order,int filterId, float threshold){for (int i = 0; i < validCount; ++i){int n = order[i];if (n == -1 || classIds[n] != filterId){continue;}for (int j = i + 1; j < validCount; ++j){int m = order[j];if (m == -1 || classIds[m] != filterId){continue;}float xmin0 = outputLocations[n * 4 + 0];float ymin0 = outputLocations[n * 4 + 1];float xmax0 = outputLocations[n * 4 + 0] + outputLocations[n * 4 + 2];float ymax0 = outputLocations[n * 4 + 1] + outputLocations[n * 4 + 3];float xmin1 = outputLocations[m * 4 + 0];float ymin1 = outputLocations[m * 4 + 1];float xmax1 = outputLocations[m * 4 + 0] + outputLocations[m * 4 + 2];float ymax1 = outputLocations[m * 4 + 1] + outputLocations[m * 4 + 3];float iou = CalculateOverlap(xmin0, ymin0, xmax0, ymax0, xmin1, ymin1, xmax1, ymax1);if (iou > threshold){order[j] = -1;}}}return 0;}
-static int quick_sort_indice_inverse(std::vector<float> &input, int left, int right, std::vector<int> &indices){float key;int key_index;int low = left;int high = right;if (left < right){key_index = indices[left];key = input[left];while (low < high){while (low < high && input[high] <= key){high--;}input[low] = input[high];indices[low] = indices[high];while (low < high && input[low] >= key){low++;}input[high] = input[low];indices[high] = indices[low];}input[low] = key;indices[low] = key_index;quick_sort_indice_inverse(input, left, low - 1, indices);quick_sort_indice_inverse(input, low + 1, right, indices);}return low;}
 inline static int32_t __clip(float val, float min, float max){float f = val <= min ? min : (val >= max ? max : val);return f;}
 static int8_t qnt_f32_to_affine(float f32, int32_t zp, float scale){float dst_val = (f32 / scale) + zp;int8_t res = (int8_t)__clip(dst_val, -128, 127);return res;}
 static float deqnt_affine_to_f32(int8_t qnt, int32_t zp, float scale) { return ((float)qnt - (float)zp) * scale; }
+// softmax 期望: sum(i * e[i]) / sum(e[i]), n 为4的倍数时按4路向量累加
+static inline float dfl_expectation(const float *e, int n)
+{
+    int i = 0;
+    float sum = 0, acc = 0;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    float32x4_t vsum = vdupq_n_f32(0), vacc = vdupq_n_f32(0);
+    const float idx0[4] = {0, 1, 2, 3};
+    float32x4_t vidx = vld1q_f32(idx0), vstep = vdupq_n_f32(4);
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t v = vld1q_f32(e + i);
+        vsum = vaddq_f32(vsum, v);
+        vacc = vmlaq_f32(vacc, v, vidx);
+        vidx = vaddq_f32(vidx, vstep);
+    }
+    float lanes[4];
+    vst1q_f32(lanes, vsum);
+    sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    vst1q_f32(lanes, vacc);
+    acc = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__SSE2__)
+    __m128 vsum = _mm_setzero_ps(), vacc = _mm_setzero_ps();
+    __m128 vidx = _mm_setr_ps(0, 1, 2, 3), vstep = _mm_set1_ps(4);
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(e + i);
+        vsum = _mm_add_ps(vsum, v);
+        vacc = _mm_add_ps(vacc, _mm_mul_ps(v, vidx));
+        vidx = _mm_add_ps(vidx, vstep);
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, vsum);
+    sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    _mm_storeu_ps(lanes, vacc);
+    acc = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+    for (; i < n; i++) {
+        sum += e[i];
+        acc += e[i] * i;
+    }
+    return acc / sum;
+}
+
+void build_dfl_exp_lut(int32_t zp, float scale, float *lut)
+{
+    // 减去该张量取值范围的中点, softmax 结果不变, 范围两端的 exp 都不易上溢或下溢
+    float shift = (deqnt_affine_to_f32(127, zp, scale) + deqnt_affine_to_f32(-128, zp, scale)) / 2;
+    for (int q = -128; q <= 127; q++)
+        lut[q + 128] = expf(deqnt_affine_to_f32((int8_t)q, zp, scale) - shift);
+}
+
+void compute_dfl_i8(const int8_t *box_cell, int grid_len, int dfl_len, const float *exp_lut, float *box)
+{
+    float exp_t[dfl_len];
+    for (int b = 0; b < 4; b++) {
+        const int8_t *p = box_cell + b * dfl_len * grid_len;
+        for (int k = 0; k < dfl_len; k++, p += grid_len)
+            exp_t[k] = exp_lut[*p + 128];
+        box[b] = dfl_expectation(exp_t, dfl_len);
+    }
+}
+
+// IEEE 半精度转单精度, 含非规格化数和 inf/nan
+static inline float half_to_float(uint16_t h)
+{
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t bits;
+    if (exp == 0x1f) {
+        bits = sign | 0x7f800000 | (mant << 13);
+    } else if (exp != 0) {
+        bits = sign | ((exp + 112) << 23) | (mant << 13);
+    } else if (mant == 0) {
+        bits = sign;
+    } else {
+        // 非规格化数: 移位到隐含的1所在的位置
+        exp = 113;
+        while ((mant & 0x400) == 0) {
+            mant <<= 1;
+            exp--;
+        }
+        bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static void fp16_to_fp32_simd(const uint16_t *src, float *dst, int n)
+{
+    int i = 0;
+#if defined(__aarch64__)
+    for (; i + 8 <= n; i += 8) {
+        float16x8_t h = vreinterpretq_f16_u16(vld1q_u16(src + i));
+        vst1q_f32(dst + i, vcvt_f32_f16(vget_low_f16(h)));
+        vst1q_f32(dst + i + 4, vcvt_high_f32_f16(h));
+    }
+#endif
+    for (; i < n; i++)
+        dst[i] = half_to_float(src[i]);
+}
+
+#if defined(POSTPROCESS_F16C)
+__attribute__((target("avx,f16c"))) static void fp16_to_fp32_f16c(const uint16_t *src, float *dst, int n)
+{
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(src + i))));
+    for (; i < n; i++)
+        dst[i] = half_to_float(src[i]);
+}
+#endif
+
+struct Fp16Kernel
+{
+    void (*fn)(const uint16_t *, float *, int);
+    const char *name;
+};
+
+static Fp16Kernel select_fp16_kernel()
+{
+#if defined(POSTPROCESS_F16C)
+    if (__builtin_cpu_supports("f16c") && __builtin_cpu_supports("avx"))
+        return {fp16_to_fp32_f16c, "f16c"};
+#endif
+#if defined(__aarch64__)
+    return {fp16_to_fp32_simd, "neon"};
+#else
+    return {fp16_to_fp32_simd, "scalar"};
+#endif
+}
+
+static const Fp16Kernel &fp16_kernel()
+{
+    static const Fp16Kernel kernel = select_fp16_kernel();
+    return kernel;
+}
+
+void fp16_to_fp32(const uint16_t *src, float *dst, int n)
+{
+    fp16_kernel().fn(src, dst, n);
+}
+
+const char *fp16_convert_isa()
+{
+    return fp16_kernel().name;
+}
+
 static void compute_dfl(float* tensor, int dfl_len, float* box){for (int b=0; b<4; b++){float exp_t[dfl_len];float exp_sum=0;float acc_sum=0;for (int i=0; i< dfl_len; i++){exp_t[i] = exp(tensor[i+b*dfl_len]);exp_sum += exp_t[i];}for (int i=0; i< dfl_len; i++){acc_sum += exp_t[i]/exp_sum *i;}box[b] = acc_sum;}}
 
 // 关键修复：修正了 process_i8 函数中的大括号不匹配问题
-static int process_i8(int8_t *box_tensor, int32_t box_zp, float box_scale,
+static int process_i8(int8_t *box_tensor, int32_t box_zp, float box_scale, const float *box_exp_lut,
                       int8_t *score_tensor, int32_t score_zp, float score_scale,
                       int8_t *score_sum_tensor, int32_t score_sum_zp, float score_sum_scale,
-                      int grid_h, int grid_w, int stride, int dfl_len,
+                      int grid_h, int grid_w, int stride, int dfl_len, int num_class, const int *class_ids, int n_ids,
                       std::vector<float> &boxes,
                       std::vector<float> &objProbs,
                       std::vector<int> &classId,
-                      float threshold)
+                      const float *class_thres, float threshold)
 {
     int validCount = 0;
     int grid_len = grid_h * grid_w;
-    int8_t score_thres_i8 = qnt_f32_to_affine(threshold, score_zp, score_scale);
+    // score_sum 不小于任一类别分数, 低于最小的类别阈值时该格子不会有类别通过
     int8_t score_sum_thres_i8 = qnt_f32_to_affine(threshold, score_sum_zp, score_sum_scale);
+    // 类别分数需同时大于该类别的阈值和 -score_zp(即0分)才会被选中
+    // class_ids 不为空时只扫描其中的类别, score_bars 按列表顺序排列
+    int8_t min_score = -score_zp;
+    int n_scan = class_ids != nullptr ? n_ids : num_class;
+    int8_t score_bars[n_scan];
+    for (int k = 0; k < n_scan; k++) {
+        int c = class_ids != nullptr ? class_ids[k] : k;
+        int8_t score_thres_i8 = qnt_f32_to_affine(class_thres[c], score_zp, score_scale);
+        score_bars[k] = score_thres_i8 > min_score ? score_thres_i8 : min_score;
+    }
+    int8_t row_max[grid_w];
+    int8_t row_cls[grid_w];
 
     for (int i = 0; i < grid_h; i++) {
+        const int8_t *score_sum_row = score_sum_tensor != nullptr ? score_sum_tensor + i * grid_w : nullptr;
+        if (score_sum_row != nullptr) {
+            // 整行的 score_sum 都低于阈值时跳过这一行的类别扫描
+            bool row_pass = false;
+            for (int j = 0; j < grid_w; j++)
+                row_pass |= score_sum_row[j] >= score_sum_thres_i8;
+            if (!row_pass)
+                continue;
+        }
+
+        // 一次扫描整行格子的所有类别; 行内没有分数超过阈值时提前结束
+        const int8_t *score_row = score_tensor + i * grid_w;
+        bool any = class_ids != nullptr ? class_scan_row_list(score_row, grid_len, grid_w, class_ids, n_ids, score_bars, row_max, row_cls)
+                                        : class_scan_row(score_row, grid_len, grid_w, num_class, score_bars, row_max, row_cls);
+        if (!any)
+            continue;
+
         for (int j = 0; j < grid_w; j++) {
-            int offset = i * grid_w + j;
-            int max_class_id = -1;
+            if (score_sum_row != nullptr && score_sum_row[j] < score_sum_thres_i8) {
+                continue;
+            }
 
-            if (score_sum_tensor != nullptr) {
-                if (score_sum_tensor[offset] < score_sum_thres_i8) {
-                    continue;
+            int max_class_id = row_cls[j];
+            int8_t max_score = row_max[j];
+            if (max_class_id >= 0) {
+                int offset = i * grid_w + j;
+                float box[4];
+                if (box_exp_lut != nullptr) {
+                    compute_dfl_i8(box_tensor + offset, grid_len, dfl_len, box_exp_lut, box);
+                } else {
+                    float before_dfl[dfl_len * 4];
+                    for (int k = 0; k < dfl_len * 4; k++) {
+                        before_dfl[k] = deqnt_affine_to_f32(box_tensor[offset], box_zp, box_scale);
+                        offset += grid_len;
+                    }
+                    compute_dfl(before_dfl, dfl_len, box);
                 }
-            } // ** 修复点：这里缺少了一个 '}' **
 
-            int8_t max_score = -score_zp;
-            for (int c = 0; c < OBJ_CLASS_NUM; c++) {
-                if ((score_tensor[offset] > score_thres_i8) && (score_tensor[offset] > max_score)) {
-                    max_score = score_tensor[offset];
-                    max_class_id = c;
-                }
-                offset += grid_len;
+                float x1, y1, x2, y2, w, h;
+                x1 = (-box[0] + j + 0.5) * stride;
+                y1 = (-box[1] + i + 0.5) * stride;
+                x2 = (box[2] + j + 0.5) * stride;
+                y2 = (box[3] + i + 0.5) * stride;
+                w = x2 - x1;
+                h = y2 - y1;
+                boxes.push_back(x1);
+                boxes.push_back(y1);
+                boxes.push_back(w);
+                boxes.push_back(h);
+
+                objProbs.push_back(deqnt_affine_to_f32(max_score, score_zp, score_scale));
+                classId.push_back(max_class_id);
+                validCount++;
+            }
+        }
+    }
+    return validCount;
+}
+
+
+// 原生 NC1HWC2 布局输出的解码, 省去运行时把输出转换为 NCHW; 每个通道 c 位于第 c / c2 组中格子的第 c % c2 项
+// 流程与 process_i8 相同: score_sum 跳过整行, 类别扫描后只对通过的格子做DFL
+static int process_i8_native(const int8_t *box_tensor, int32_t box_zp, float box_scale, const float *box_exp_lut, int box_c2,
+                             const int8_t *score_tensor, int32_t score_zp, float score_scale, int score_c1, int score_c2,
+                             const int8_t *score_sum_tensor, int32_t score_sum_zp, float score_sum_scale, int score_sum_c2,
+                             int grid_h, int grid_w, int stride, int dfl_len, int num_class, const int *class_ids, int n_ids,
+                             std::vector<float> &boxes,
+                             std::vector<float> &objProbs,
+                             std::vector<int> &classId,
+                             const float *class_thres, float threshold)
+{
+    int validCount = 0;
+    int grid_len = grid_h * grid_w;
+    int8_t score_sum_thres_i8 = qnt_f32_to_affine(threshold, score_sum_zp, score_sum_scale);
+    // 阈值按通道排列, 补齐的通道和不解码的类别为127, 不可能通过
+    int8_t min_score = -score_zp;
+    int n_lanes = score_c1 * score_c2;
+    int8_t score_bars[n_lanes];
+    memset(score_bars, 127, sizeof(score_bars));
+    int n_scan = class_ids != nullptr ? n_ids : num_class;
+    for (int k = 0; k < n_scan; k++) {
+        int c = class_ids != nullptr ? class_ids[k] : k;
+        int8_t score_thres_i8 = qnt_f32_to_affine(class_thres[c], score_zp, score_scale);
+        score_bars[c] = score_thres_i8 > min_score ? score_thres_i8 : min_score;
+    }
+    // 只读取含有所选类别的组, 如80类中只检测 person/car/truck 时只读5组中的第0组
+    int groups[score_c1];
+    int n_groups = 0;
+    for (int k = 0; k < n_scan; k++) {
+        int b = (class_ids != nullptr ? class_ids[k] : k) / score_c2;
+        if (n_groups == 0 || groups[n_groups - 1] != b)
+            groups[n_groups++] = b;
+    }
+    int8_t row_max[grid_w];
+    int8_t row_cls[grid_w];
+    int8_t box_cell[dfl_len * 4];
+
+    for (int i = 0; i < grid_h; i++) {
+        const int8_t *score_sum_row = score_sum_tensor != nullptr ? score_sum_tensor + i * grid_w * score_sum_c2 : nullptr;
+        if (score_sum_row != nullptr) {
+            bool row_pass = false;
+            for (int j = 0; j < grid_w; j++)
+                row_pass |= score_sum_row[j * score_sum_c2] >= score_sum_thres_i8;
+            if (!row_pass)
+                continue;
+        }
+
+        if (!class_scan_row_native(score_tensor + i * grid_w * score_c2, grid_len * score_c2, grid_w, groups, n_groups, score_c2,
+                                   score_bars, row_max, row_cls))
+            continue;
+
+        for (int j = 0; j < grid_w; j++) {
+            if (score_sum_row != nullptr && score_sum_row[j * score_sum_c2] < score_sum_thres_i8) {
+                continue;
             }
 
-            if (max_score > score_thres_i8) {
-                offset = i * grid_w + j;
+            int max_class_id = row_cls[j];
+            int8_t max_score = row_max[j];
+            if (max_class_id >= 0) {
+                // 把该格子的 4 * dfl_len 个bin收集到一起, 按 NCHW 中 grid_len 为1的情形解码
+                int cell = i * grid_w + j;
+                for (int k = 0; k < dfl_len * 4; k++)
+                    box_cell[k] = box_tensor[((k / box_c2) * grid_len + cell) * box_c2 + k % box_c2];
                 float box[4];
-                float before_dfl[dfl_len * 4];
-                for (int k = 0; k < dfl_len * 4; k++) {
-                    before_dfl[k] = deqnt_affine_to_f32(box_tensor[offset], box_zp, box_scale);
-                    offset += grid_len;
+                if (box_exp_lut != nullptr) {
+                    compute_dfl_i8(box_cell, 1, dfl_len, box_exp_lut, box);
+                } else {
+                    float before_dfl[dfl_len * 4];
+                    for (int k = 0; k < dfl_len * 4; k++)
+                        before_dfl[k] = deqnt_affine_to_f32(box_cell[k], box_zp, box_scale);
+                    compute_dfl(before_dfl, dfl_len, box);
                 }
-                compute_dfl(before_dfl, dfl_len, box);
 
                 float x1, y1, x2, y2, w, h;
                 x1 = (-box[0] + j + 0.5) * stride;
@@ -98,11 +362,262 @@ static int process_i8(int8_t *box_tensor, int32_t box_zp, float box_scale,
 }
 
 
-int post_process(Yolo11 *model_instance, rknn_output *outputs, BOX_RECT *letter_box, float conf_threshold, float nms_threshold, object_detect_result_list *od_results)
+// 一段连续输出的float形式: fp32 直接使用原数据, fp16 转换到 tmp
+static inline const float *float_row(const float *src, int n, float *tmp) { return src; }
+static inline const float *float_row(const uint16_t *src, int n, float *tmp)
+{
+    fp16_to_fp32(src, tmp, n);
+    return tmp;
+}
+
+// 非量化输出的解码, T 为 float(运行时转换的fp32) 或 uint16_t(原生fp16)
+// 与 process_i8 相同按行处理: 先用 score_sum 跳过整行, 再逐个类别平面取该行的一段更新各格子的最大分数
+template <typename T>
+static int process_float(const T *box_tensor, const T *score_tensor, const T *score_sum_tensor,
+                         int grid_h, int grid_w, int stride, int dfl_len, int num_class, const int *class_ids, int n_ids,
+                         std::vector<float> &boxes,
+                         std::vector<float> &objProbs,
+                         std::vector<int> &classId,
+                         const float *class_thres, float threshold)
+{
+    int validCount = 0;
+    int grid_len = grid_h * grid_w;
+    // 类别分数需同时大于该类别的阈值和0才会被选中; class_ids 不为空时只读取其中的类别平面
+    int n_scan = class_ids != nullptr ? n_ids : num_class;
+    float score_bars[n_scan];
+    for (int k = 0; k < n_scan; k++) {
+        int c = class_ids != nullptr ? class_ids[k] : k;
+        score_bars[k] = class_thres[c] > 0 ? class_thres[c] : 0;
+    }
+    float row_max[grid_w];
+    int row_cls[grid_w];
+    float row_tmp[grid_w];
+
+    for (int i = 0; i < grid_h; i++) {
+        const float *score_sum_row = nullptr;
+        float score_sum_buf[grid_w];
+        if (score_sum_tensor != nullptr) {
+            score_sum_row = float_row(score_sum_tensor + i * grid_w, grid_w, score_sum_buf);
+            bool row_pass = false;
+            for (int j = 0; j < grid_w; j++)
+                row_pass |= score_sum_row[j] >= threshold;
+            if (!row_pass)
+                continue;
+        }
+
+        for (int j = 0; j < grid_w; j++) {
+            row_max[j] = 0;
+            row_cls[j] = -1;
+        }
+        bool any = false;
+        for (int k = 0; k < n_scan; k++) {
+            int c = class_ids != nullptr ? class_ids[k] : k;
+            const float *v = float_row(score_tensor + c * grid_len + i * grid_w, grid_w, row_tmp);
+            float bar = score_bars[k];
+            for (int j = 0; j < grid_w; j++) {
+                if (v[j] > row_max[j] && v[j] > bar) {
+                    row_max[j] = v[j];
+                    row_cls[j] = c;
+                    any = true;
+                }
+            }
+        }
+        if (!any)
+            continue;
+
+        for (int j = 0; j < grid_w; j++) {
+            if (row_cls[j] < 0 || (score_sum_row != nullptr && score_sum_row[j] < threshold))
+                continue;
+
+            int offset = i * grid_w + j;
+            T before_dfl[dfl_len * 4];
+            for (int k = 0; k < dfl_len * 4; k++)
+                before_dfl[k] = box_tensor[offset + k * grid_len];
+            float exp_t[dfl_len * 4];
+            const float *logits = float_row(before_dfl, dfl_len * 4, exp_t);
+            for (int k = 0; k < dfl_len * 4; k++)
+                exp_t[k] = expf(logits[k]);
+            float box[4];
+            for (int b = 0; b < 4; b++)
+                box[b] = dfl_expectation(exp_t + b * dfl_len, dfl_len);
+
+            float x1, y1, x2, y2, w, h;
+            x1 = (-box[0] + j + 0.5) * stride;
+            y1 = (-box[1] + i + 0.5) * stride;
+            x2 = (box[2] + j + 0.5) * stride;
+            y2 = (box[3] + i + 0.5) * stride;
+            w = x2 - x1;
+            h = y2 - y1;
+            boxes.push_back(x1);
+            boxes.push_back(y1);
+            boxes.push_back(w);
+            boxes.push_back(h);
+
+            objProbs.push_back(row_max[j]);
+            classId.push_back(row_cls[j]);
+            validCount++;
+        }
+    }
+    return validCount;
+}
+
+// 第i个框与同一桶内排在其后的框计算IoU, 超过阈值的标记为抑制
+// 交并比沿用原实现的 +1 像素约定; 用 inter > threshold * union 比较, 省去除法
+static void suppress_after(const float *x1, const float *y1, const float *x2, const float *y2, const float *area,
+                           int i, int n, float threshold, uint8_t *suppressed)
+{
+    int j = i + 1;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    float32x4_t ax1 = vdupq_n_f32(x1[i]), ay1 = vdupq_n_f32(y1[i]);
+    float32x4_t ax2 = vdupq_n_f32(x2[i]), ay2 = vdupq_n_f32(y2[i]);
+    float32x4_t aarea = vdupq_n_f32(area[i]), vthr = vdupq_n_f32(threshold);
+    float32x4_t one = vdupq_n_f32(1.f), zero = vdupq_n_f32(0.f);
+    for (; j + 4 <= n; j += 4) {
+        float32x4_t w = vmaxq_f32(vaddq_f32(vsubq_f32(vminq_f32(ax2, vld1q_f32(x2 + j)), vmaxq_f32(ax1, vld1q_f32(x1 + j))), one), zero);
+        float32x4_t h = vmaxq_f32(vaddq_f32(vsubq_f32(vminq_f32(ay2, vld1q_f32(y2 + j)), vmaxq_f32(ay1, vld1q_f32(y1 + j))), one), zero);
+        float32x4_t inter = vmulq_f32(w, h);
+        float32x4_t uni = vsubq_f32(vaddq_f32(aarea, vld1q_f32(area + j)), inter);
+        uint32x4_t hit = vandq_u32(vcgtq_f32(uni, zero), vcgtq_f32(inter, vmulq_f32(vthr, uni)));
+        uint32_t lanes[4];
+        vst1q_u32(lanes, hit);
+        for (int k = 0; k < 4; k++)
+            suppressed[j + k] |= lanes[k] & 1;
+    }
+#elif defined(__SSE2__)
+    __m128 ax1 = _mm_set1_ps(x1[i]), ay1 = _mm_set1_ps(y1[i]);
+    __m128 ax2 = _mm_set1_ps(x2[i]), ay2 = _mm_set1_ps(y2[i]);
+    __m128 aarea = _mm_set1_ps(area[i]), vthr = _mm_set1_ps(threshold);
+    __m128 one = _mm_set1_ps(1.f), zero = _mm_setzero_ps();
+    for (; j + 4 <= n; j += 4) {
+        __m128 w = _mm_max_ps(_mm_add_ps(_mm_sub_ps(_mm_min_ps(ax2, _mm_loadu_ps(x2 + j)), _mm_max_ps(ax1, _mm_loadu_ps(x1 + j))), one), zero);
+        __m128 h = _mm_max_ps(_mm_add_ps(_mm_sub_ps(_mm_min_ps(ay2, _mm_loadu_ps(y2 + j)), _mm_max_ps(ay1, _mm_loadu_ps(y1 + j))), one), zero);
+        __m128 inter = _mm_mul_ps(w, h);
+        __m128 uni = _mm_sub_ps(_mm_add_ps(aarea, _mm_loadu_ps(area + j)), inter);
+        int hit = _mm_movemask_ps(_mm_and_ps(_mm_cmpgt_ps(uni, zero), _mm_cmpgt_ps(inter, _mm_mul_ps(vthr, uni))));
+        for (int k = 0; k < 4; k++)
+            suppressed[j + k] |= (hit >> k) & 1;
+    }
+#endif
+    for (; j < n; j++) {
+        float w = std::max(0.f, std::min(x2[i], x2[j]) - std::max(x1[i], x1[j]) + 1.f);
+        float h = std::max(0.f, std::min(y2[i], y2[j]) - std::max(y1[i], y1[j]) + 1.f);
+        float inter = w * h;
+        float uni = area[i] + area[j] - inter;
+        suppressed[j] |= uni > 0.f && inter > threshold * uni;
+    }
+}
+
+int nms_select(post_process_buffers *buffers, int num_class, float threshold, const nms_options *opts, int max_keep)
+{
+    int count = (int)buffers->probs.size();
+    const float *boxes = buffers->boxes.data();
+    const float *probs = buffers->probs.data();
+    const int *class_ids = buffers->class_ids.data();
+    std::vector<int> &order = buffers->order;
+    std::vector<int> &start = buffers->class_start;
+    std::vector<int> &keep = buffers->keep;
+    keep.clear();
+    if (count <= 0 || max_keep <= 0)
+        return 0;
+
+    // 一次计数排序按类别分桶; class_offset 时所有候选在同一个桶里
+    int buckets = opts->class_offset ? 1 : num_class;
+    order.resize(count);
+    start.assign(buckets + 1, 0);
+    if (opts->class_offset) {
+        for (int i = 0; i < count; i++)
+            order[i] = i;
+        start[1] = count;
+    } else {
+        for (int i = 0; i < count; i++)
+            start[class_ids[i] + 1]++;
+        for (int c = 0; c < buckets; c++)
+            start[c + 1] += start[c];
+        for (int i = 0; i < count; i++)
+            order[start[class_ids[i]]++] = i;
+        // 放置后 start[c] 移到了下一个桶的起点, 整体后移一位还原
+        for (int c = buckets; c > 0; c--)
+            start[c] = start[c - 1];
+        start[0] = 0;
+    }
+
+    // class_offset 时按类别平移坐标, 平移量大于所有框坐标的跨度, 不同类别的框不会相交;
+    // 靠近画面边缘的框解码后坐标可能为负, 跨度按最小坐标计算
+    float offset = 0;
+    if (opts->class_offset) {
+        float lo = boxes[0], hi = boxes[0];
+        for (int i = 0; i < count; i++) {
+            lo = std::min(lo, std::min(boxes[i * 4 + 0], boxes[i * 4 + 1]));
+            hi = std::max(hi, std::max(boxes[i * 4 + 0] + boxes[i * 4 + 2], boxes[i * 4 + 1] + boxes[i * 4 + 3]));
+        }
+        offset = hi - lo + 1;
+    }
+
+    buffers->nms_x1.resize(count);
+    buffers->nms_y1.resize(count);
+    buffers->nms_x2.resize(count);
+    buffers->nms_y2.resize(count);
+    buffers->nms_area.resize(count);
+    buffers->suppressed.assign(count, 0);
+    float *x1 = buffers->nms_x1.data(), *y1 = buffers->nms_y1.data();
+    float *x2 = buffers->nms_x2.data(), *y2 = buffers->nms_y2.data();
+    float *area = buffers->nms_area.data();
+    uint8_t *suppressed = buffers->suppressed.data();
+
+    // 得分相同时下标小的在前, 结果与候选的产生顺序无关
+    auto by_score = [probs](int a, int b) { return probs[a] > probs[b] || (probs[a] == probs[b] && a < b); };
+    for (int b = 0; b < buckets; b++) {
+        int lo = start[b], hi = start[b + 1];
+        if (hi - lo > 1) {
+            if (opts->pre_nms_topk > 0 && hi - lo > opts->pre_nms_topk) {
+                std::nth_element(order.begin() + lo, order.begin() + lo + opts->pre_nms_topk, order.begin() + hi, by_score);
+                hi = lo + opts->pre_nms_topk;
+            }
+            std::sort(order.begin() + lo, order.begin() + hi, by_score);
+        }
+        for (int k = lo; k < hi; k++) {
+            int n = order[k];
+            float shift = offset * class_ids[n];
+            x1[k] = boxes[n * 4 + 0] + shift;
+            y1[k] = boxes[n * 4 + 1] + shift;
+            x2[k] = x1[k] + boxes[n * 4 + 2];
+            y2[k] = y1[k] + boxes[n * 4 + 3];
+            area[k] = (boxes[n * 4 + 2] + 1) * (boxes[n * 4 + 3] + 1);
+        }
+        for (int k = lo; k < hi; k++) {
+            if (suppressed[k])
+                continue;
+            keep.push_back(order[k]);
+            suppress_after(x1, y1, x2, y2, area, k, hi, threshold, suppressed);
+        }
+    }
+
+    // 各类别的结果合并后按得分降序, 只保留前 max_keep 个
+    // class_offset 时只有一个桶, 保留顺序已是得分降序
+    if (!opts->class_offset) {
+        if ((int)keep.size() > max_keep)
+            std::partial_sort(keep.begin(), keep.begin() + max_keep, keep.end(), by_score);
+        else
+            std::sort(keep.begin(), keep.end(), by_score);
+    }
+    if ((int)keep.size() > max_keep)
+        keep.resize(max_keep);
+    return (int)keep.size();
+}
+
+int post_process(Yolo11 *model_instance, rknn_output *outputs, const BOX_RECT *letter_box, object_detect_result_list *od_results, post_process_buffers *buffers,
+                 const std::vector<int> *classes, const rknn_tensor_attr *native_attrs)
 {
-    std::vector<float> filterBoxes;
-    std::vector<float> objProbs;
-    std::vector<int> classId;
+    post_process_buffers local_buffers;
+    if (buffers == nullptr)
+        buffers = &local_buffers;
+    // clear 保留容量, 复用上一帧的内存
+    std::vector<float> &filterBoxes = buffers->boxes;
+    std::vector<float> &objProbs = buffers->probs;
+    std::vector<int> &classId = buffers->class_ids;
+    filterBoxes.clear();
+    objProbs.clear();
+    classId.clear();
     int validCount = 0;
     int stride = 0;
     int grid_h = 0;
@@ -111,14 +626,36 @@ int post_process(Yolo11 *model_instance, rknn_output *outputs, BOX_RECT *letter_
     int model_in_w = model_instance->get_model_width();
     int model_in_h = model_instance->get_model_height();
     int n_output = model_instance->get_io_num_n_output();
-    bool is_quant = model_instance->get_is_quant();
+    OutputType output_type = model_instance->get_output_type();
+    const decode_config &config = model_instance->get_decode_config();
+    int num_class = model_instance->get_num_class();
     rknn_tensor_attr* output_attrs = model_instance->get_output_attrs();
 
-    memset(od_results, 0, sizeof(object_detect_result_list));
+    // 只有前 count 项有效, 不再每帧清零整个 OBJ_NUMB_MAX_SIZE 项的数组
+    od_results->count = 0;
 
     int dfl_len = output_attrs[0].dims[1] / 4;
     int output_per_branch = n_output / 3;
 
+    // 按类别的阈值, 未配置的类别使用 conf_threshold; score_sum 按其中最小的阈值过滤
+    float class_thres[num_class];
+    for (int c = 0; c < num_class; c++)
+        class_thres[c] = c < (int)config.class_thresholds.size() ? config.class_thresholds[c] : config.conf_threshold;
+
+    // 只解码允许的类别, 其他类别的分数平面不读取; 不限制类别时 classes 为nullptr,
+    // 空列表表示设置的类别都不在模型中, 没有要解码的类别
+    if (classes != nullptr && classes->empty())
+        return 0;
+    const int *class_ids = nullptr;
+    int n_ids = num_class;
+    if (classes != nullptr) {
+        class_ids = classes->data();
+        n_ids = (int)classes->size();
+    }
+    float conf_threshold = class_thres[class_ids != nullptr ? class_ids[0] : 0];
+    for (int k = 1; k < n_ids; k++)
+        conf_threshold = std::min(conf_threshold, class_thres[class_ids != nullptr ? class_ids[k] : k]);
+
     for (int i = 0; i < 3; i++)
     {
         void *score_sum = nullptr;
@@ -136,13 +673,39 @@ int post_process(Yolo11 *model_instance, rknn_output *outputs, BOX_RECT *letter_
         grid_w = output_attrs[box_idx].dims[3];
         stride = model_in_h / grid_h;
 
-        if (is_quant)
+        if (native_attrs != nullptr)
         {
+            int score_sum_c2 = output_per_branch == 3 ? native_attrs[i*output_per_branch + 2].dims[4] : 1;
+            validCount += process_i8_native((int8_t *)outputs[box_idx].buf, output_attrs[box_idx].zp, output_attrs[box_idx].scale,
+                                            model_instance->get_dfl_exp_lut(box_idx), native_attrs[box_idx].dims[4],
+                                            (int8_t *)outputs[score_idx].buf, output_attrs[score_idx].zp, output_attrs[score_idx].scale,
+                                            native_attrs[score_idx].dims[1], native_attrs[score_idx].dims[4],
+                                            (int8_t *)score_sum, score_sum_zp, score_sum_scale, score_sum_c2,
+                                            grid_h, grid_w, stride, dfl_len, num_class, class_ids, n_ids,
+                                            filterBoxes, objProbs, classId, class_thres, conf_threshold);
+            continue;
+        }
+
+        switch (output_type)
+        {
+        case OutputType::INT8:
             validCount += process_i8((int8_t *)outputs[box_idx].buf, output_attrs[box_idx].zp, output_attrs[box_idx].scale,
+                                     model_instance->get_dfl_exp_lut(box_idx),
                                      (int8_t *)outputs[score_idx].buf, output_attrs[score_idx].zp, output_attrs[score_idx].scale,
                                      (int8_t *)score_sum, score_sum_zp, score_sum_scale,
-                                     grid_h, grid_w, stride, dfl_len,
-                                     filterBoxes, objProbs, classId, conf_threshold);
+                                     grid_h, grid_w, stride, dfl_len, num_class, class_ids, n_ids,
+                                     filterBoxes, objProbs, classId, class_thres, conf_threshold);
+            break;
+        case OutputType::FP16:
+            validCount += process_float((const uint16_t *)outputs[box_idx].buf, (const uint16_t *)outputs[score_idx].buf,
+                                        (const uint16_t *)score_sum, grid_h, grid_w, stride, dfl_len, num_class, class_ids, n_ids,
+                                        filterBoxes, objProbs, classId, class_thres, conf_threshold);
+            break;
+        case OutputType::FP32:
+            validCount += process_float((const float *)outputs[box_idx].buf, (const float *)outputs[score_idx].buf,
+                                        (const float *)score_sum, grid_h, grid_w, stride, dfl_len, num_class, class_ids, n_ids,
+                                        filterBoxes, objProbs, classId, class_thres, conf_threshold);
+            break;
         }
     }
 
@@ -151,37 +714,23 @@ int post_process(Yolo11 *model_instance, rknn_output *outputs, BOX_RECT *letter_
         return 0;
     }
 
-    std::vector<int> indexArray;
-    for (int i = 0; i < validCount; ++i)
-    {
-        indexArray.push_back(i);
-    }
-    quick_sort_indice_inverse(objProbs, 0, validCount - 1, indexArray);
-
-    std::set<int> class_set(std::begin(classId), std::end(classId));
-    for (auto c : class_set)
-    {
-        nms(validCount, filterBoxes, classId, indexArray, c, nms_threshold);
-    }
+    // set_decode_config 可以在 init 之后修改, 这里再限制一次
+    int max_detections = std::max(1, std::min(config.max_detections, OBJ_NUMB_MAX_SIZE));
+    int keepCount = nms_select(buffers, num_class, config.nms_threshold, &config.nms, max_detections);
 
     int last_count = 0;
-    od_results->count = 0;
 
-    for (int i = 0; i < validCount; ++i)
+    for (int i = 0; i < keepCount; ++i)
     {
-        if (indexArray[i] == -1 || last_count >= OBJ_NUMB_MAX_SIZE)
-        {
-            continue;
-        }
-        int n = indexArray[i];
+        int n = buffers->keep[i];
 
         // ** 核心修改点：使用独立的 scale_w 和 scale_h 进行坐标还原 **
         float scale_w = letter_box->scale_w;
         float scale_h = letter_box->scale_h;
 
-        // 检测框在模型输入尺寸(e.g. 640x640)上的坐标
-        float box_x = filterBoxes[n * 4 + 0];
-        float box_y = filterBoxes[n * 4 + 1];
+        // 检测框在模型输入尺寸(e.g. 640x640)上的坐标, 先减去letterbox的填充
+        float box_x = filterBoxes[n * 4 + 0] - letter_box->left;
+        float box_y = filterBoxes[n * 4 + 1] - letter_box->top;
         float box_w = filterBoxes[n * 4 + 2];
         float box_h = filterBoxes[n * 4 + 3];
 
@@ -192,11 +741,11 @@ int post_process(Yolo11 *model_instance, rknn_output *outputs, BOX_RECT *letter_
         float y2 = (box_y + box_h) * scale_h;
 
         int id = classId[n];
-        float obj_conf = objProbs[i];
+        float obj_conf = objProbs[n];
 
-        // 使用原始图像的宽高进行clamp
-        int raw_w = model_instance->get_model_width() * scale_w;
-        int raw_h = model_instance->get_model_height() * scale_h;
+        // 使用原始图像的宽高进行clamp, 填充区域不属于原图
+        int raw_w = (int)((model_in_w - letter_box->left - letter_box->right) * scale_w + 0.5f);
+        int raw_h = (int)((model_in_h - letter_box->top - letter_box->bottom) * scale_h + 0.5f);
 
         od_results->results[last_count].box.left = (int)(clamp(x1, 0, raw_w));
         od_results->results[last_count].box.top = (int)(clamp(y1, 0, raw_h));
@@ -210,33 +759,20 @@ int post_process(Yolo11 *model_instance, rknn_output *outputs, BOX_RECT *letter_
     return 0;
 }
 
-int init_post_process()
+int load_labels(const char *path, int max_count, std::vector<std::string> &labels)
 {
-    int ret = 0;
-    ret = loadLabelName(LABEL_NALE_TXT_PATH, labels);
-    if (ret < 0)
-    {
-        printf("Load %s failed!\n", LABEL_NALE_TXT_PATH);
+    labels.clear();
+    printf("load lable %s\n", path);
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL) {
+        printf("Open %s fail!\n", path);
         return -1;
     }
-    return 0;
-}
-
-char *coco_cls_to_name(int cls_id)
-{
-    if (cls_id >= OBJ_CLASS_NUM) { return (char*)"null"; }
-    if (labels[cls_id]) { return labels[cls_id]; }
-    return (char*)"null";
-}
-
-void deinit_post_process()
-{
-    for (int i = 0; i < OBJ_CLASS_NUM; i++)
-    {
-        if (labels[i] != nullptr)
-        {
-            free(labels[i]);
-            labels[i] = nullptr;
-        }
+    char line[256];
+    while ((int)labels.size() < max_count && fgets(line, sizeof(line), fp) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        labels.push_back(line);
     }
-}
\ No newline at end of file
+    fclose(fp);
+    return (int)labels.size();
+}
@@ -9,6 +9,100 @@
 #include "opencv2/imgcodecs.hpp"
 #include "opencv2/imgproc.hpp"
 #include "postprocess.h"  // 可能是定义了 BOX_RECT 结构体的头文件
+#include "preprocess.h"
+#include <dlfcn.h>
+#include <math.h>
+#include <algorithm>
+
+/*
+ * librga 不在链接时依赖, 而是首次使用时通过 dlopen 加载:
+ * 没有librga的机器(如x86测试机)照常启动, resize_rga 返回失败后由调用方改用CPU预处理。
+ * 这里只取C接口的符号, im2d.h 中的同名宏会展开到这些 *_t 函数。
+ */
+typedef rga_buffer_t (*rga_wrap_fn)(void *vir_addr, int width, int height, int wstride, int hstride, int format);
+typedef IM_STATUS (*rga_check_fn)(const rga_buffer_t src, const rga_buffer_t dst, const rga_buffer_t pat,
+                                  const im_rect src_rect, const im_rect dst_rect, const im_rect pat_rect, const int mode_usage);
+typedef IM_STATUS (*rga_process_fn)(rga_buffer_t src, rga_buffer_t dst, rga_buffer_t pat,
+                                    im_rect srect, im_rect drect, im_rect prect, int usage);
+typedef const char *(*rga_str_error_fn)(IM_STATUS status);
+typedef IM_STATUS (*rga_fill_fn)(rga_buffer_t dst, im_rect rect, int color, int sync);
+
+struct RgaApi
+{
+    bool loaded;
+    rga_wrap_fn wrap;
+    rga_check_fn check;
+    rga_process_fn process;
+    rga_str_error_fn str_error;
+    rga_fill_fn fill; // 可选, 缺失时letterbox边框在CPU上填充
+};
+
+static RgaApi load_rga()
+{
+    RgaApi api;
+    memset(&api, 0, sizeof(api));
+    const char *names[] = {"librga.so", "librga.so.2"};
+    void *handle = NULL;
+    for (const char *name : names)
+    {
+        handle = dlopen(name, RTLD_NOW | RTLD_LOCAL);
+        if (handle != NULL)
+            break;
+    }
+    if (handle == NULL)
+    {
+        printf("librga not available (%s), using cpu preprocess (%s)\n", dlerror(), resize_cpu_isa());
+        return api;
+    }
+    api.wrap = (rga_wrap_fn)dlsym(handle, "wrapbuffer_virtualaddr_t");
+    api.check = (rga_check_fn)dlsym(handle, "imcheck_t");
+    api.process = (rga_process_fn)dlsym(handle, "improcess");
+    api.str_error = (rga_str_error_fn)dlsym(handle, "imStrError_t");
+    api.fill = (rga_fill_fn)dlsym(handle, "imfill_t");
+    if (api.wrap == NULL || api.check == NULL || api.process == NULL || api.str_error == NULL)
+    {
+        printf("librga is missing im2d symbols, using cpu preprocess (%s)\n", resize_cpu_isa());
+        dlclose(handle);
+        memset(&api, 0, sizeof(api));
+        return api;
+    }
+    api.loaded = true;
+    return api;
+}
+
+static const RgaApi &rga_api()
+{
+    // 局部静态变量的初始化是线程安全的, 多个模型同时预处理时也只加载一次
+    static const RgaApi api = load_rga();
+    return api;
+}
+
+bool rga_available()
+{
+    return rga_api().loaded;
+}
+
+/**
+ * @brief 计算letterbox的填充量和坐标还原比例
+ * @param image_size [in] 原图尺寸
+ * @param scale [in] 统一的缩放比例
+ * @param target_size [in] 最终的目标尺寸
+ * @param pads [out] 上下左右填充像素数; scale_w/scale_h 为原图与缩放后内部区域的尺寸比
+ */
+void letterbox_pads(const cv::Size &image_size, const float scale, const cv::Size &target_size, BOX_RECT &pads)
+{
+    // 与 cv::resize(fx, fy) 相同, 缩放后尺寸取四舍五入
+    int resized_w = std::min(std::max((int)lrintf(image_size.width * scale), 1), target_size.width);
+    int resized_h = std::min(std::max((int)lrintf(image_size.height * scale), 1), target_size.height);
+    int pad_width = target_size.width - resized_w;
+    int pad_height = target_size.height - resized_h;
+    pads.left = pad_width / 2;
+    pads.right = pad_width - pads.left;
+    pads.top = pad_height / 2;
+    pads.bottom = pad_height - pads.top;
+    pads.scale_w = (float)image_size.width / resized_w;
+    pads.scale_h = (float)image_size.height / resized_h;
+}
 
 /**
  * @brief 对图像进行 letterbox 处理，保持纵横比缩放并填充至目标尺寸
@@ -43,13 +137,18 @@ void letterbox(const cv::Mat &image, cv::Mat &padded_image, BOX_RECT &pads, cons
  * @brief 使用RGA硬件加速来缩放图像
  * @param src [out] 包装好的RGA源缓冲
  * @param dst [out] 包装好的RGA目标缓冲
- * @param image [in] 输入的原始OpenCV图像 (必须是RGB格式)
+ * @param image [in] 输入的原始OpenCV图像 (RGB或BGR格式, 由src_format指定)
  * @param resized_image [in/out] 用于存放缩放结果的OpenCV图像
  * @param target_size [in] 目标尺寸
+ * @param src_format [in] 源图像格式, BGR时缩放与颜色转换一起完成
  * @return int 0表示成功，-1表示失败
  */
-int resize_rga(rga_buffer_t &src, rga_buffer_t &dst, const cv::Mat &image, cv::Mat &resized_image, const cv::Size &target_size)
+int resize_rga(rga_buffer_t &src, rga_buffer_t &dst, const cv::Mat &image, cv::Mat &resized_image, const cv::Size &target_size,
+               int src_format)
 {
+    const RgaApi &rga = rga_api();
+    if (!rga.loaded)
+        return -1;
     im_rect src_rect;
     im_rect dst_rect;
     memset(&src_rect, 0, sizeof(src_rect));
@@ -66,19 +165,105 @@ int resize_rga(rga_buffer_t &src, rga_buffer_t &dst, const cv::Mat &image, cv::M
     size_t target_height = target_size.height;
 
     // 1. 将源图像的内存地址包装成RGA buffer，这是一个零拷贝操作
-    src = wrapbuffer_virtualaddr((void *)image.data, img_width, img_height, RK_FORMAT_RGB_888);
-    // 2. 将目标图像的内存地址包装成RGA buffer
-    dst = wrapbuffer_virtualaddr((void *)resized_image.data, target_width, target_height, RK_FORMAT_RGB_888);
+    src = rga.wrap((void *)image.data, img_width, img_height, img_width, img_height, src_format);
+    // 2. 将目标图像的内存地址包装成RGA buffer; 目标可能是按 w_stride 对齐的NPU输入内存, 行间距取自 step
+    dst = rga.wrap((void *)resized_image.data, target_width, target_height, resized_image.step / 3, target_height, RK_FORMAT_RGB_888);
 
     // 3. 检查RGA操作的参数是否有效
-    int ret = imcheck(src, dst, src_rect, dst_rect);
+    rga_buffer_t pat;
+    im_rect pat_rect;
+    memset(&pat, 0, sizeof(pat));
+    memset(&pat_rect, 0, sizeof(pat_rect));
+    int ret = rga.check(src, dst, pat, src_rect, dst_rect, pat_rect, 0);
     if (IM_STATUS_NOERROR != ret)
     {
-        fprintf(stderr, "rga check error! %s", imStrError((IM_STATUS)ret));
+        fprintf(stderr, "rga check error! %s", rga.str_error((IM_STATUS)ret));
         return -1;
     }
 
-    // 4. 启动RGA硬件执行图像缩放
-    IM_STATUS STATUS = imresize(src, dst);
+    // 4. 启动RGA硬件执行图像缩放; 源和目标格式不同时同一次处理中完成通道转换
+    IM_STATUS STATUS = rga.process(src, dst, pat, src_rect, dst_rect, pat_rect, IM_SYNC);
+    if (STATUS != IM_STATUS_SUCCESS)
+    {
+        fprintf(stderr, "rga process error! %s\n", rga.str_error(STATUS));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief 使用RGA一次完成letterbox: 缩放到目标图像的内部区域, 边框用 imfill 填充
+ * @param src [out] 包装好的RGA源缓冲
+ * @param dst [out] 包装好的RGA目标缓冲
+ * @param image [in] 输入的原始OpenCV图像 (RGB或BGR格式, 由src_format指定)
+ * @param padded_image [in/out] 已分配为目标尺寸的输出图像(RGB888)
+ * @param pads [out] 填充量和坐标还原比例, 见 letterbox_pads
+ * @param scale [in] 统一的缩放比例
+ * @param target_size [in] 目标尺寸
+ * @param src_format [in] 源图像格式, BGR时缩放与颜色转换一起完成
+ * @param pad_color [in] 填充颜色, 按RGB顺序给出
+ * @return int 0表示成功，-1表示失败
+ */
+int letterbox_rga(rga_buffer_t &src, rga_buffer_t &dst, const cv::Mat &image, cv::Mat &padded_image, BOX_RECT &pads,
+                  const float scale, const cv::Size &target_size, int src_format, const cv::Scalar &pad_color)
+{
+    const RgaApi &rga = rga_api();
+    if (!rga.loaded)
+        return -1;
+    if (image.type() != CV_8UC3)
+    {
+        printf("source image type is %d!\n", image.type());
+        return -1;
+    }
+    letterbox_pads(image.size(), scale, target_size, pads);
+    int resized_w = target_size.width - pads.left - pads.right;
+    int resized_h = target_size.height - pads.top - pads.bottom;
+
+    src = rga.wrap((void *)image.data, image.cols, image.rows, image.cols, image.rows, src_format);
+    dst = rga.wrap((void *)padded_image.data, target_size.width, target_size.height, padded_image.step / 3, target_size.height,
+                   RK_FORMAT_RGB_888);
+
+    rga_buffer_t pat;
+    im_rect src_rect, dst_rect, pat_rect;
+    memset(&pat, 0, sizeof(pat));
+    memset(&pat_rect, 0, sizeof(pat_rect));
+    src_rect.x = 0;
+    src_rect.y = 0;
+    src_rect.width = image.cols;
+    src_rect.height = image.rows;
+    dst_rect.x = pads.left;
+    dst_rect.y = pads.top;
+    dst_rect.width = resized_w;
+    dst_rect.height = resized_h;
+    int ret = rga.check(src, dst, pat, src_rect, dst_rect, pat_rect, 0);
+    if (IM_STATUS_NOERROR != ret)
+    {
+        fprintf(stderr, "rga check error! %s", rga.str_error((IM_STATUS)ret));
+        return -1;
+    }
+
+    // 边框: 上下两条整行, 左右两块只覆盖内部区域的行; 内部区域由缩放结果写入
+    im_rect borders[4];
+    borders[0] = {0, 0, target_size.width, pads.top};
+    borders[1] = {0, pads.top + resized_h, target_size.width, pads.bottom};
+    borders[2] = {0, pads.top, pads.left, resized_h};
+    borders[3] = {pads.left + resized_w, pads.top, pads.right, resized_h};
+    // imfill 的颜色按 0xAABBGGRR 打包
+    int color = (0xff << 24) | (cv::saturate_cast<uchar>(pad_color[2]) << 16) |
+                (cv::saturate_cast<uchar>(pad_color[1]) << 8) | cv::saturate_cast<uchar>(pad_color[0]);
+    for (const im_rect &border : borders)
+    {
+        if (border.width <= 0 || border.height <= 0)
+            continue;
+        if (rga.fill == NULL || rga.fill(dst, border, color, 1) != IM_STATUS_SUCCESS)
+            padded_image(cv::Rect(border.x, border.y, border.width, border.height)).setTo(pad_color);
+    }
+
+    IM_STATUS STATUS = rga.process(src, dst, pat, src_rect, dst_rect, pat_rect, IM_SYNC);
+    if (STATUS != IM_STATUS_SUCCESS)
+    {
+        fprintf(stderr, "rga process error! %s\n", rga.str_error(STATUS));
+        return -1;
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,269 @@
+// CPU预处理: 双线性缩放、letterbox填充与通道交换一次完成, 用于没有librga或RGA失败的情况
+// 水平方向逐像素插值(同时交换通道)得到16位中间行, 垂直方向用 NEON/SSE2/AVX2 向量化混合
+// x86上AVX2版本在运行时按CPU支持情况选择, 不需要额外的编译选项
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include "preprocess.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RESIZE_CPU_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define RESIZE_CPU_SSE2 1
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define RESIZE_CPU_AVX2 1
+#endif
+#endif
+
+// 插值权重的定点位数: 水平结果最大 255 * 128, 可放进 int16; 垂直混合后右移 2 * 7 位
+#define RESIZE_COEF_BITS 7
+#define RESIZE_COEF_ONE (1 << RESIZE_COEF_BITS)
+#define RESIZE_ROUND (1 << (2 * RESIZE_COEF_BITS - 1))
+
+// 与 cv::resize(INTER_LINEAR) 相同的半像素中心映射, 返回左侧源坐标和右侧权重
+static inline void map_coord(int d, float scale, int src_len, int *s0, int *s1, int *w1)
+{
+    float f = (d + 0.5f) * scale - 0.5f;
+    int s = (int)floorf(f);
+    float a = f - s;
+    if (s < 0) {
+        s = 0;
+        a = 0;
+    }
+    if (s >= src_len - 1) {
+        s = src_len - 1;
+        a = 0;
+    }
+    *s0 = s;
+    *s1 = s + 1 < src_len ? s + 1 : s;
+    *w1 = (int)(a * RESIZE_COEF_ONE + 0.5f);
+}
+
+// 水平插值一行; swap_rb 为true时输出 RGB, 否则保持源通道顺序
+template <bool swap_rb>
+static void horizontal_pass(const uint8_t *src, int16_t *row, int dst_w, const int *x0, const int *x1, const int16_t *wx)
+{
+    const int c0 = swap_rb ? 2 : 0;
+    const int c2 = swap_rb ? 0 : 2;
+    for (int x = 0; x < dst_w; x++) {
+        const uint8_t *p0 = src + x0[x];
+        const uint8_t *p1 = src + x1[x];
+        int a = wx[x];
+        int b = RESIZE_COEF_ONE - a;
+        row[x * 3 + 0] = (int16_t)(p0[c0] * b + p1[c0] * a);
+        row[x * 3 + 1] = (int16_t)(p0[1] * b + p1[1] * a);
+        row[x * 3 + 2] = (int16_t)(p0[c2] * b + p1[c2] * a);
+    }
+}
+
+static inline void vertical_tail(const int16_t *r0, const int16_t *r1, uint8_t *dst, int i, int n, int w0, int w1)
+{
+    for (; i < n; i++)
+        dst[i] = (uint8_t)((r0[i] * w0 + r1[i] * w1 + RESIZE_ROUND) >> (2 * RESIZE_COEF_BITS));
+}
+
+// 垂直混合两行: dst = (r0 * (1 - w) + r1 * w) >> 14, 四舍五入
+static void vertical_blend(const int16_t *r0, const int16_t *r1, uint8_t *dst, int n, int w1)
+{
+    int w0 = RESIZE_COEF_ONE - w1;
+    int i = 0;
+#if defined(RESIZE_CPU_NEON)
+    uint16x4_t vw0 = vdup_n_u16((uint16_t)w0);
+    uint16x4_t vw1 = vdup_n_u16((uint16_t)w1);
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t a = vreinterpretq_u16_s16(vld1q_s16(r0 + i));
+        uint16x8_t b = vreinterpretq_u16_s16(vld1q_s16(r1 + i));
+        uint32x4_t lo = vmlal_u16(vmull_u16(vget_low_u16(a), vw0), vget_low_u16(b), vw1);
+        uint32x4_t hi = vmlal_u16(vmull_u16(vget_high_u16(a), vw0), vget_high_u16(b), vw1);
+        uint16x8_t v = vcombine_u16(vrshrn_n_u32(lo, 2 * RESIZE_COEF_BITS), vrshrn_n_u32(hi, 2 * RESIZE_COEF_BITS));
+        vst1_u8(dst + i, vqmovn_u16(v));
+    }
+#elif defined(RESIZE_CPU_SSE2)
+    // 交错两行后用 madd 一次算出 r0 * w0 + r1 * w1 (32位)
+    __m128i w = _mm_set1_epi32((w1 << 16) | w0);
+    __m128i round = _mm_set1_epi32(RESIZE_ROUND);
+    for (; i + 16 <= n; i += 16) {
+        __m128i a0 = _mm_loadu_si128((const __m128i *)(r0 + i));
+        __m128i b0 = _mm_loadu_si128((const __m128i *)(r1 + i));
+        __m128i a1 = _mm_loadu_si128((const __m128i *)(r0 + i + 8));
+        __m128i b1 = _mm_loadu_si128((const __m128i *)(r1 + i + 8));
+        __m128i s0 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a0, b0), w), round), 2 * RESIZE_COEF_BITS);
+        __m128i s1 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a0, b0), w), round), 2 * RESIZE_COEF_BITS);
+        __m128i s2 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a1, b1), w), round), 2 * RESIZE_COEF_BITS);
+        __m128i s3 = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a1, b1), w), round), 2 * RESIZE_COEF_BITS);
+        __m128i v = _mm_packus_epi16(_mm_packs_epi32(s0, s1), _mm_packs_epi32(s2, s3));
+        _mm_storeu_si128((__m128i *)(dst + i), v);
+    }
+#endif
+    vertical_tail(r0, r1, dst, i, n, w0, w1);
+}
+
+#if defined(RESIZE_CPU_AVX2)
+// 与SSE2版本相同的计算, 每次处理32个值; unpack/pack 按128位分道进行, 最后用 permute 恢复顺序
+__attribute__((target("avx2"))) static void vertical_blend_avx2(const int16_t *r0, const int16_t *r1, uint8_t *dst, int n, int w1)
+{
+    int w0 = RESIZE_COEF_ONE - w1;
+    int i = 0;
+    __m256i w = _mm256_set1_epi32((w1 << 16) | w0);
+    __m256i round = _mm256_set1_epi32(RESIZE_ROUND);
+    for (; i + 32 <= n; i += 32) {
+        __m256i a0 = _mm256_loadu_si256((const __m256i *)(r0 + i));
+        __m256i b0 = _mm256_loadu_si256((const __m256i *)(r1 + i));
+        __m256i a1 = _mm256_loadu_si256((const __m256i *)(r0 + i + 16));
+        __m256i b1 = _mm256_loadu_si256((const __m256i *)(r1 + i + 16));
+        __m256i s0 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(a0, b0), w), round), 2 * RESIZE_COEF_BITS);
+        __m256i s1 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(a0, b0), w), round), 2 * RESIZE_COEF_BITS);
+        __m256i s2 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(a1, b1), w), round), 2 * RESIZE_COEF_BITS);
+        __m256i s3 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(a1, b1), w), round), 2 * RESIZE_COEF_BITS);
+        __m256i v = _mm256_packus_epi16(_mm256_packs_epi32(s0, s1), _mm256_packs_epi32(s2, s3));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_permute4x64_epi64(v, 0xD8));
+    }
+    vertical_tail(r0, r1, dst, i, n, w0, w1);
+}
+#endif
+
+typedef void (*vertical_blend_fn)(const int16_t *, const int16_t *, uint8_t *, int, int);
+
+struct VerticalKernel
+{
+    vertical_blend_fn fn;
+    const char *name;
+};
+
+static VerticalKernel select_vertical_kernel()
+{
+#if defined(RESIZE_CPU_AVX2)
+    if (__builtin_cpu_supports("avx2"))
+        return {vertical_blend_avx2, "avx2"};
+#endif
+#if defined(RESIZE_CPU_NEON)
+    return {vertical_blend, "neon"};
+#elif defined(RESIZE_CPU_SSE2)
+    return {vertical_blend, "sse2"};
+#else
+    return {vertical_blend, "scalar"};
+#endif
+}
+
+static const VerticalKernel &vertical_kernel()
+{
+    static const VerticalKernel kernel = select_vertical_kernel();
+    return kernel;
+}
+
+const char *resize_cpu_isa()
+{
+    return vertical_kernel().name;
+}
+
+// 将整幅源图缩放到 dst 的 roi 区域, roi 以外的像素不修改
+template <bool swap_rb>
+static void resize_into(const cv::Mat &image, cv::Mat &dst, const cv::Rect &roi)
+{
+    int src_w = image.cols, src_h = image.rows;
+    int dst_w = roi.width, dst_h = roi.height;
+    vertical_blend_fn blend = vertical_kernel().fn;
+
+    // 坐标表和中间行放在栈上, 每帧不分配堆内存
+    int x0[dst_w], x1[dst_w];
+    int16_t wx[dst_w];
+    float scale_x = (float)src_w / dst_w;
+    float scale_y = (float)src_h / dst_h;
+    for (int x = 0; x < dst_w; x++) {
+        int s0, s1, w;
+        map_coord(x, scale_x, src_w, &s0, &s1, &w);
+        x0[x] = s0 * 3;
+        x1[x] = s1 * 3;
+        wx[x] = (int16_t)w;
+    }
+
+    int16_t rows[2][dst_w * 3];
+    int16_t *row0 = rows[0], *row1 = rows[1];
+    int cached0 = -1, cached1 = -1; // row0/row1 当前对应的源行
+    for (int y = 0; y < dst_h; y++) {
+        int sy0, sy1, wy;
+        map_coord(y, scale_y, src_h, &sy0, &sy1, &wy);
+        // 缩小时相邻输出行常共用源行, 复用已算好的水平插值结果
+        if (sy0 == cached1) {
+            int16_t *t = row0;
+            row0 = row1;
+            row1 = t;
+            cached0 = cached1;
+            cached1 = -1;
+        }
+        if (sy0 != cached0) {
+            horizontal_pass<swap_rb>(image.ptr<uint8_t>(sy0), row0, dst_w, x0, x1, wx);
+            cached0 = sy0;
+        }
+        if (sy1 != cached1) {
+            if (sy1 == sy0)
+                memcpy(row1, row0, sizeof(int16_t) * dst_w * 3);
+            else
+                horizontal_pass<swap_rb>(image.ptr<uint8_t>(sy1), row1, dst_w, x0, x1, wx);
+            cached1 = sy1;
+        }
+        blend(row0, row1, dst.ptr<uint8_t>(roi.y + y) + roi.x * 3, dst_w * 3, wy);
+    }
+}
+
+// 用纯色填充 [x, x + w) 列范围内的 [y0, y1) 行
+static void fill_rect(cv::Mat &dst, int x, int w, int y0, int y1, const uint8_t color[3])
+{
+    if (w <= 0)
+        return;
+    for (int y = y0; y < y1; y++) {
+        uint8_t *p = dst.ptr<uint8_t>(y) + x * 3;
+        for (int i = 0; i < w; i++, p += 3) {
+            p[0] = color[0];
+            p[1] = color[1];
+            p[2] = color[2];
+        }
+    }
+}
+
+int resize_bgr2rgb_cpu(const cv::Mat &image, cv::Mat &resized_image, const cv::Size &target_size)
+{
+    if (image.type() != CV_8UC3 || image.empty() || target_size.width <= 0 || target_size.height <= 0)
+    {
+        printf("source image type is %d!\n", image.type());
+        return -1;
+    }
+    resized_image.create(target_size.height, target_size.width, CV_8UC3);
+    resize_into<true>(image, resized_image, cv::Rect(0, 0, target_size.width, target_size.height));
+    return 0;
+}
+
+int letterbox_cpu(const cv::Mat &image, cv::Mat &padded_image, BOX_RECT &pads, const float scale, const cv::Size &target_size,
+                  const cv::Scalar &pad_color, bool bgr2rgb)
+{
+    if (image.type() != CV_8UC3 || image.empty() || target_size.width <= 0 || target_size.height <= 0)
+    {
+        printf("source image type is %d!\n", image.type());
+        return -1;
+    }
+    letterbox_pads(image.size(), scale, target_size, pads);
+    int resized_w = target_size.width - pads.left - pads.right;
+    int resized_h = target_size.height - pads.top - pads.bottom;
+
+    padded_image.create(target_size.height, target_size.width, CV_8UC3);
+    // 只填充边框, 内部区域由缩放结果直接写入
+    uint8_t color[3];
+    for (int c = 0; c < 3; c++)
+        color[c] = cv::saturate_cast<uint8_t>(pad_color[c]);
+    fill_rect(padded_image, 0, target_size.width, 0, pads.top, color);
+    fill_rect(padded_image, 0, target_size.width, pads.top + resized_h, target_size.height, color);
+    fill_rect(padded_image, 0, pads.left, pads.top, pads.top + resized_h, color);
+    fill_rect(padded_image, pads.left + resized_w, pads.right, pads.top, pads.top + resized_h, color);
+
+    cv::Rect roi(pads.left, pads.top, resized_w, resized_h);
+    if (bgr2rgb)
+        resize_into<true>(image, padded_image, roi);
+    else
+        resize_into<false>(image, padded_image, roi);
+    return 0;
+}
@@ -138,24 +138,16 @@ int rkYolov5s::init(rknn_context *ctx_in, bool share_weight)
     }
 
     // 设置此上下文需要绑定的NPU核心
-    rknn_core_mask core_mask;
-    switch (get_core_num()) // get_core_num() 是一个外部函数，用于决定使用哪个核心
+    // 检测NPU核心数, 各上下文依次绑定到不同的核心; 单核平台不支持设置核心
+    int cores = get_npu_core_num(ctx);
+    if (cores > 1)
     {
-    case 0:
-        core_mask = RKNN_NPU_CORE_0;
-        break;
-    case 1:
-        core_mask = RKNN_NPU_CORE_1;
-        break;
-    case 2:
-        core_mask = RKNN_NPU_CORE_2;
-        break;
-    }
-    ret = rknn_set_core_mask(ctx, core_mask);
-    if (ret < 0)
-    {
-        printf("rknn_init core error ret=%d\n", ret);
-        return -1;
+        ret = rknn_set_core_mask(ctx, get_core_mask(rknnCoreStrategy::SINGLE, get_core_num(cores), cores, RKNN_NPU_CORE_AUTO));
+        if (ret < 0)
+        {
+            printf("rknn_init core error ret=%d\n", ret);
+            return -1;
+        }
     }
 
     // 查询并打印SDK和驱动版本信息
@@ -239,9 +231,8 @@ cv::Mat rkYolov5s::infer(cv::Mat &orig_img)
 {
     // 使用 lock_guard 保证此函数在多线程环境下的线程安全
     std::lock_guard<std::mutex> lock(mtx);
-    cv::Mat img;
-    // 将OpenCV的BGR图像转换为RGB
-    cv::cvtColor(orig_img, img, cv::COLOR_BGR2RGB);
+    // BGR->RGB 在缩放时由RGA一并完成, 不再对整帧做 cvtColor
+    cv::Mat img = orig_img;
     img_width = img.cols;
     img_height = img.rows;
 
@@ -262,7 +253,7 @@ cv::Mat rkYolov5s::infer(cv::Mat &orig_img)
         rga_buffer_t dst;
         memset(&src, 0, sizeof(src));
         memset(&dst, 0, sizeof(dst));
-        ret = resize_rga(src, dst, img, resized_img, target_size);
+        ret = resize_rga(src, dst, img, resized_img, target_size, RK_FORMAT_BGR_888);
         if (ret != 0)
         {
             fprintf(stderr, "resize with rga error\n");
@@ -279,8 +270,9 @@ cv::Mat rkYolov5s::infer(cv::Mat &orig_img)
     }
     else
     {
-        // 如果尺寸相同，直接使用原始图像数据
-        inputs[0].buf = img.data;
+        // 如果尺寸相同，只需交换通道
+        cv::cvtColor(img, resized_img, cv::COLOR_BGR2RGB);
+        inputs[0].buf = resized_img.data;
     }
 
     // 将输入数据设置到RKNN上下文
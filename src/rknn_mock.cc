@@ -0,0 +1,959 @@
+// librknnrt 的软件替身, 说明见 include/rknn_mock.h
+
+#include "rknn_api.h"
+#include "rknn_mock.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // 模型描述, 由 rknn_init 创建, 被 rknn_dup_context 得到的上下文共享
+    struct MockModel
+    {
+        std::vector<rknn_tensor_attr> inputs;
+        std::vector<rknn_tensor_attr> outputs;
+        std::vector<std::vector<int8_t>> data; // 每个输出一份回放数据
+        std::vector<rknn_tensor_attr> native_outputs;     // NPU原生的 NC1HWC2 布局
+        std::vector<std::vector<int8_t>> native_data;     // data 按原生布局重排, 补齐的通道为0分
+    };
+
+    // 绑定的输出内存的写入方式
+    enum OutputBind : uint8_t
+    {
+        BIND_NCHW,   // 运行时从原生布局转换为 NCHW
+        BIND_NATIVE, // NPU直接写入原生布局
+        BIND_FLOAT   // 转换为 NCHW 并反量化为 float32
+    };
+
+    // 一次推理使用的输出内存, 提交时从上下文的绑定拷贝, 之后重新绑定不影响已提交的帧
+    struct MockJob
+    {
+        std::vector<rknn_tensor_mem *> output_mems;
+        std::vector<uint8_t> output_bind;
+    };
+
+    struct MockContext
+    {
+        std::shared_ptr<MockModel> model;
+        std::atomic<int> core_mask{RKNN_NPU_CORE_AUTO}; // 推理中也可以被 rknn_set_core_mask 修改, 对之后执行的帧生效
+        std::vector<uint8_t> input;            // rknn_inputs_set 拷贝进来的输入
+        rknn_tensor_mem *input_mem = nullptr;  // rknn_set_io_mem 绑定的输入, 推理时直接读取
+        std::vector<rknn_tensor_mem *> output_mems; // rknn_set_io_mem 绑定的输出, 推理时直接写入
+        std::vector<uint8_t> output_bind;      // 各输出的 OutputBind
+        std::atomic<int64_t> last_run_us{0}; // 最近完成的一帧的执行时间, 异步推理时由工作线程写入
+
+        // rknn_init 带 RKNN_FLAG_ASYNC_MASK 时 rknn_run 可以不阻塞(non_block), 提交的帧按顺序由工作线程执行
+        bool async = false;
+        std::mutex job_mtx;
+        std::condition_variable job_cv;
+        std::thread worker;
+        bool stop = false;
+        MockJob jobs[RKNN_MOCK_MAX_INFLIGHT]; // 第 id 帧使用 jobs[id % RKNN_MOCK_MAX_INFLIGHT]
+        uint64_t submitted = 0;               // 最后提交的帧号, 从1开始
+        uint64_t completed = 0;               // 最后完成的帧号
+    };
+
+    struct MockCore
+    {
+        std::mutex mtx;                        // 一个核心同一时刻只执行一个任务
+        std::atomic<int> pending{0};           // 正在等待或执行的任务数, 供 AUTO 模式选核
+        std::atomic<uint64_t> runs{0};
+        std::atomic<uint64_t> busy_us{0};
+        std::atomic<int> latency_us{20000};
+    };
+
+    MockCore g_cores[RKNN_MOCK_MAX_CORES];
+    int g_core_count = RKNN_MOCK_MAX_CORES; // 模拟的核心数, 见 RKNN_MOCK_CORES
+    bool g_late_binding = false;            // 见 RKNN_MOCK_LATE_BINDING
+    std::atomic<uint64_t> g_runs{0};
+    std::atomic<uint64_t> g_input_copy_bytes{0};
+    std::atomic<uint64_t> g_output_copy_bytes{0};
+    std::atomic<uint64_t> g_input_checksum{0};
+    std::once_flag g_env_once;
+
+    void load_env()
+    {
+        const char *count = getenv("RKNN_MOCK_CORES");
+        if (count != NULL)
+            g_core_count = std::max(1, std::min(RKNN_MOCK_MAX_CORES, atoi(count)));
+        const char *late = getenv("RKNN_MOCK_LATE_BINDING");
+        g_late_binding = late != NULL && atoi(late) != 0;
+        const char *lat = getenv("RKNN_MOCK_CORE_LATENCY_US");
+        if (lat == NULL)
+            return;
+        std::vector<int> values;
+        std::string s(lat);
+        size_t pos = 0;
+        while (pos <= s.size())
+        {
+            size_t next = s.find(',', pos);
+            if (next == std::string::npos)
+                next = s.size();
+            if (next > pos)
+                values.push_back(atoi(s.substr(pos, next - pos).c_str()));
+            pos = next + 1;
+        }
+        // 未给出的核心沿用最后一个值, 只给一个值即所有核心相同
+        for (int i = 0; i < RKNN_MOCK_MAX_CORES && !values.empty(); i++)
+            g_cores[i].latency_us = values[std::min<size_t>(i, values.size() - 1)];
+    }
+
+    MockContext *to_ctx(rknn_context context)
+    {
+        return reinterpret_cast<MockContext *>(static_cast<uintptr_t>(context));
+    }
+
+    uint32_t type_size(rknn_tensor_type type)
+    {
+        switch (type)
+        {
+        case RKNN_TENSOR_FLOAT32:
+        case RKNN_TENSOR_INT32:
+        case RKNN_TENSOR_UINT32:
+            return 4;
+        case RKNN_TENSOR_FLOAT16:
+        case RKNN_TENSOR_INT16:
+        case RKNN_TENSOR_UINT16:
+            return 2;
+        case RKNN_TENSOR_INT64:
+            return 8;
+        default:
+            return 1;
+        }
+    }
+
+    rknn_tensor_attr make_attr(uint32_t index, uint32_t d0, uint32_t d1, uint32_t d2, uint32_t d3,
+                               rknn_tensor_format fmt, rknn_tensor_type type, rknn_tensor_qnt_type qnt,
+                               int32_t zp, float scale)
+    {
+        rknn_tensor_attr a;
+        memset(&a, 0, sizeof(a));
+        a.index = index;
+        a.n_dims = 4;
+        a.dims[0] = d0;
+        a.dims[1] = d1;
+        a.dims[2] = d2;
+        a.dims[3] = d3;
+        a.n_elems = d0 * d1 * d2 * d3;
+        a.fmt = fmt;
+        a.type = type;
+        a.qnt_type = qnt;
+        a.zp = zp;
+        a.scale = scale;
+        a.size = a.n_elems * type_size(type);
+        a.size_with_stride = a.size;
+        a.w_stride = fmt == RKNN_TENSOR_NHWC ? d2 : d3;
+        snprintf(a.name, sizeof(a.name), "mock_%u", index);
+        return a;
+    }
+
+    // 简单的线性同余发生器, 保证合成数据在不同机器上一致
+    uint32_t lcg(uint32_t &state)
+    {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    }
+
+    int8_t quant(float v, int32_t zp, float scale)
+    {
+        float q = roundf(v / scale) + zp;
+        return (int8_t)(q < -128 ? -128 : (q > 127 ? 127 : q));
+    }
+
+    // 单精度转半精度, 就近舍入到偶数; 合成数据的取值范围内不会溢出
+    uint16_t float_to_half(float f)
+    {
+        uint32_t x;
+        memcpy(&x, &f, sizeof(x));
+        uint32_t sign = (x >> 16) & 0x8000;
+        int32_t exp = (int32_t)((x >> 23) & 0xff) - 127 + 15;
+        uint32_t mant = x & 0x7fffff;
+        if (exp >= 31)
+            return (uint16_t)(sign | 0x7c00);
+        if (exp <= 0)
+        {
+            if (exp < -10)
+                return (uint16_t)sign;
+            // 非规格化数
+            mant |= 0x800000;
+            uint32_t shift = 14 - exp;
+            uint32_t h = mant >> shift;
+            uint32_t rem = mant & ((1u << shift) - 1), half = 1u << (shift - 1);
+            if (rem > half || (rem == half && (h & 1)))
+                h++;
+            return (uint16_t)(sign | h);
+        }
+        uint32_t h = sign | ((uint32_t)exp << 10) | (mant >> 13);
+        uint32_t rem = mant & 0x1fff;
+        if (rem > 0x1000 || (rem == 0x1000 && (h & 1)))
+            h++; // 进位可能进到指数, 结果仍正确
+        return (uint16_t)h;
+    }
+
+    float half_to_float(uint16_t h)
+    {
+        uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+        uint32_t exp = (h >> 10) & 0x1f;
+        uint32_t mant = h & 0x3ff;
+        float f;
+        if (exp == 0)
+            f = ldexpf((float)mant, -24);
+        else if (exp == 31)
+            f = mant ? NAN : INFINITY;
+        else
+            f = ldexpf((float)(mant | 0x400), (int)exp - 25);
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        bits |= sign;
+        memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    // 第k个元素的float值
+    float element(const rknn_tensor_attr &attr, const std::vector<int8_t> &data, uint32_t k)
+    {
+        switch (attr.type)
+        {
+        case RKNN_TENSOR_FLOAT32:
+            return ((const float *)data.data())[k];
+        case RKNN_TENSOR_FLOAT16:
+            return half_to_float(((const uint16_t *)data.data())[k]);
+        default:
+            return ((float)data[k] - attr.zp) * attr.scale;
+        }
+    }
+
+    // 把量化的合成输出改为非量化的 fp16/fp32 输出, 数值为反量化结果, 模拟混合精度导出的模型
+    void convert_synthetic(MockModel &m, rknn_tensor_type type)
+    {
+        for (size_t i = 0; i < m.outputs.size(); i++)
+        {
+            rknn_tensor_attr &a = m.outputs[i];
+            std::vector<int8_t> raw(a.n_elems * type_size(type));
+            for (uint32_t k = 0; k < a.n_elems; k++)
+            {
+                float v = ((float)m.data[i][k] - a.zp) * a.scale;
+                if (type == RKNN_TENSOR_FLOAT16)
+                    ((uint16_t *)raw.data())[k] = float_to_half(v);
+                else
+                    ((float *)raw.data())[k] = v;
+            }
+            a = make_attr(a.index, a.dims[0], a.dims[1], a.dims[2], a.dims[3], a.fmt, type, RKNN_TENSOR_QNT_NONE, 0, 1.f);
+            m.data[i].swap(raw);
+        }
+    }
+
+    // 合成 YOLO11 (640x640, 默认80类, 每个分支 box/score/score_sum 三个输出) 的量化输出
+    void build_synthetic(MockModel &m)
+    {
+        const int strides[3] = {8, 16, 32};
+        int classes = 80;
+        const int dfl_len = 16;
+        if (getenv("RKNN_MOCK_CLASSES") != NULL)
+            classes = std::max(1, atoi(getenv("RKNN_MOCK_CLASSES")));
+        float density = 0.002f;
+        if (getenv("RKNN_MOCK_DENSITY") != NULL)
+            density = atof(getenv("RKNN_MOCK_DENSITY"));
+
+        m.inputs.push_back(make_attr(0, 1, 640, 640, 3, RKNN_TENSOR_NHWC, RKNN_TENSOR_UINT8, RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC, 0, 1.f));
+        // 模拟宽度按硬件要求对齐的输入, 零拷贝输入的每行之间有填充
+        if (getenv("RKNN_MOCK_INPUT_W_STRIDE") != NULL)
+        {
+            rknn_tensor_attr &in = m.inputs[0];
+            in.w_stride = std::max<uint32_t>(in.dims[2], atoi(getenv("RKNN_MOCK_INPUT_W_STRIDE")));
+            in.size_with_stride = in.dims[1] * in.w_stride * in.dims[3];
+        }
+        for (int b = 0; b < 3; b++)
+        {
+            uint32_t g = 640 / strides[b];
+            m.outputs.push_back(make_attr(b * 3 + 0, 1, 4 * dfl_len, g, g, RKNN_TENSOR_NCHW, RKNN_TENSOR_INT8, RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC, -20, 0.1f));
+            m.outputs.push_back(make_attr(b * 3 + 1, 1, classes, g, g, RKNN_TENSOR_NCHW, RKNN_TENSOR_INT8, RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC, -128, 1.f / 255));
+            m.outputs.push_back(make_attr(b * 3 + 2, 1, 1, g, g, RKNN_TENSOR_NCHW, RKNN_TENSOR_INT8, RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC, -128, 1.f / 255));
+        }
+
+        uint32_t seed = 12345;
+        for (int b = 0; b < 3; b++)
+        {
+            const rknn_tensor_attr &box = m.outputs[b * 3 + 0];
+            const rknn_tensor_attr &score = m.outputs[b * 3 + 1];
+            const rknn_tensor_attr &sum = m.outputs[b * 3 + 2];
+            int grid_len = box.dims[2] * box.dims[3];
+            std::vector<int8_t> box_data(box.n_elems, quant(0.f, box.zp, box.scale));
+            std::vector<int8_t> score_data(score.n_elems);
+            std::vector<int8_t> sum_data(sum.n_elems);
+
+            for (int cell = 0; cell < grid_len; cell++)
+            {
+                float cell_sum = 0.f;
+                for (int c = 0; c < classes; c++)
+                {
+                    // 背景网格的类别分数落在 [0, 0.003), 所有类别之和仍低于默认阈值
+                    float p = (lcg(seed) % 1000) / 1000.f * 0.003f;
+                    score_data[c * grid_len + cell] = quant(p, score.zp, score.scale);
+                    cell_sum += p;
+                }
+                if ((lcg(seed) % 100000) < density * 100000)
+                {
+                    int cls = lcg(seed) % classes;
+                    float p = 0.3f + (lcg(seed) % 650) / 1000.f;
+                    score_data[cls * grid_len + cell] = quant(p, score.zp, score.scale);
+                    cell_sum += p;
+                    // 四条边各自在一个 bin 上取峰值, 得到尺寸不一的框
+                    for (int side = 0; side < 4; side++)
+                    {
+                        int peak = 1 + lcg(seed) % 6;
+                        for (int k = 0; k < dfl_len; k++)
+                        {
+                            float logit = k == peak ? 8.f : (abs(k - peak) == 1 ? 5.f : 0.f);
+                            box_data[(side * dfl_len + k) * grid_len + cell] = quant(logit, box.zp, box.scale);
+                        }
+                    }
+                }
+                sum_data[cell] = quant(cell_sum > 1.f ? 1.f : cell_sum, sum.zp, sum.scale);
+            }
+            m.data.push_back(std::move(box_data));
+            m.data.push_back(std::move(score_data));
+            m.data.push_back(std::move(sum_data));
+        }
+
+        const char *type = getenv("RKNN_MOCK_OUTPUT_TYPE");
+        if (type != NULL && strcmp(type, "fp16") == 0)
+            convert_synthetic(m, RKNN_TENSOR_FLOAT16);
+        else if (type != NULL && strcmp(type, "fp32") == 0)
+            convert_synthetic(m, RKNN_TENSOR_FLOAT32);
+    }
+
+    // 读取 rknn_mock_dump_outputs 录制的目录
+    int load_recorded(MockModel &m, const char *dir)
+    {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", dir, RKNN_MOCK_TENSOR_DESC);
+        FILE *fp = fopen(path, "r");
+        if (fp == NULL)
+        {
+            printf("rknn mock: open %s fail!\n", path);
+            return -1;
+        }
+        char kind[8];
+        uint32_t index, n_dims, d[4];
+        int fmt, type, qnt, zp;
+        float scale;
+        while (fscanf(fp, "%7s %u %u %u %u %u %u %d %d %d %d %f", kind, &index, &n_dims, &d[0], &d[1], &d[2], &d[3],
+                      &fmt, &type, &qnt, &zp, &scale) == 12)
+        {
+            rknn_tensor_attr a = make_attr(index, d[0], d[1], d[2], d[3], (rknn_tensor_format)fmt,
+                                           (rknn_tensor_type)type, (rknn_tensor_qnt_type)qnt, zp, scale);
+            a.n_dims = n_dims;
+            if (strcmp(kind, "in") == 0)
+                m.inputs.push_back(a);
+            else
+                m.outputs.push_back(a);
+        }
+        fclose(fp);
+
+        for (size_t i = 0; i < m.outputs.size(); i++)
+        {
+            snprintf(path, sizeof(path), "%s/output_%zu.bin", dir, i);
+            fp = fopen(path, "rb");
+            if (fp == NULL)
+            {
+                printf("rknn mock: open %s fail!\n", path);
+                return -1;
+            }
+            std::vector<int8_t> buf(m.outputs[i].size);
+            size_t n = fread(buf.data(), 1, buf.size(), fp);
+            fclose(fp);
+            if (n != buf.size())
+            {
+                printf("rknn mock: %s is truncated\n", path);
+                return -1;
+            }
+            m.data.push_back(std::move(buf));
+        }
+        return m.inputs.empty() || m.outputs.empty() ? -1 : 0;
+    }
+
+    // 输入输出按名字区分, rknn_set_io_mem 据此判断绑定的是输入还是输出
+    void name_tensors(MockModel &m)
+    {
+        for (auto &a : m.inputs)
+            snprintf(a.name, sizeof(a.name), "mock_in_%u", a.index);
+        for (auto &a : m.outputs)
+            snprintf(a.name, sizeof(a.name), "mock_out_%u", a.index);
+    }
+
+    // 原生布局: 通道按 C2 个一组, 每组内 [H, W, C2] 连续存放; int8 时 C2 为16, 与 NPU 一次写出的宽度相同
+    void build_native(MockModel &m)
+    {
+        for (size_t i = 0; i < m.outputs.size(); i++)
+        {
+            const rknn_tensor_attr &a = m.outputs[i];
+            uint32_t esize = type_size(a.type);
+            uint32_t c = a.dims[1], hw = a.dims[2] * a.dims[3], c2 = 16 / esize, c1 = (c + c2 - 1) / c2;
+            rknn_tensor_attr n = a;
+            n.n_dims = 5;
+            n.dims[0] = a.dims[0];
+            n.dims[1] = c1;
+            n.dims[2] = a.dims[2];
+            n.dims[3] = a.dims[3];
+            n.dims[4] = c2;
+            n.fmt = RKNN_TENSOR_NC1HWC2;
+            n.n_elems = a.dims[0] * c1 * hw * c2;
+            n.size = n.n_elems * esize;
+            n.size_with_stride = n.size;
+            n.w_stride = a.dims[3];
+            std::vector<int8_t> data(n.size, 0);
+            if (a.qnt_type == RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC && esize == 1)
+                std::fill(data.begin(), data.end(), (int8_t)a.zp);
+            for (uint32_t ch = 0; ch < c; ch++)
+                for (uint32_t k = 0; k < hw; k++)
+                    memcpy(&data[(((ch / c2) * hw + k) * c2 + ch % c2) * esize], &m.data[i][(ch * hw + k) * esize], esize);
+            m.native_outputs.push_back(n);
+            m.native_data.push_back(std::move(data));
+        }
+    }
+
+    // NPU读取输入: 按 NHWC 逐行累加有效像素(跳过行尾填充), 供对比拷贝输入与零拷贝输入的内容
+    uint64_t input_checksum(const rknn_tensor_attr &attr, const uint8_t *data, uint32_t row_stride)
+    {
+        uint32_t h = attr.dims[1], row = attr.dims[2] * attr.dims[3];
+        uint64_t sum = 0;
+        for (uint32_t y = 0; y < h; y++)
+        {
+            const uint8_t *p = data + (size_t)y * row_stride;
+            for (uint32_t x = 0; x < row; x++)
+                sum += p[x] * (uint64_t)(x + 1);
+        }
+        return sum;
+    }
+
+    // AUTO 模式下挑选排队最少的核心, 近似真实驱动的空闲核心调度
+    int pick_idle_core()
+    {
+        int best = 0;
+        for (int i = 1; i < g_core_count; i++)
+        {
+            if (g_cores[i].pending < g_cores[best].pending)
+                best = i;
+        }
+        return best;
+    }
+
+    // 在 core_mask 指定的核心上执行一帧, 写入绑定的输出内存
+    void execute(MockContext *ctx, const MockJob &job)
+    {
+        // 收集本次需要占用的核心, 按编号顺序加锁避免死锁
+        int cores[RKNN_MOCK_MAX_CORES];
+        int n = 0;
+        int core_mask = ctx->core_mask;
+        if (core_mask == RKNN_NPU_CORE_AUTO)
+        {
+            cores[n++] = pick_idle_core();
+        }
+        else
+        {
+            for (int i = 0; i < RKNN_MOCK_MAX_CORES; i++)
+            {
+                if (core_mask & (1 << i))
+                    cores[n++] = i;
+            }
+        }
+
+        int latency = 0;
+        for (int i = 0; i < n; i++)
+        {
+            g_cores[cores[i]].pending++;
+            latency = std::max(latency, g_cores[cores[i]].latency_us.load());
+        }
+        // 多核联合执行按 1/n 计时, 另加 20% 的同步开销
+        if (n > 1)
+            latency = latency * 12 / (10 * n);
+
+        // 固定数组, 不在每帧推理中分配内存
+        std::unique_lock<std::mutex> locks[RKNN_MOCK_MAX_CORES];
+        for (int i = 0; i < n; i++)
+            locks[i] = std::unique_lock<std::mutex>(g_cores[cores[i]].mtx);
+
+        auto start = Clock::now();
+        std::this_thread::sleep_for(std::chrono::microseconds(latency));
+        int64_t busy = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+        for (int i = 0; i < n; i++)
+            locks[i].unlock();
+
+        for (int i = 0; i < n; i++)
+        {
+            g_cores[cores[i]].runs++;
+            g_cores[cores[i]].busy_us += busy;
+            g_cores[cores[i]].pending--;
+        }
+        ctx->last_run_us = busy;
+
+        // 绑定了输出内存时结果写在其中, 之后不需要 rknn_outputs_get
+        const MockModel &m = *ctx->model;
+        for (size_t i = 0; i < job.output_mems.size(); i++)
+        {
+            if (job.output_mems[i] == nullptr)
+                continue;
+            if (job.output_bind[i] == BIND_NATIVE)
+            {
+                memcpy(job.output_mems[i]->virt_addr, m.native_data[i].data(), m.native_data[i].size());
+            }
+            else if (job.output_bind[i] == BIND_FLOAT)
+            {
+                float *dst = (float *)job.output_mems[i]->virt_addr;
+                for (uint32_t k = 0; k < m.outputs[i].n_elems; k++)
+                    dst[k] = element(m.outputs[i], m.data[i], k);
+                g_output_copy_bytes += m.outputs[i].n_elems * sizeof(float);
+            }
+            else
+            {
+                memcpy(job.output_mems[i]->virt_addr, m.data[i].data(), m.data[i].size());
+                g_output_copy_bytes += m.data[i].size();
+            }
+        }
+        g_runs++;
+    }
+
+    // 异步上下文的工作线程, 相当于该上下文在NPU驱动中的任务队列
+    void run_jobs(MockContext *ctx)
+    {
+        std::unique_lock<std::mutex> lock(ctx->job_mtx);
+        while (true)
+        {
+            ctx->job_cv.wait(lock, [ctx] { return ctx->stop || ctx->completed < ctx->submitted; });
+            if (ctx->completed == ctx->submitted)
+                return;
+            uint64_t id = ctx->completed + 1;
+            // 模拟执行时才读取绑定的运行时: 之前提交的帧写入最后绑定的输出内存
+            if (g_late_binding)
+            {
+                ctx->jobs[id % RKNN_MOCK_MAX_INFLIGHT].output_mems = ctx->output_mems;
+                ctx->jobs[id % RKNN_MOCK_MAX_INFLIGHT].output_bind = ctx->output_bind;
+            }
+            // 提交方只会覆盖已完成帧的任务, 执行期间不需要持锁
+            lock.unlock();
+            execute(ctx, ctx->jobs[id % RKNN_MOCK_MAX_INFLIGHT]);
+            lock.lock();
+            ctx->completed = id;
+            ctx->job_cv.notify_all();
+        }
+    }
+} // namespace
+
+extern "C" {
+
+int rknn_init(rknn_context *context, void *model, uint32_t size, uint32_t flag, rknn_init_extend *extend)
+{
+    std::call_once(g_env_once, load_env);
+    auto m = std::make_shared<MockModel>();
+    const char *dir = getenv("RKNN_MOCK_DATA_DIR");
+    if (dir != NULL)
+    {
+        if (load_recorded(*m, dir) != 0)
+            return RKNN_ERR_MODEL_INVALID;
+    }
+    else
+    {
+        build_synthetic(*m);
+    }
+    name_tensors(*m);
+    build_native(*m);
+
+    MockContext *ctx = new MockContext();
+    ctx->model = m;
+    ctx->async = (flag & RKNN_FLAG_ASYNC_MASK) != 0;
+    *context = static_cast<rknn_context>(reinterpret_cast<uintptr_t>(ctx));
+    return RKNN_SUCC;
+}
+
+int rknn_dup_context(rknn_context *context_in, rknn_context *context_out)
+{
+    MockContext *src = to_ctx(*context_in);
+    if (src == NULL)
+        return RKNN_ERR_CTX_INVALID;
+    MockContext *ctx = new MockContext();
+    ctx->model = src->model;
+    ctx->async = src->async;
+    *context_out = static_cast<rknn_context>(reinterpret_cast<uintptr_t>(ctx));
+    return RKNN_SUCC;
+}
+
+int rknn_destroy(rknn_context context)
+{
+    MockContext *ctx = to_ctx(context);
+    if (ctx != NULL && ctx->worker.joinable())
+    {
+        // 已提交的帧执行完后工作线程退出
+        {
+            std::lock_guard<std::mutex> lock(ctx->job_mtx);
+            ctx->stop = true;
+        }
+        ctx->job_cv.notify_all();
+        ctx->worker.join();
+    }
+    delete ctx;
+    return RKNN_SUCC;
+}
+
+int rknn_query(rknn_context context, rknn_query_cmd cmd, void *info, uint32_t size)
+{
+    MockContext *ctx = to_ctx(context);
+    if (ctx == NULL)
+        return RKNN_ERR_CTX_INVALID;
+    const MockModel &m = *ctx->model;
+    switch (cmd)
+    {
+    case RKNN_QUERY_IN_OUT_NUM:
+    {
+        if (size < sizeof(rknn_input_output_num))
+            return RKNN_ERR_PARAM_INVALID;
+        rknn_input_output_num *num = (rknn_input_output_num *)info;
+        num->n_input = m.inputs.size();
+        num->n_output = m.outputs.size();
+        return RKNN_SUCC;
+    }
+    case RKNN_QUERY_INPUT_ATTR:
+    case RKNN_QUERY_OUTPUT_ATTR:
+    {
+        if (size < sizeof(rknn_tensor_attr))
+            return RKNN_ERR_PARAM_INVALID;
+        rknn_tensor_attr *attr = (rknn_tensor_attr *)info;
+        const std::vector<rknn_tensor_attr> &list = cmd == RKNN_QUERY_INPUT_ATTR ? m.inputs : m.outputs;
+        if (attr->index >= list.size())
+            return RKNN_ERR_PARAM_INVALID;
+        *attr = list[attr->index];
+        return RKNN_SUCC;
+    }
+    case RKNN_QUERY_NATIVE_NC1HWC2_OUTPUT_ATTR:
+    {
+        if (size < sizeof(rknn_tensor_attr))
+            return RKNN_ERR_PARAM_INVALID;
+        rknn_tensor_attr *attr = (rknn_tensor_attr *)info;
+        if (attr->index >= m.native_outputs.size())
+            return RKNN_ERR_PARAM_INVALID;
+        *attr = m.native_outputs[attr->index];
+        return RKNN_SUCC;
+    }
+    case RKNN_QUERY_PERF_RUN:
+    {
+        if (size < sizeof(rknn_perf_run))
+            return RKNN_ERR_PARAM_INVALID;
+        ((rknn_perf_run *)info)->run_duration = ctx->last_run_us;
+        return RKNN_SUCC;
+    }
+    case RKNN_QUERY_SDK_VERSION:
+    {
+        if (size < sizeof(rknn_sdk_version))
+            return RKNN_ERR_PARAM_INVALID;
+        rknn_sdk_version *version = (rknn_sdk_version *)info;
+        snprintf(version->api_version, sizeof(version->api_version), "mock");
+        snprintf(version->drv_version, sizeof(version->drv_version), "mock");
+        return RKNN_SUCC;
+    }
+    default:
+        return RKNN_ERR_PARAM_INVALID;
+    }
+}
+
+int rknn_set_core_mask(rknn_context context, rknn_core_mask core_mask)
+{
+    MockContext *ctx = to_ctx(context);
+    if (ctx == NULL)
+        return RKNN_ERR_CTX_INVALID;
+    // 与真实运行时一致: 单核平台不支持设置核心, 多核平台不能绑定不存在的核心
+    if (core_mask >= RKNN_NPU_CORE_UNDEFINED || (g_core_count == 1 && core_mask != RKNN_NPU_CORE_AUTO) ||
+        (core_mask >> g_core_count) != 0)
+        return RKNN_ERR_PARAM_INVALID;
+    ctx->core_mask = core_mask;
+    return RKNN_SUCC;
+}
+
+int rknn_inputs_set(rknn_context context, uint32_t n_inputs, rknn_input inputs[])
+{
+    MockContext *ctx = to_ctx(context);
+    if (ctx == NULL)
+        return RKNN_ERR_CTX_INVALID;
+    if (n_inputs != ctx->model->inputs.size())
+        return RKNN_ERR_INPUT_INVALID;
+    // 真实运行时会把输入拷贝(并按需转换)到 NPU 内存, 这里保留这次拷贝的开销
+    ctx->input.resize(inputs[0].size);
+    memcpy(ctx->input.data(), inputs[0].buf, inputs[0].size);
+    g_input_copy_bytes += inputs[0].size;
+    // 之后的推理读取拷贝进来的输入
+    ctx->input_mem = nullptr;
+    return RKNN_SUCC;
+}
+
+rknn_tensor_mem *rknn_create_mem(rknn_context context, uint32_t size)
+{
+    if (to_ctx(context) == NULL || size == 0)
+        return NULL;
+    rknn_tensor_mem *mem = (rknn_tensor_mem *)calloc(1, sizeof(rknn_tensor_mem));
+    if (mem == NULL)
+        return NULL;
+    // 真实运行时分配NPU可直接访问的DMA内存, 这里按页对齐分配普通内存
+    if (posix_memalign(&mem->virt_addr, 4096, size) != 0)
+    {
+        free(mem);
+        return NULL;
+    }
+    mem->fd = -1;
+    mem->size = size;
+    mem->flags = RKNN_TENSOR_MEMORY_FLAGS_ALLOC_INSIDE;
+    return mem;
+}
+
+int rknn_destroy_mem(rknn_context context, rknn_tensor_mem *mem)
+{
+    MockContext *ctx = to_ctx(context);
+    if (ctx == NULL)
+        return RKNN_ERR_CTX_INVALID;
+    if (mem == NULL)
+        return RKNN_ERR_PARAM_INVALID;
+    if (ctx->input_mem == mem)
+        ctx->input_mem = nullptr;
+    for (auto &out : ctx->output_mems)
+    {
+        if (out == mem)
+            out = nullptr;
+    }
+    free(mem->virt_addr);
+    free(mem);
+    return RKNN_SUCC;
+}
+
+int rknn_set_io_mem(rknn_context context, rknn_tensor_mem *mem, rknn_tensor_attr *attr)
+{
+    MockContext *ctx = to_ctx(context);
+    if (ctx == NULL)
+        return RKNN_ERR_CTX_INVALID;
+    if (mem == NULL || attr == NULL)
+        return RKNN_ERR_PARAM_INVALID;
+    const MockModel &m = *ctx->model;
+    if (attr->index < m.inputs.size() && strcmp(attr->name, m.inputs[attr->index].name) == 0)
+    {
+        const rknn_tensor_attr &in = m.inputs[attr->index];
+        // 只支持 uint8 NHWC 输入, 与 rknn_inputs_set 的用法一致
+        if (attr->type != RKNN_TENSOR_UINT8 || attr->fmt != RKNN_TENSOR_NHWC || mem->size < in.size_with_stride)
+            return RKNN_ERR_INPUT_INVALID;
+        ctx->input_mem = mem;
+        return RKNN_SUCC;
+    }
+    if (attr->index < m.outputs.size() && strcmp(attr->name, m.outputs[attr->index].name) == 0)
+    {
+        // 原生布局的输出由NPU直接写入; NCHW 布局与 rknn_outputs_get 一样需要运行时转换, 类型为 float32 时同时反量化
+        const rknn_tensor_attr &out = m.outputs[attr->index];
+        uint8_t bind;
+        uint32_t need;
+        if (attr->fmt == RKNN_TENSOR_NC1HWC2 && attr->type == out.type)
+        {
+            bind = BIND_NATIVE;
+            need = m.native_outputs[attr->index].size;
+        }
+        else if (attr->fmt == out.fmt && attr->type == out.type)
+        {
+            bind = BIND_NCHW;
+            need = out.size;
+        }
+        else if (attr->fmt == out.fmt && attr->type == RKNN_TENSOR_FLOAT32)
+        {
+            bind = BIND_FLOAT;
+            need = out.n_elems * sizeof(float);
+        }
+        else
+        {
+            return RKNN_ERR_OUTPUT_INVALID;
+        }
+        if (mem->size < need)
+            return RKNN_ERR_OUTPUT_INVALID;
+        // rknn_run 及 RKNN_MOCK_LATE_BINDING 时的工作线程在 job_mtx 下读取绑定
+        std::lock_guard<std::mutex> lock(ctx->job_mtx);
+        if (ctx->output_mems.empty())
+        {
+            ctx->output_mems.resize(m.outputs.size(), nullptr);
+            ctx->output_bind.resize(m.outputs.size(), BIND_NCHW);
+        }
+        ctx->output_mems[attr->index] = mem;
+        ctx->output_bind[attr->index] = bind;
+        return RKNN_SUCC;
+    }
+    return RKNN_ERR_PARAM_INVALID;
+}
+
+int rknn_run(rknn_context context, rknn_run_extend *extend)
+{
+    MockContext *ctx = to_ctx(context);
+    if (ctx == NULL)
+        return RKNN_ERR_CTX_INVALID;
+
+    // 绑定了输入内存时直接读取(不计入核心的执行时间), 行间距为 w_stride; 否则读取 rknn_inputs_set 拷贝进来的紧密排列的输入
+    // 提交时即读取, 之后改写输入不影响这一帧
+    const rknn_tensor_attr &in = ctx->model->inputs[0];
+    if (ctx->input_mem != nullptr)
+        g_input_checksum += input_checksum(in, (const uint8_t *)ctx->input_mem->virt_addr, in.w_stride * in.dims[3]);
+    else if (ctx->input.size() >= in.n_elems)
+        g_input_checksum += input_checksum(in, ctx->input.data(), in.dims[2] * in.dims[3]);
+
+    bool non_block = ctx->async && extend != NULL && extend->non_block;
+    std::unique_lock<std::mutex> lock(ctx->job_mtx);
+    // 队列已满时等待最早的帧完成; 阻塞执行时先等之前提交的帧都完成, 保持按提交顺序完成
+    uint64_t limit = non_block ? RKNN_MOCK_MAX_INFLIGHT - 1 : 0;
+    ctx->job_cv.wait(lock, [ctx, limit] { return ctx->submitted - ctx->completed <= limit; });
+    uint64_t id = ctx->submitted + 1;
+    MockJob &job = ctx->jobs[id % RKNN_MOCK_MAX_INFLIGHT];
+    // 容量在第一次之后不变, 赋值不分配内存
+    job.output_mems = ctx->output_mems;
+    job.output_bind = ctx->output_bind;
+    ctx->submitted = id;
+    if (extend != NULL)
+        extend->frame_id = id;
+
+    if (non_block)
+    {
+        if (!ctx->worker.joinable())
+            ctx->worker = std::thread(run_jobs, ctx);
+        ctx->job_cv.notify_all();
+        return RKNN_SUCC;
+    }
+    lock.unlock();
+    execute(ctx, job);
+    lock.lock();
+    ctx->completed = id;
+    ctx->job_cv.notify_all();
+    return RKNN_SUCC;
+}
+
+int rknn_wait(rknn_context context, rknn_run_extend *extend)
+{
+    MockContext *ctx = to_ctx(context);
+    if (ctx == NULL)
+        return RKNN_ERR_CTX_INVALID;
+    std::unique_lock<std::mutex> lock(ctx->job_mtx);
+    // 未指定帧号时等待所有已提交的帧
+    uint64_t id = extend != NULL && extend->frame_id != 0 ? extend->frame_id : ctx->submitted;
+    auto done = [ctx, id] { return ctx->completed >= id; };
+    if (extend != NULL && extend->timeout_ms > 0)
+    {
+        if (!ctx->job_cv.wait_for(lock, std::chrono::milliseconds(extend->timeout_ms), done))
+            return RKNN_ERR_TIMEOUT;
+    }
+    else
+    {
+        ctx->job_cv.wait(lock, done);
+    }
+    return RKNN_SUCC;
+}
+
+int rknn_outputs_get(rknn_context context, uint32_t n_outputs, rknn_output outputs[], rknn_output_extend *extend)
+{
+    MockContext *ctx = to_ctx(context);
+    if (ctx == NULL)
+        return RKNN_ERR_CTX_INVALID;
+    const MockModel &m = *ctx->model;
+    if (n_outputs > m.outputs.size())
+        return RKNN_ERR_OUTPUT_INVALID;
+
+    for (uint32_t i = 0; i < n_outputs; i++)
+    {
+        const rknn_tensor_attr &attr = m.outputs[i];
+        const std::vector<int8_t> &src = m.data[i];
+        uint32_t need = outputs[i].want_float ? attr.n_elems * sizeof(float) : attr.size;
+        if (outputs[i].is_prealloc)
+        {
+            if (outputs[i].buf == NULL || outputs[i].size < need)
+                return RKNN_ERR_OUTPUT_INVALID;
+        }
+        else
+        {
+            outputs[i].buf = malloc(need);
+            if (outputs[i].buf == NULL)
+                return RKNN_ERR_MALLOC_FAIL;
+        }
+        outputs[i].index = i;
+        outputs[i].size = need;
+
+        if (outputs[i].want_float)
+        {
+            float *dst = (float *)outputs[i].buf;
+            for (uint32_t k = 0; k < attr.n_elems; k++)
+                dst[k] = element(attr, src, k);
+        }
+        else
+        {
+            memcpy(outputs[i].buf, src.data(), need);
+        }
+        g_output_copy_bytes += need;
+    }
+    return RKNN_SUCC;
+}
+
+int rknn_outputs_release(rknn_context context, uint32_t n_ouputs, rknn_output outputs[])
+{
+    for (uint32_t i = 0; i < n_ouputs; i++)
+    {
+        if (!outputs[i].is_prealloc && outputs[i].buf != NULL)
+        {
+            free(outputs[i].buf);
+            outputs[i].buf = NULL;
+        }
+    }
+    return RKNN_SUCC;
+}
+
+int rknn_mock_set_core_latency(int core, int latency_us)
+{
+    std::call_once(g_env_once, load_env);
+    if (core < 0 || core >= RKNN_MOCK_MAX_CORES || latency_us < 0)
+        return -1;
+    g_cores[core].latency_us = latency_us;
+    return 0;
+}
+
+int rknn_mock_get_core_stats(int core, rknn_mock_core_stats *stats)
+{
+    if (core < 0 || core >= RKNN_MOCK_MAX_CORES || stats == NULL)
+        return -1;
+    stats->runs = g_cores[core].runs;
+    stats->busy_us = g_cores[core].busy_us;
+    stats->latency_us = g_cores[core].latency_us;
+    return 0;
+}
+
+void rknn_mock_reset_stats(void)
+{
+    for (int i = 0; i < RKNN_MOCK_MAX_CORES; i++)
+    {
+        g_cores[i].runs = 0;
+        g_cores[i].busy_us = 0;
+    }
+    g_runs = 0;
+    g_input_copy_bytes = 0;
+    g_output_copy_bytes = 0;
+    g_input_checksum = 0;
+}
+
+int rknn_mock_get_io_stats(rknn_mock_io_stats *stats)
+{
+    if (stats == NULL)
+        return -1;
+    stats->runs = g_runs;
+    stats->input_copy_bytes = g_input_copy_bytes;
+    stats->output_copy_bytes = g_output_copy_bytes;
+    stats->input_checksum = g_input_checksum;
+    return 0;
+}
+
+} // extern "C"